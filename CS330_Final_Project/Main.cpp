@@ -1,5 +1,6 @@
-#include <iostream>         // cout, cerr
-#include <cstdlib>          // EXIT_FAILURE
+#include <cstdlib>          // EXIT_FAILURE, strtod
+#include <cstring>          // strcmp
+#include <map>              // batch textures by file
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 
@@ -14,15 +15,30 @@
 
 #include <GLFW/camera.h>
 
+#include <allocators.h>
+#include <batch.h>
+#include <dynamicresolution.h>
+#include <filewatcher.h>
+#include <framecapture.h>
+#include <frametimes.h>
+#include <gpuresources.h>
+#include <gputimers.h>
+#include <inputlog.h>
+#include <lightmapper.h>
+#include <logging.h>
 #include <meshes.h>
+#include <multiview.h>
+#include <regression.h>
+#include <scene.h>
+#include <scenefile.h>
+#include <shadervariants.h>
+#include <shaders.h>
+#include <shadows.h>
+#include <texturestreaming.h>
+#include <threadpool.h>
 
 using namespace std; // Uses the standard namespace
 
-/*Shader program Macro*/
-#ifndef GLSL
-#define GLSL(Version, Source) "#version " #Version " core \n" #Source
-#endif
-
 // Unnamed namespace
 namespace
 {
@@ -34,179 +50,113 @@ namespace
 
 	// Main GLFW window
 	GLFWwindow* gWindow = nullptr;
-	// Shader program
-	GLuint gSurfaceProgramId;
+	// Size of the window's framebuffer in pixels, kept up to date by UResizeWindow
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
+	// Shader program, replaced by gShaders when its files are saved
+	ShaderVariants gSurfaceVariants;	// surface.vert/.frag specialized per material
 	GLuint gLightProgramId;
+	GLuint gShadowProgramId;
+	GLuint gDepthProgramId;
+	ShaderLibrary gShaders;
+	// Baked diffuse light of the static objects, bound to texture unit 3
+	GpuTexture gLightmapTexture;
+	// Material textures, streamed in as the view gets close; the scene refers
+	// to them by the streamer's ids
+	TextureStreamer gTextureStreamer;
+	// Filtering and wrapping of every texture unit the shaders sample
+	SamplerLibrary gSamplers;
+	// GPU time of each render pass, reported at exit
+	GpuPassTimers gGpuTimers;
+	int gShadowPass;
+	int gDepthPass;
+	int gSurfacePass;
+	int gLightPass;
 	Camera gCameraFront(glm::vec3(0.0f, 2.0f, 2.0f));
 	Camera* g_pCurrentCamera = NULL;
-	// Texture
-	GLuint gTableTextureId;
-	GLuint gLampTextureId;
-	GLuint gBulbTextureId;
-	GLuint gShadeTextureId;
 
-	glm::vec2 gUVScale(2.0f, 2.0f);
 	GLint gTexWrapMode = GL_REPEAT;
 
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
+	// Keys held down, tracked from key events so a replay can press them too
+	bool gKeyDown[GLFW_KEY_LAST + 1] = {};
 	// timing
 	float gDeltaTime = 0.0f; // time between current frame and last frame
 	float gLastFrame = 0.0f;
+	// Frame arena for the draw list, and the heap allocations of every frame
+	FrameMemory gFrameMemory(64 * 1024);
 
 	Meshes meshes;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-/* Surface Vertex Shader Source Code*/
-const GLchar* surfaceVertexShaderSource = GLSL(440,
-
-	layout(location = 0) in vec3 vertexPosition; // VAP position 0 for vertex position data
-layout(location = 1) in vec3 vertexNormal; // VAP position 1 for normals
-layout(location = 2) in vec2 textureCoordinate;
-
-out vec3 vertexFragmentNormal; // For outgoing normals to fragment shader
-out vec3 vertexFragmentPos; // For outgoing color / pixels to fragment shader
-out vec2 vertexTextureCoordinate;
-
-//Uniform / Global variables for the  transform matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-	gl_Position = projection * view * model * vec4(vertexPosition, 1.0f); // Transforms vertices into clip coordinates
 
-	vertexFragmentPos = vec3(model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
-
-	vertexFragmentNormal = mat3(transpose(inverse(model))) * vertexNormal; // get normal vectors in world space only and exclude normal translation properties
-	vertexTextureCoordinate = textureCoordinate;
-}
-);
-////////////////////////////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////////////////////////////
-/* Surface Fragment Shader Source Code*/
-const GLchar* surfaceFragmentShaderSource = GLSL(440,
-
-	in vec3 vertexFragmentNormal; // For incoming normals
-in vec3 vertexFragmentPos; // For incoming fragment position
-in vec2 vertexTextureCoordinate;
-
-out vec4 fragmentColor; // For outgoing cube color to the GPU
-
-// Uniform / Global variables for object color, light color, light position, and camera/view position
-uniform vec3 objectColor;
-uniform vec3 ambientColor;
-uniform vec3 light1Color;
-uniform vec3 light1Position;
-uniform vec3 light2Color;
-uniform vec3 light2Position;
-uniform vec3 viewPosition;
-uniform sampler2D uTexture; // Useful when working with multiple textures
-uniform vec2 uvScale;
-uniform float ambientStrength = 0.1f; // Set ambient or global lighting strength
-uniform float specularIntensity = 0.8f;
-uniform float highlightSize = 16.0f;
-
-void main()
-{
-	/*Phong lighting model calculations to generate ambient, diffuse, and specular components*/
-
-	//Calculate Ambient lighting
-	vec3 ambient = ambientStrength * ambientColor; // Generate ambient light color
-
-	//**Calculate Diffuse lighting**
-	vec3 norm = normalize(vertexFragmentNormal); // Normalize vectors to 1 unit
-	vec3 light1Direction = normalize(light1Position - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
-	float impact1 = max(dot(norm, light1Direction), 0.0);// Calculate diffuse impact by generating dot product of normal and light
-	vec3 diffuse1 = impact1 * light1Color; // Generate diffuse light color
-	vec3 light2Direction = normalize(light2Position - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
-	float impact2 = max(dot(norm, light2Direction), 0.0);// Calculate diffuse impact by generating dot product of normal and light
-	vec3 diffuse2 = impact2 * light2Color; // Generate diffuse light color
-
-	//**Calculate Specular lighting**
-	vec3 viewDir = normalize(viewPosition - vertexFragmentPos); // Calculate view direction
-	vec3 reflectDir1 = reflect(-light1Direction, norm);// Calculate reflection vector
-	//Calculate specular component
-	float specularComponent1 = pow(max(dot(viewDir, reflectDir1), 0.0), highlightSize);
-	vec3 specular1 = specularIntensity * specularComponent1 * light1Color;
-	vec3 reflectDir2 = reflect(-light2Direction, norm);// Calculate reflection vector
-	//Calculate specular component
-	float specularComponent2 = pow(max(dot(viewDir, reflectDir2), 0.0), highlightSize);
-	vec3 specular2 = specularIntensity * specularComponent2 * light2Color;
-
-	//**Calculate phong result**
-	//Texture holds the color to be used for all three components
-	vec4 textureColor = texture(uTexture, vertexTextureCoordinate * uvScale);
-	vec3 phong1 = (ambient + diffuse1 + specular1) * textureColor.xyz; //objectColor;
-	vec3 phong2 = (ambient + diffuse2 + specular2) * textureColor.xyz; //objectColor;
-
-	fragmentColor = vec4(phong1 + phong2, 1.0); // Send lighting results to GPU
-}
-);
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-/* Light Object Shader Source Code*/
-const GLchar* lightVertexShaderSource = GLSL(330,
-	layout(location = 0) in vec3 aPos;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
-);
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-/* Light Object Shader Source Code*/
-const GLchar* lightFragmentShaderSource = GLSL(330,
-	out vec4 FragColor;
-
-void main()
-{
-	FragColor = vec4(1.0); // set all 4 vector values to 1.0
+	// Objects and lights drawn by URender, loaded from the scene file
+	Scene gScene;
+	const char* const SCENE_FILENAME = "resources/scenes/table.json";
+	// Cached shadow maps for the two scene lights
+	ShadowMaps gShadowMaps;
+	const GLsizei SHADOW_MAP_SIZE = 2048;
+
+	// Input recording and replay, set from the command line:
+	//   --record <file>       log every input event
+	//   --replay <file>       drive the camera from a log instead of live input
+	//   --step <seconds>      simulated time per replayed frame (default 1/60)
+	//   --headless            replay without showing the window
+	//   --frame-times <file>  write the replay frame times as CSV
+	InputRecorder gInputRecorder;
+	InputPlayer gInputPlayer;
+	double gReplayStep = 1.0 / 60.0;
+	bool gHeadless = false;
+	const char* gFrameTimesFilename = nullptr;
+	bool gDispatchingReplay = false;	// true while logged events are fed to the callbacks
+	double gReplayLastTime = -1.0;
+	FrameTimes gFrameTimes;
+
+	// Image and performance regression run, set from the command line:
+	//   --regress <suite.json>  render the suite poses offscreen, check them and exit
+	//   --regress-out <dir>     where actual and diff images go (default "regression")
+	//   --regress-update        store the results as the new references
+	const char* gRegressionSuiteFilename = nullptr;
+	const char* gRegressionOutput = "regression";
+	bool gRegressionUpdate = false;
+
+	// Offscreen rendering of many scene variants, set from the command line:
+	//   --batch <jobs.json>     render every job of the file to an image and exit
+	const char* gBatchFilename = nullptr;
+	std::map<std::string, GLuint> gBatchTextures;	// job texture files, loaded once
+
+	// Render resolution scaling, set from the command line:
+	//   --gpu-target <ms>       GPU time per frame to hold (default 14)
+	//   --min-scale <scale>     lowest resolution scale (default 0.5)
+	//   --fixed-resolution      always render at the window resolution
+	DynamicResolution gDynamicResolution;
+	double gGpuTargetMilliseconds = 14.0;
+	float gMinimumScale = 0.5f;
+	bool gFixedResolution = false;
+
+	// Recording of the rendered frames, set from the command line:
+	//   --capture <dir>                record every frame into dir
+	//   --capture-format <png|y4m>     PNG sequence (default) or a YUV video
+	FrameCapture gFrameCapture;
+	const char* gCaptureDirectory = nullptr;
+	CaptureFormat gCaptureFormat = CaptureFormat::Png;
+
+	// Messages are written by a logging thread, set from the command line:
+	//   --log <file>                   also write them with times and threads
+	//   --log-level <level>            debug, info (default), warning or error
+
+	// Estimated GPU memory of every live resource, set from the command line:
+	//   --gpu-budget <MB>              warn when the resources grow past it
+	//   --texture-budget <MB>          memory for the material textures (default 256)
+	size_t gTextureBudget = 256 * 1024 * 1024;
+
+	// Several cameras drawn in one pass, set from the command line:
+	//   --views <single|stereo|quad>   views side by side in the window (default single)
+	MultiView gMultiView;
+	ViewLayout gViewLayout = ViewLayout::Single;
+	GLuint gMultiViewLightProgramId = 0;	// light.vert and depth.vert with VIEW_COUNT
+	GLuint gMultiViewDepthProgramId = 0;
 }
-);
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-// blinn shading with texture =============================
-const GLchar* vertexShaderSource = GLSL(440,
-	layout(location = 0) in vec3 position;
-layout(location = 2) in vec2 textureCoordinate;
-
-out vec2 vertexTextureCoordinate;
-
-
-//Global variables for the transform matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-	gl_Position = projection * view * model * vec4(position, 1.0f); // transforms vertices to clip coordinates
-	vertexTextureCoordinate = textureCoordinate;
-}
-);
-
-const char* fragmentShaderSource = GLSL(440,
-	in vec2 vertexTextureCoordinate;
-
-out vec4 fragmentColor;
-
-uniform sampler2D uTexture;
-uniform vec2 uvScale;
-
-void main()
-{
-	fragmentColor = texture(uTexture, vertexTextureCoordinate * uvScale);
-}
-);
 
 /* User-defined Function prototypes to:
  * initialize the program, set the window size,
@@ -214,16 +164,26 @@ void main()
  * and render graphics on the screen
  */
 bool UInitialize(int, char* [], GLFWwindow** window);
+bool UParseArguments(int argc, char* argv[]);
 void UResizeWindow(GLFWwindow* window, int width, int height);
 void UProcessInput(GLFWwindow* window);
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+void UKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+bool UFilterInput(InputEventType type, int code, int action, double x, double y);
+bool UReplayInput();
 void URender();
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
-void UDestroyShaderProgram(GLuint programId);
+GLuint USurfaceProgram(const SceneObject& object, int lightCount);
+void UBakeLightmap();
+glm::vec3 UAverageTextureColor(GLuint textureId);
+void URenderPose(const RegressionPose& pose);
+bool URenderJob(const BatchJob& job, int width, int height);
+void UReloadScene(SceneLoader& loader, FileWatcher& watcher);
 bool UCreateTexture(const char* filename, GLuint& textureId);
 void UDestroyTexture(GLuint textureId);
+int ULoadMesh(const char* filename);
+int UGenerateMesh(Meshes::MeshType type, int segments, int rings);
 
 // main function. Entry point to the OpenGL program
 int main(int argc, char* argv[])
@@ -234,103 +194,200 @@ int main(int argc, char* argv[])
 	// Create the meshes
 	meshes.CreateMeshes();
 
-	// Create the shader program
-	if (!UCreateShaderProgram(surfaceVertexShaderSource, surfaceFragmentShaderSource, gSurfaceProgramId))
+	// Create the shader program; saving a shader file recompiles it in the background
+	gShaders.Initialize(gWindow);
+	// the full variant is the fallback of every other one, so it must build
+	gSurfaceVariants.Initialize(gShaders, "resources/shaders/surface.vert", "resources/shaders/surface.frag");
+	if (!gSurfaceVariants.GetProgram(ShaderFeatures()))
 		return EXIT_FAILURE;
 
-	if (!UCreateShaderProgram(lightVertexShaderSource, lightFragmentShaderSource, gLightProgramId))
+	if (!gShaders.AddProgram("resources/shaders/light.vert", "resources/shaders/light.frag", gLightProgramId))
 		return EXIT_FAILURE;
 
-	// Load texture
-	const char* texFilename = "resources/textures/wood.jpg";
-	if (!UCreateTexture(texFilename, gTableTextureId))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
+	if (!gShaders.AddProgram("resources/shaders/shadow.vert", "resources/shaders/shadow.frag", gShadowProgramId))
 		return EXIT_FAILURE;
-	}
 
-	const char* texFilename2 = "resources/textures/metal.jpg";
-	if (!UCreateTexture(texFilename2, gLampTextureId))
-	{
-		cout << "Failed to load texture " << texFilename2 << endl;
+	if (!gShaders.AddProgram("resources/shaders/depth.vert", "resources/shaders/depth.frag", gDepthProgramId))
 		return EXIT_FAILURE;
-	}
 
-	const char* texFilename3 = "resources/textures/light.jpeg";
-	if (!UCreateTexture(texFilename3, gBulbTextureId))
+	// a regression run compares images of one view, a batch writes one per job
+	if (!gRegressionSuiteFilename && !gBatchFilename && gMultiView.SetLayout(gViewLayout) && gMultiView.Count() > 1)
 	{
-		cout << "Failed to load texture " << texFilename3 << endl;
-		return EXIT_FAILURE;
+		string defines = "#define VIEW_COUNT " + to_string(gMultiView.Count()) + "\n";
+		if (!gShaders.AddProgram("resources/shaders/light.vert", "resources/shaders/light.frag", gMultiViewLightProgramId, defines))
+			return EXIT_FAILURE;
+		if (!gShaders.AddProgram("resources/shaders/depth.vert", "resources/shaders/depth.frag", gMultiViewDepthProgramId, defines))
+			return EXIT_FAILURE;
 	}
 
-	const char* texFilename4 = "resources/textures/shade.jpeg";
-	if (!UCreateTexture(texFilename4, gShadeTextureId))
-	{
-		cout << "Failed to load texture " << texFilename4 << endl;
-		return EXIT_FAILURE;
-	}
+	gShadowPass = gGpuTimers.AddPass("shadows");
+	gDepthPass = gGpuTimers.AddPass("depth pre-pass");
+	gSurfacePass = gGpuTimers.AddPass("surfaces");
+	gLightPass = gGpuTimers.AddPass("lights");
 
 	glEnable(GL_DEPTH_TEST);
 
-	// tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-	glUseProgram(gSurfaceProgramId);
-	// We set the texture as texture unit 0
-	glUniform1i(glGetUniformLocation(gSurfaceProgramId, "uTexture"), 0);
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), gUVScale.x, gUVScale.y);
+	// a regression run compares images, so its textures keep every level; so
+	// does a batch, whose first frame of a job is its image
+	gTextureStreamer.Create(gTextureBudget, gRegressionSuiteFilename != nullptr || gBatchFilename != nullptr);
 
+	// the jobs are read before the scene is baked, so a bad file fails fast
+	BatchRenderer batch;
+	if (gBatchFilename && !batch.Load(gBatchFilename))
+		return EXIT_FAILURE;
+
+	// Load the scene; the loader creates the textures and meshes it references
+	SceneLoader sceneLoader(UCreateTexture, ULoadMesh, UGenerateMesh);
+	if (!sceneLoader.Load(SCENE_FILENAME, gScene))
+	{
+		LOG_ERROR << "Failed to load scene " << SCENE_FILENAME;
+		return EXIT_FAILURE;
+	}
+	gShadowMaps.CreateShadowMaps(SHADOW_MAP_SIZE);
+	// baked light keeps the colors it was baked with; jobs that recolor the
+	// lights need them lit live
+	if (batch.ChangesLights())
+		gScene.bakeLightmap = false;
+	UBakeLightmap();
+
+	// the scene is drawn into a scaled target; a regression run compares
+	// images at full resolution, so it draws straight to its own target
+	glfwGetFramebufferSize(gWindow, &gFramebufferWidth, &gFramebufferHeight);
+	gDynamicResolution.Create(gFramebufferWidth, gFramebufferHeight);
+	gDynamicResolution.SetTarget(gGpuTargetMilliseconds, gMinimumScale);
+	gDynamicResolution.SetEnabled(!gFixedResolution && !gRegressionSuiteFilename && !gBatchFilename);
+
+	// a replay is captured at its simulated rate, live input at 60 frames per second
+	if (gCaptureDirectory && !gRegressionSuiteFilename && !gBatchFilename)
+	{
+		int framesPerSecond = gInputPlayer.IsOpen() ? int(1.0 / gReplayStep + 0.5) : 60;
+		if (!gFrameCapture.Start(gCaptureDirectory, gCaptureFormat, gFramebufferWidth, gFramebufferHeight, framesPerSecond))
+			return EXIT_FAILURE;
+	}
+
+	// Saving the scene file while the program runs updates the scene in place
+	FileWatcher sceneWatcher;
+	sceneWatcher.Watch(SCENE_FILENAME);
+
+	// the sampler texture units are fixed by layout(binding) in surface.frag,
+	// so a reloaded program needs no setup, and each unit keeps one sampler
+	gSamplers.Create();
+	gSamplers.BindToUnit(0, SamplerLibrary::Repeat);
+	gSamplers.BindToUnit(1, SamplerLibrary::ShadowCompare);
+	gSamplers.BindToUnit(2, SamplerLibrary::ShadowCompare);
+	gSamplers.BindToUnit(3, SamplerLibrary::Clamp);
 	gCameraFront.Front = glm::vec3(0.0, -1.0, -2.0f);
 	gCameraFront.Up = glm::vec3(0.0, 1.0, 0.0);
 	g_pCurrentCamera = &gCameraFront;
 
+	// a regression run checks the suite instead of opening the interactive loop
+	int exitCode = EXIT_SUCCESS;
+	if (gRegressionSuiteFilename)
+	{
+		RegressionSuite suite;
+		bool passed = suite.Load(gRegressionSuiteFilename) &&
+			suite.Run(URenderPose, WINDOW_WIDTH, WINDOW_HEIGHT, gRegressionOutput, gRegressionUpdate);
+		exitCode = passed ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	else if (gBatchFilename)
+		exitCode = batch.Run(URenderJob, glfwGetTime()) ? EXIT_SUCCESS : EXIT_FAILURE;
+
 	// render loop
 	// -----------
-	while (!glfwWindowShouldClose(gWindow))
+	while (!gRegressionSuiteFilename && !gBatchFilename && !glfwWindowShouldClose(gWindow))
 	{
+		gFrameMemory.BeginFrame();
+
 		// per-frame timing
 		// --------------------
 		float currentFrame = glfwGetTime();
 		gDeltaTime = currentFrame - gLastFrame;
 		gLastFrame = currentFrame;
 
+		// a replay advances by a fixed step and feeds the logged events instead
+		if (gInputPlayer.IsOpen() && !UReplayInput())
+			break;
+
 		// input
 		// -----
 		UProcessInput(gWindow);
 
+		UReloadScene(sceneLoader, sceneWatcher);
+		gShaders.Update();
+
 		URender();
 
 		glfwPollEvents();
+
+		gFrameMemory.EndFrame();
+	}
+
+	gInputRecorder.Close();
+	gFrameCapture.Stop();
+	gFrameMemory.Report("Frame memory");
+	gGpuTimers.Report(gScene.depthPrepass ? "GPU passes (depth pre-pass on)" : "GPU passes (depth pre-pass off)");
+	ReportGpuMemory("GPU memory");
+	gTextureStreamer.Report("Texture streaming");
+	if (gDynamicResolution.IsEnabled())
+	{
+		LOG_INFO << "INFO: Dynamic resolution: scale " << gDynamicResolution.GetScale() << ", GPU "
+			<< gDynamicResolution.GetGpuMilliseconds() << " ms per frame";
+	}
+	if (gInputPlayer.IsOpen())
+	{
+		gFrameTimes.Report("Replay frame times");
+		if (gFrameTimesFilename)
+			gFrameTimes.WriteCsv(gFrameTimesFilename);
 	}
 
 	// Release mesh data
 	meshes.DestroyMeshes();
-
-	UDestroyShaderProgram(gSurfaceProgramId);
-	UDestroyShaderProgram(gLightProgramId);
-
-	exit(EXIT_SUCCESS); // Terminates the program successfully
+	gShadowMaps.DestroyShadowMaps();
+	gDynamicResolution.Destroy();
+	gGpuTimers.Destroy();
+	gLightmapTexture.Reset();
+	for (const auto& texture : gBatchTextures)
+		UDestroyTexture(texture.second);
+	gTextureStreamer.Destroy();
+	gSamplers.Destroy();
+
+	gShaders.Destroy();
+
+	// everything the renderer created is gone by now
+	ReportGpuLeaks();
+
+	StopLog();
+	exit(exitCode); // Terminates the program
 }
 
 
 // Initialize GLFW, GLEW, and create a window
 bool UInitialize(int argc, char* argv[], GLFWwindow** window)
 {
+	if (!UParseArguments(argc, argv))
+		return false;
+
 	// GLFW: initialize and configure
 	// ------------------------------
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+	// a headless replay renders into a window that is never shown
+	if (gHeadless)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
 	// GLFW: window creation
 	// ---------------------
 	* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
 	if (*window == NULL)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
+		LOG_ERROR << "Failed to create GLFW window";
 		glfwTerminate();
 		return false;
 	}
@@ -340,9 +397,11 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
 	glfwSetCursorPosCallback(*window, UMousePositionCallback);
 	glfwSetScrollCallback(*window, UMouseScrollCallback);
 	glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
+	glfwSetKeyCallback(*window, UKeyCallback);
 
 	// tell GLFW to capture our mouse
-	glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (!gInputPlayer.IsOpen() && !gRegressionSuiteFilename && !gBatchFilename)
+		glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// GLEW: initialize
 	// ----------------
@@ -352,16 +411,176 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
 
 	if (GLEW_OK != GlewInitResult)
 	{
-		std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
+		LOG_ERROR << glewGetErrorString(GlewInitResult);
 		return false;
 	}
 
 	// Displays GPU OpenGL version
-	cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
+	LOG_INFO << "INFO: OpenGL Version: " << glGetString(GL_VERSION);
+
+	// buffers, textures and framebuffers are created and filled by name
+	if (!HasDirectStateAccess())
+	{
+		LOG_ERROR << "ERROR::GL::NO_DIRECT_STATE_ACCESS OpenGL 4.5 or ARB_direct_state_access is required";
+		return false;
+	}
+
+	// frame times of a replay should not be rounded to the display refresh
+	if (gInputPlayer.IsOpen() || gRegressionSuiteFilename || gBatchFilename)
+		glfwSwapInterval(0);
 
 	return true;
 }
 
+// Read the record/replay options; see the unnamed namespace for the list
+bool UParseArguments(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--record") == 0 && hasValue)
+		{
+			if (!gInputRecorder.Open(argv[++i]))
+				return false;
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && hasValue)
+		{
+			if (!gInputPlayer.Open(argv[++i]))
+				return false;
+		}
+		else if (strcmp(argv[i], "--step") == 0 && hasValue)
+		{
+			gReplayStep = strtod(argv[++i], NULL);
+			if (!(gReplayStep > 0.0))
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_STEP " << argv[i];
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--frame-times") == 0 && hasValue)
+			gFrameTimesFilename = argv[++i];
+		else if (strcmp(argv[i], "--headless") == 0)
+			gHeadless = true;
+		else if (strcmp(argv[i], "--regress") == 0 && hasValue)
+			gRegressionSuiteFilename = argv[++i];
+		else if (strcmp(argv[i], "--regress-out") == 0 && hasValue)
+			gRegressionOutput = argv[++i];
+		else if (strcmp(argv[i], "--regress-update") == 0)
+			gRegressionUpdate = true;
+		else if (strcmp(argv[i], "--batch") == 0 && hasValue)
+			gBatchFilename = argv[++i];
+		else if (strcmp(argv[i], "--gpu-target") == 0 && hasValue)
+		{
+			gGpuTargetMilliseconds = strtod(argv[++i], NULL);
+			if (!(gGpuTargetMilliseconds > 0.0))
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_GPU_TARGET " << argv[i];
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--min-scale") == 0 && hasValue)
+		{
+			gMinimumScale = float(strtod(argv[++i], NULL));
+			if (!(gMinimumScale > 0.0f && gMinimumScale <= 1.0f))
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_MIN_SCALE " << argv[i];
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--fixed-resolution") == 0)
+			gFixedResolution = true;
+		else if (strcmp(argv[i], "--capture") == 0 && hasValue)
+			gCaptureDirectory = argv[++i];
+		else if (strcmp(argv[i], "--capture-format") == 0 && hasValue)
+		{
+			++i;
+			if (strcmp(argv[i], "png") == 0)
+				gCaptureFormat = CaptureFormat::Png;
+			else if (strcmp(argv[i], "y4m") == 0)
+				gCaptureFormat = CaptureFormat::Y4m;
+			else
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_CAPTURE_FORMAT " << argv[i];
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--log") == 0 && hasValue)
+		{
+			if (!AddLogFile(argv[++i]))
+				return false;
+		}
+		else if (strcmp(argv[i], "--log-level") == 0 && hasValue)
+		{
+			LogLevel level;
+			if (!ParseLogLevel(argv[++i], level))
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_LOG_LEVEL " << argv[i];
+				return false;
+			}
+			SetLogLevel(level);
+		}
+		else if (strcmp(argv[i], "--gpu-budget") == 0 && hasValue)
+		{
+			double megabytes = strtod(argv[++i], nullptr);
+			if (megabytes <= 0.0)
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_GPU_BUDGET " << argv[i];
+				return false;
+			}
+			SetGpuMemoryBudget(size_t(megabytes * 1024.0 * 1024.0));
+		}
+		else if (strcmp(argv[i], "--texture-budget") == 0 && hasValue)
+		{
+			double megabytes = strtod(argv[++i], nullptr);
+			if (megabytes <= 0.0)
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_TEXTURE_BUDGET " << argv[i];
+				return false;
+			}
+			gTextureBudget = size_t(megabytes * 1024.0 * 1024.0);
+		}
+		else if (strcmp(argv[i], "--views") == 0 && hasValue)
+		{
+			if (!MultiView::ParseLayout(argv[++i], gViewLayout))
+			{
+				LOG_ERROR << "ERROR::ARGUMENTS::BAD_VIEWS " << argv[i];
+				return false;
+			}
+		}
+		else
+		{
+			LOG_ERROR << "ERROR::ARGUMENTS::UNKNOWN " << argv[i];
+			return false;
+		}
+	}
+
+	if (gInputRecorder.IsOpen() && gInputPlayer.IsOpen())
+	{
+		LOG_ERROR << "ERROR::ARGUMENTS::RECORD_AND_REPLAY";
+		return false;
+	}
+	if (gRegressionSuiteFilename && (gInputRecorder.IsOpen() || gInputPlayer.IsOpen()))
+	{
+		LOG_ERROR << "ERROR::ARGUMENTS::REGRESS_WITH_RECORD_OR_REPLAY";
+		return false;
+	}
+	if (gBatchFilename && (gRegressionSuiteFilename || gInputRecorder.IsOpen() || gInputPlayer.IsOpen()))
+	{
+		LOG_ERROR << "ERROR::ARGUMENTS::BATCH_WITH_REGRESS_RECORD_OR_REPLAY";
+		return false;
+	}
+	if (gHeadless && !gInputPlayer.IsOpen() && !gRegressionSuiteFilename && !gBatchFilename)
+	{
+		LOG_ERROR << "ERROR::ARGUMENTS::HEADLESS_NEEDS_REPLAY";
+		return false;
+	}
+
+	// the suite and the batch render offscreen, there is nothing to show
+	if (gRegressionSuiteFilename || gBatchFilename)
+		gHeadless = true;
+	return true;
+}
+
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 void UProcessInput(GLFWwindow* window)
@@ -369,26 +588,91 @@ void UProcessInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+	// camera keys come from key events, which a replay provides as well
+	if (gKeyDown[GLFW_KEY_W])
 		g_pCurrentCamera->ProcessKeyboard(FORWARD, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+	if (gKeyDown[GLFW_KEY_S])
 		g_pCurrentCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+	if (gKeyDown[GLFW_KEY_A])
 		g_pCurrentCamera->ProcessKeyboard(LEFT, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+	if (gKeyDown[GLFW_KEY_D])
 		g_pCurrentCamera->ProcessKeyboard(RIGHT, gDeltaTime);
 
 	float velocity = g_pCurrentCamera->MovementSpeed * gDeltaTime;
-	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+	if (gKeyDown[GLFW_KEY_E])
 		g_pCurrentCamera->Position -= g_pCurrentCamera->Up * velocity;
-	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+	if (gKeyDown[GLFW_KEY_Q])
 		g_pCurrentCamera->Position += g_pCurrentCamera->Up * velocity;
 }
 
+// glfw: whenever a key is pressed or released, this callback is called
+// --------------------------------------------------------------------
+void UKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key < 0 || key > GLFW_KEY_LAST || !UFilterInput(InputKey, key, action, 0.0, 0.0))
+		return;
+
+	if (action == GLFW_PRESS)
+		gKeyDown[key] = true;
+	else if (action == GLFW_RELEASE)
+		gKeyDown[key] = false;
+}
+
+// Live events are logged when recording; during a replay only the logged events get through
+bool UFilterInput(InputEventType type, int code, int action, double x, double y)
+{
+	if (gInputPlayer.IsOpen())
+		return gDispatchingReplay;
+
+	gInputRecorder.Record(type, code, action, x, y);
+	return true;
+}
+
+// Step the simulation by the fixed replay step and feed it the events that are due.
+// Returns false when the log is done.
+bool UReplayInput()
+{
+	static std::vector<InputEvent> due;		// kept between frames so its capacity is reused
+	if (!gInputPlayer.NextFrame(gReplayStep, due))
+		return false;
+
+	// the wall time of a frame is measured, the simulation only sees the fixed step
+	double now = glfwGetTime();
+	if (gReplayLastTime >= 0.0)
+		gFrameTimes.Add(now - gReplayLastTime);
+	gReplayLastTime = now;
+	gDeltaTime = float(gReplayStep);
+
+	gDispatchingReplay = true;
+	for (const InputEvent& event : due)
+	{
+		switch (event.type)
+		{
+		case InputKey:
+			UKeyCallback(gWindow, event.code, 0, event.action, 0);
+			break;
+		case InputCursor:
+			UMousePositionCallback(gWindow, event.x, event.y);
+			break;
+		case InputScroll:
+			UMouseScrollCallback(gWindow, event.x, event.y);
+			break;
+		case InputMouseButton:
+			UMouseButtonCallback(gWindow, event.code, event.action, 0);
+			break;
+		}
+	}
+	gDispatchingReplay = false;
+	return true;
+}
+
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
 {
+	if (!UFilterInput(InputCursor, 0, 0, xpos, ypos))
+		return;
+
 	if (gFirstMouse)
 	{
 		gLastX = xpos;
@@ -410,6 +694,9 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
 // ----------------------------------------------------------------------
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
+	if (!UFilterInput(InputScroll, 0, 0, xoffset, yoffset))
+		return;
+
 	g_pCurrentCamera->ProcessMouseScroll(yoffset);
 }
 
@@ -417,37 +704,40 @@ void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 // --------------------------------
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
+	if (!UFilterInput(InputMouseButton, button, action, 0.0, 0.0))
+		return;
+
 	switch (button)
 	{
 	case GLFW_MOUSE_BUTTON_LEFT:
 	{
 		if (action == GLFW_PRESS)
-			cout << "Left mouse button pressed" << endl;
+			LOG_DEBUG << "Left mouse button pressed";
 		else
-			cout << "Left mouse button released" << endl;
+			LOG_DEBUG << "Left mouse button released";
 	}
 	break;
 
 	case GLFW_MOUSE_BUTTON_MIDDLE:
 	{
 		if (action == GLFW_PRESS)
-			cout << "Middle mouse button pressed" << endl;
+			LOG_DEBUG << "Middle mouse button pressed";
 		else
-			cout << "Middle mouse button released" << endl;
+			LOG_DEBUG << "Middle mouse button released";
 	}
 	break;
 
 	case GLFW_MOUSE_BUTTON_RIGHT:
 	{
 		if (action == GLFW_PRESS)
-			cout << "Right mouse button pressed" << endl;
+			LOG_DEBUG << "Right mouse button pressed";
 		else
-			cout << "Right mouse button released" << endl;
+			LOG_DEBUG << "Right mouse button released";
 	}
 	break;
 
 	default:
-		cout << "Unhandled mouse button event" << endl;
+		LOG_DEBUG << "Unhandled mouse button event";
 		break;
 	}
 }
@@ -456,7 +746,132 @@ void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 void UResizeWindow(GLFWwindow* window, int width, int height)
 {
+	// a minimized window has no pixels; keep the last size until it comes back
+	if (width <= 0 || height <= 0)
+		return;
+
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
 	glViewport(0, 0, width, height);
+	gDynamicResolution.Resize(width, height);
+}
+
+// Point the camera at a regression suite pose and draw one frame
+void URenderPose(const RegressionPose& pose)
+{
+	gCameraFront.Position = pose.position;
+	gCameraFront.Front = glm::normalize(pose.target - pose.position);
+	gCameraFront.Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	gCameraFront.Zoom = pose.fov;
+	g_pCurrentCamera = &gCameraFront;
+
+	gFrameMemory.BeginFrame();
+	URender();
+	gFrameMemory.EndFrame();
+}
+
+// Draw a batch job: its lights and textures stand in for the scene's for one frame
+bool URenderJob(const BatchJob& job, int width, int height)
+{
+	const size_t lightCount = sizeof(gScene.lights) / sizeof(gScene.lights[0]);
+	if (job.lightColors.size() > lightCount)
+	{
+		LOG_ERROR << "ERROR::BATCH::TOO_MANY_LIGHTS " << job.pose.name << " sets " << job.lightColors.size()
+			<< ", the scene has " << lightCount;
+		return false;
+	}
+
+	std::vector<std::pair<size_t, GLuint>> replaced;	// object index, its own texture
+	bool valid = true;
+	for (const auto& texture : job.textures)
+	{
+		auto cached = gBatchTextures.find(texture.second);
+		if (cached == gBatchTextures.end())
+		{
+			GLuint textureId = 0;
+			if (!UCreateTexture(texture.second.c_str(), textureId))
+			{
+				valid = false;
+				break;
+			}
+			cached = gBatchTextures.emplace(texture.second, textureId).first;
+		}
+
+		bool found = false;
+		for (size_t i = 0; i < gScene.objects.size(); ++i)
+		{
+			if (gScene.objects[i].name != texture.first)
+				continue;
+			replaced.emplace_back(i, gScene.objects[i].textureId);
+			gScene.objects[i].textureId = cached->second;
+			found = true;
+		}
+		if (!found)
+		{
+			LOG_ERROR << "ERROR::BATCH::NO_SUCH_OBJECT " << texture.first << " in job " << job.pose.name;
+			valid = false;
+			break;
+		}
+	}
+
+	if (valid)
+	{
+		glm::vec3 colors[lightCount];
+		for (size_t i = 0; i < job.lightColors.size(); ++i)
+		{
+			colors[i] = gScene.lights[i].color;
+			gScene.lights[i].color = job.lightColors[i];
+		}
+
+		// the projection follows the framebuffer size
+		int windowWidth = gFramebufferWidth, windowHeight = gFramebufferHeight;
+		gFramebufferWidth = width;
+		gFramebufferHeight = height;
+		URenderPose(job.pose);
+		gFramebufferWidth = windowWidth;
+		gFramebufferHeight = windowHeight;
+
+		for (size_t i = 0; i < job.lightColors.size(); ++i)
+			gScene.lights[i].color = colors[i];
+	}
+
+	for (auto it = replaced.rbegin(); it != replaced.rend(); ++it)
+		gScene.objects[it->first].textureId = it->second;
+	return valid;
+}
+
+// Reload the scene file when it was saved and apply only what changed
+void UReloadScene(SceneLoader& loader, FileWatcher& watcher)
+{
+	std::vector<std::string> changed;
+	if (!watcher.PollChanges(changed))
+		return;
+
+	double start = glfwGetTime();
+
+	// a file that fails to load leaves the running scene as it is
+	Scene loaded;
+	if (!loader.Load(SCENE_FILENAME, loaded))
+	{
+		LOG_ERROR << "Failed to reload scene " << SCENE_FILENAME << ", keeping the current scene";
+		return;
+	}
+
+	SceneChanges changes = gScene.Merge(loaded);
+
+	// any change can move shadows or bounced light anywhere; the baked
+	// objects go back to live lighting rather than show stale light
+	if (gLightmapTexture && changes.Any())
+	{
+		for (SceneObject& object : gScene.objects)
+			object.lightmapMesh = -1;
+		LOG_INFO << "INFO: Scene changed, baked lighting is off until the next start";
+	}
+
+	LOG_INFO << "INFO: Reloaded " << SCENE_FILENAME << " in " << (glfwGetTime() - start) * 1000.0 << " ms: "
+		<< changes.modified << " modified, " << changes.added << " added, " << changes.removed << " removed"
+		<< (changes.lightingChanged ? ", lighting changed" : "")
+		<< (changes.settingsChanged ? ", render settings changed" : "");
 }
 
 void URender()
@@ -464,828 +879,395 @@ void URender()
 	GLint modelLoc;
 	GLint viewLoc;
 	GLint projLoc;
-	GLint viewPosLoc;
-	GLint ambStrLoc;
-	GLint ambColLoc;
-	GLint light1ColLoc;
-	GLint light1PosLoc;
-	GLint light2ColLoc;
-	GLint light2PosLoc;
-	GLint objColLoc;
-	GLint specIntLoc;
-	GLint highlghtSzLoc;
-	glm::mat4 scale;
-	glm::mat4 rotation;
-	glm::mat4 rotation1;
-	glm::mat4 rotation2;
-	glm::mat4 translation;
+	GLint colorLoc;
+	GLint uvScaleLoc;
 	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 projection;
 
+	// Bring the cached shadow maps up to date (only draws when a light or a caster moved)
+	gGpuTimers.BeginPass(gShadowPass);
+	gShadowMaps.UpdateShadowMaps(gScene, meshes, gShadowProgramId);
+	gGpuTimers.EndPass(gShadowPass);
+
+	// Draw into the scaled target; its size follows the GPU time of earlier frames
+	gDynamicResolution.BeginFrame();
+
 	// Sets the background color of the window to black (it will be implicitely used by glClear)
 	glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	view = g_pCurrentCamera->GetViewMatrix();
-	projection = glm::perspective(glm::radians(g_pCurrentCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	projection = glm::perspective(glm::radians(g_pCurrentCamera->Zoom), (GLfloat)gFramebufferWidth / (GLfloat)gFramebufferHeight, 0.1f, 100.0f);
 
-	// Set the shader to be used
-	glUseProgram(gSurfaceProgramId);
+	// several views split the area one view would fill; every draw below is
+	// then instanced once per view
+	GLsizei viewCount = gMultiView.Count();
+	glm::ivec4 target;
+	if (viewCount > 1)
+	{
+		glGetIntegerv(GL_VIEWPORT, &target[0]);
+		gMultiView.Update(g_pCurrentCamera->Position, g_pCurrentCamera->Front, g_pCurrentCamera->Up,
+			g_pCurrentCamera->Zoom, target, 0.1f, 100.0f);
+		gMultiView.ApplyViewports();
+	}
 
-	// Retrieves and passes transform matrices to the Shader program
-	modelLoc = glGetUniformLocation(gSurfaceProgramId, "model");
-	viewLoc = glGetUniformLocation(gSurfaceProgramId, "view");
-	projLoc = glGetUniformLocation(gSurfaceProgramId, "projection");
-	viewPosLoc = glGetUniformLocation(gSurfaceProgramId, "viewPosition");
-	ambStrLoc = glGetUniformLocation(gSurfaceProgramId, "ambientStrength");
-	ambColLoc = glGetUniformLocation(gSurfaceProgramId, "ambientColor");
-	light1ColLoc = glGetUniformLocation(gSurfaceProgramId, "light1Color");
-	light1PosLoc = glGetUniformLocation(gSurfaceProgramId, "light1Position");
-	light2ColLoc = glGetUniformLocation(gSurfaceProgramId, "light2Color");
-	light2PosLoc = glGetUniformLocation(gSurfaceProgramId, "light2Position");
-	objColLoc = glGetUniformLocation(gSurfaceProgramId, "objectColor");
-	specIntLoc = glGetUniformLocation(gSurfaceProgramId, "specularIntensity");
-	highlghtSzLoc = glGetUniformLocation(gSurfaceProgramId, "highlightSize");
+	// Lights that contribute at all, in scene order; a variant with fewer
+	// lights than the scene skips the dark ones
+	int activeLights[ShaderVariants::MAX_LIGHTS];
+	int activeCount = 0;
+	for (int i = 0; i < ShaderVariants::MAX_LIGHTS; ++i)
+	{
+		if (gScene.lights[i].color != glm::vec3(0.0f))
+			activeLights[activeCount++] = i;
+	}
 
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+	// Build this frame's draw list in the frame arena: the objects inside the
+	// view frustum with their model matrices and surface variants, in scene order
+	struct DrawItem
+	{
+		const SceneObject* object;
+		glm::mat4 model;
+		Meshes::MeshType mesh;	// the baked copy when there is one
+		GLuint program;		// 0 for light objects
+		GLuint texture;		// resolved by the texture streamer, 0 for none
+	};
+	Frustum frustum = Frustum::FromMatrix(projection * view);
+	DrawItem* drawList = gFrameMemory.Arena().AllocateArray<DrawItem>(gScene.objects.size());
+	size_t drawCount = 0;
+	for (const SceneObject& object : gScene.objects)
+	{
+		model = object.ModelMatrix();
+		const Bounds& bounds = meshes.GetMesh(object.mesh).bounds;
+		Bounds world = bounds.IsEmpty() ? bounds : bounds.Transformed(model);
+		if (!bounds.IsEmpty() && !(viewCount > 1 ? gMultiView.IsVisible(world) : frustum.Intersects(world)))
+			continue;
+
+		// the screen height of the bounding sphere picks the mips the texture needs
+		GLuint texture = 0;
+		if (object.textureId)
+		{
+			float pixels = 0.0f;
+			if (!bounds.IsEmpty())
+			{
+				float radius = glm::length(world.Extents());
+				float distance = glm::max(glm::distance(world.Center(), g_pCurrentCamera->Position) - radius, 0.1f);
+				pixels = radius / (distance * glm::tan(glm::radians(g_pCurrentCamera->Zoom) * 0.5f)) * gFramebufferHeight;
+			}
+			texture = gTextureStreamer.Use(object.textureId, pixels, glm::max(object.uvScale.x, object.uvScale.y));
+		}
 
-	//*******************************
-	// Configure the light properties
-	//*******************************
-	//set the camera view location
-	glUniform3f(viewPosLoc, g_pCurrentCamera->Position.x, g_pCurrentCamera->Position.y, g_pCurrentCamera->Position.z);
-	//set ambient lighting strength
-	glUniform1f(ambStrLoc, 0.2f);
-	//set ambient color
-	glUniform3f(ambColLoc, 0.3f, 0.3f, 0.3f);
-	glUniform3f(light1ColLoc, 0.4f, 0.4f, 0.4f);
-	glUniform3f(light1PosLoc, -2.0f, 4.0f, -0.5f);
-	glUniform3f(light2ColLoc, 0.4f, 0.4f, 0.4f);	//green
-	glUniform3f(light2PosLoc, 2.0f, 4.0f, -0.5f);
-	//set specular intensity
-	glUniform1f(specIntLoc, 1.0f);
-	//set specular highlight size
-	glUniform1f(highlghtSzLoc, 16.0f);
-
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
-	//*************************************
-	// Render the table plane
-	//*************************************
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(2.0f, 1.0f, 1.0f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.0f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTableTextureId);
-
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-	glBindVertexArray(0);
+		drawList[drawCount].object = &object;
+		drawList[drawCount].model = model;
+		drawList[drawCount].mesh = object.lightmapMesh >= 0 ? Meshes::MeshType(object.lightmapMesh) : object.mesh;
+		drawList[drawCount].program = object.isLight ? 0 : USurfaceProgram(object, activeCount);
+		drawList[drawCount].texture = texture;
+		++drawCount;
+	}
 
 	//*************************************
-	// Render the lamp
+	// Depth pre-pass
 	//*************************************
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCubeMesh.vao);
-	////////////////////////////////
-	// lamp bottom base
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.55f, 0.07f, 0.55f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.03f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp base 2
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.51f, 0.016f, 0.51f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.07f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp base 3
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.49f, 0.06f, 0.49f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.105f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box bottom pieces - front
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.451f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.17f, -0.770f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box bottom pieces - back
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.451f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.17f, -1.228f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box bottom pieces - right
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.4645f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.228f, 0.17f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box bottom pieces - left
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.4645f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(-0.228f, 0.17f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - front left
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(-0.194f, 0.44f, -0.770f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - front right
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.19f, 0.44f, -0.770f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - back left
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(-0.194f, 0.44f, -1.228f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - back right
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.19f, 0.44f, -1.228f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - left right
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(-0.2285f, 0.44f, -0.803f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - left left
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(-0.2285f, 0.44f, -1.195f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - right left
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.228f, 0.44f, -0.803f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box side pieces - right right
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.5f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.228f, 0.44f, -1.195f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box top pieces - front
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.451f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, .725f, -0.770f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box top pieces - back
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.451f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, .725f, -1.228f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box top pieces - right
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.4645f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.228f, .725f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// lamp box top pieces - left
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.4645f, 0.07f, 0.005f));
-	// 2. Rotates shape
-	rotation = glm::rotate(7.85f, glm::vec3(0.0, 1.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(-0.228f, .725f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-	////////////////////////////////
-	// top of lamp base
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.55f, 0.07f, 0.55f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.725f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
+	// Only depth is written, with a position only program, so the lit pass
+	// below runs the lighting shader once per visible pixel instead of once
+	// per overlapping fragment. Lights are drawn unlit and are left out.
+	if (gScene.depthPrepass)
+	{
+		gGpuTimers.BeginPass(gDepthPass);
+		GLuint depthProgram = viewCount > 1 ? gMultiViewDepthProgramId : gDepthProgramId;
+		glUseProgram(depthProgram);
+		modelLoc = glGetUniformLocation(depthProgram, "model");
+		viewLoc = glGetUniformLocation(depthProgram, "view");
+		projLoc = glGetUniformLocation(depthProgram, "projection");
+		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+		glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+		if (viewCount > 1)
+			gMultiView.SetUniforms(depthProgram);
+
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		for (size_t i = 0; i < drawCount; ++i)
+		{
+			if (drawList[i].object->isLight)
+				continue;
+			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(drawList[i].model));
+			meshes.DrawMesh(drawList[i].mesh, viewCount);
+		}
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-	//*************************************
-	// Render the lamp base top
-	//*************************************
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPyramidMesh.vao);
-	////////////////////////////////
-	// lamp bottom base top
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.55f, 0.2f, 0.55f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.860f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawElements(GL_TRIANGLES, meshes.gPyramidMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-
-	glBindVertexArray(meshes.gCubeMesh.vao);
-	////////////////////////////////
-	// lamp bottom base first cube
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.3f, 0.15f, 0.3f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.840f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
-
-
-	////////////////////////////////
-	// top of lamp base 
-	////////////////////////////////
-	glBindVertexArray(meshes.gCubeMesh.vao);
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.25f, 0.20f, 0.25f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 1.0f, 1.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.880f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gCubeMesh.nVertices);
+		// the depth buffer is final for these objects: shade only the
+		// fragments that won, and leave the depth as it is
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+		gGpuTimers.EndPass(gDepthPass);
+	}
 
-	//*************************************
-	// Render the lamp hosel
-	//*************************************
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-	////////////////////////////////
-	// lamp hosel
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.03f, 0.3f, 0.03f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 0.900f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gLampTextureId);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);
+	gGpuTimers.BeginPass(gSurfacePass);
+
+	// bind the shadow maps of the active lights to texture units 1 and 2
+	for (int i = 0; i < activeCount; ++i)
+		glBindTextureUnit(1 + i, gShadowMaps.GetShadowTexture(activeLights[i]));
+	if (gLightmapTexture)
+		glBindTextureUnit(3, gLightmapTexture.Get());
 
 	//*************************************
-	// Render the light bulb
+	// Render the table and the lamp
 	//*************************************
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gSphereMesh.vao);
-	////////////////////////////////
-	// light bulb
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.07f, 0.08f, 0.07f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 1.18f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gBulbTextureId);
-
-	glDrawElements(GL_TRIANGLES, meshes.gSphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	// Objects are drawn grouped by variant, so each program gets the frame's
+	// uniforms once. An item's program is cleared once it is drawn.
+	for (size_t first = 0; first < drawCount; ++first)
+	{
+		GLuint program = drawList[first].program;
+		if (program == 0)
+			continue;
+
+		// Set the shader to be used
+		glUseProgram(program);
+
+		// Retrieves and passes transform matrices to the Shader program
+		modelLoc = glGetUniformLocation(program, "model");
+		viewLoc = glGetUniformLocation(program, "view");
+		projLoc = glGetUniformLocation(program, "projection");
+		colorLoc = glGetUniformLocation(program, "objectColor");
+		uvScaleLoc = glGetUniformLocation(program, "uvScale");
+
+		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+		glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+		if (viewCount > 1)
+			gMultiView.SetUniforms(program);
+
+		//*******************************
+		// Configure the light properties
+		//*******************************
+		// uniforms a variant compiled out have location -1 and are ignored
+		//set the camera view location
+		glUniform3fv(glGetUniformLocation(program, "viewPosition"), 1, glm::value_ptr(g_pCurrentCamera->Position));
+		//set ambient lighting strength and color
+		glUniform1f(glGetUniformLocation(program, "ambientStrength"), gScene.ambientStrength);
+		glUniform3fv(glGetUniformLocation(program, "ambientColor"), 1, glm::value_ptr(gScene.ambientColor));
+		//set specular intensity and highlight size
+		glUniform1f(glGetUniformLocation(program, "specularIntensity"), gScene.specularIntensity);
+		glUniform1f(glGetUniformLocation(program, "highlightSize"), gScene.highlightSize);
+
+		const char* const LIGHT_UNIFORMS[ShaderVariants::MAX_LIGHTS][3] = {
+			{ "light1Color", "light1Position", "light1Space" },
+			{ "light2Color", "light2Position", "light2Space" },
+		};
+		for (int i = 0; i < activeCount; ++i)
+		{
+			const SceneLight& light = gScene.lights[activeLights[i]];
+			glUniform3fv(glGetUniformLocation(program, LIGHT_UNIFORMS[i][0]), 1, glm::value_ptr(light.color));
+			glUniform3fv(glGetUniformLocation(program, LIGHT_UNIFORMS[i][1]), 1, glm::value_ptr(light.position));
+			glUniformMatrix4fv(glGetUniformLocation(program, LIGHT_UNIFORMS[i][2]), 1, GL_FALSE,
+				glm::value_ptr(gShadowMaps.GetLightSpaceMatrix(activeLights[i])));
+		}
+
+		for (size_t i = first; i < drawCount; ++i)
+		{
+			if (drawList[i].program != program)
+				continue;
+			drawList[i].program = 0;
+			const SceneObject& object = *drawList[i].object;
 
+			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(drawList[i].model));
+			glUniform2f(uvScaleLoc, object.uvScale.x, object.uvScale.y);
+			glUniform3fv(colorLoc, 1, glm::value_ptr(object.color));
 
-	//*************************************
-// Render the lamp shade
-//*************************************
-// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTaperedCylinderMesh.vao);
-	////////////////////////////////
-	// lamp shade
-	////////////////////////////////
-	// 1. Scales the object
-	scale = glm::scale(glm::vec3(0.4f, 0.5f, 0.4f));
-	// 2. Rotates shape
-	rotation = glm::rotate(0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. translate shape
-	translation = glm::translate(glm::vec3(0.0f, 1.18f, -1.0f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniform2f(glGetUniformLocation(gSurfaceProgramId, "uvScale"), 1.0f, 1.0f);
-
-	// bind textures on corresponding texture units
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gShadeTextureId);
-
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146); // for rendering the sides
+			// bind textures on corresponding texture units
+			if (drawList[i].texture)
+				glBindTextureUnit(0, drawList[i].texture);
+
+			meshes.DrawMesh(drawList[i].mesh, viewCount);
+		}
+	}
+
+	if (gScene.depthPrepass)
+	{
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+	gGpuTimers.EndPass(gSurfacePass);
 
 	//*************************************
 	// Render the 2 light objects
 	//*************************************
+	gGpuTimers.BeginPass(gLightPass);
+
 	// Set the shader to be used
-	glUseProgram(gLightProgramId);
+	GLuint lightProgram = viewCount > 1 ? gMultiViewLightProgramId : gLightProgramId;
+	glUseProgram(lightProgram);
 
 	// Retrieves and passes transform matrices to the Shader program
-	modelLoc = glGetUniformLocation(gLightProgramId, "model");
-	viewLoc = glGetUniformLocation(gLightProgramId, "view");
-	projLoc = glGetUniformLocation(gLightProgramId, "projection");
+	modelLoc = glGetUniformLocation(lightProgram, "model");
+	viewLoc = glGetUniformLocation(lightProgram, "view");
+	projLoc = glGetUniformLocation(lightProgram, "projection");
 
 	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+	if (viewCount > 1)
+		gMultiView.SetUniforms(lightProgram);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPyramidMesh.vao);
-
-	// 1. Scales the object by 2
-	scale = glm::scale(glm::vec3(.3f, .3f, .3f));
-	// 2. Rotates shape by 15 degrees in the x axis
-	rotation = glm::rotate(-0.2f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Place object at the origin
-	translation = glm::translate(glm::vec3(-1.0f, 6.0f, .7f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
-
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	for (size_t i = 0; i < drawCount; ++i)
+	{
+		const SceneObject& object = *drawList[i].object;
+		if (!object.isLight)
+			continue;
 
-	//glDrawArrays(GL_TRIANGLES, 0, gPyramidMesh.nVertices);
-	glDrawElements(GL_TRIANGLES, meshes.gPyramidMesh.nIndices, GL_UNSIGNED_INT, NULL);
+		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(drawList[i].model));
 
-	// 1. Scales the object by 2
-	scale = glm::scale(glm::vec3(.3f, .3f, .3f));
-	// 2. Rotates shape by 15 degrees in the x axis
-	rotation = glm::rotate(-0.2f, glm::vec3(1.0, 0.0f, 0.0f));
-	// 3. Place object at the origin
-	translation = glm::translate(glm::vec3(1.0f, 6.0f, .7f));
-	// Model matrix: transformations are applied right-to-left order
-	model = translation * rotation * scale;
+		meshes.DrawMesh(object.mesh, viewCount);
+	}
 
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	gGpuTimers.EndPass(gLightPass);
 
-	//glDrawArrays(GL_TRIANGLES, 0, gPyramidMesh.nVertices);
-	glDrawElements(GL_TRIANGLES, meshes.gPyramidMesh.nIndices, GL_UNSIGNED_INT, NULL);
+	// back to one viewport for the upscale and the next frame's shadows
+	if (viewCount > 1)
+		glViewport(target.x, target.y, target.z, target.w);
 
 	glBindVertexArray(0);
 
 	glUseProgram(0);
 
+	// Upscale the scaled target to the window
+	gDynamicResolution.EndFrame();
+	gGpuTimers.EndFrame();
+
+	// queue a copy of the finished frame; the pixels are read a few frames later
+	gFrameCapture.CaptureFrame();
+
 	// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 	glfwSwapBuffers(gWindow);    // Flips the the back buffer with the front buffer every frame.
+
+	// swap in the texture levels that finished loading, load the ones this frame wanted
+	gTextureStreamer.Update();
 }
 
-// Implements the UCreateShaders function
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId)
+///////////////////////////////////////////////////
+//	USurfaceProgram(const SceneObject&, int)
+//
+//	object: object to draw with the surface shader
+//	lightCount: lights of the scene that give light
+//
+//	Pick the cheapest variant that draws the object
+//	the way its material asks: unlit objects skip
+//	the lighting, untextured ones the texture fetch
+///////////////////////////////////////////////////
+GLuint USurfaceProgram(const SceneObject& object, int lightCount)
 {
-	// Compilation and linkage error reporting
-	int success = 0;
-	char infoLog[512];
-
-	// Create a Shader program object.
-	programId = glCreateProgram();
-
-	// Create the vertex and fragment shader objects
-	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Retrive the shader source
-	glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
-	glShaderSource(fragmentShaderId, 1, &fragShaderSource, NULL);
-
-	// Compile the vertex shader, and print compilation errors (if any)
-	glCompileShader(vertexShaderId); // compile the vertex shader
-	// check for shader compile errors
-	glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-
-		return false;
-	}
+	ShaderFeatures features;
+	features.lightCount = object.isUnlit ? 0 : lightCount;
+	features.textured = object.textureId != 0;
+	features.specular = features.lightCount > 0 && object.hasSpecular && gScene.specularIntensity > 0.0f;
+	features.lightmapped = features.lightCount > 0 && object.lightmapMesh >= 0;
+	features.viewCount = gMultiView.Count();
+
+	// a variant that failed to compile falls back to the full one
+	ShaderFeatures full;
+	full.viewCount = features.viewCount;
+	GLuint program = gSurfaceVariants.GetProgram(features);
+	return program ? program : gSurfaceVariants.GetProgram(full);
+}
 
-	glCompileShader(fragmentShaderId); // compile the fragment shader
-	// check for shader compile errors
-	glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
-	if (!success)
+///////////////////////////////////////////////////
+//	UBakeLightmap()
+//
+//	When the scene asks for it, path trace the light
+//	on the static built-in meshes into a lightmap and
+//	give each baked object a copy of its mesh with
+//	lightmap coords. Objects that move, lights and
+//	loaded meshes, which keep no CPU triangles, stay
+//	lit live
+///////////////////////////////////////////////////
+void UBakeLightmap()
+{
+	if (!gScene.bakeLightmap)
+		return;
+	double start = glfwGetTime();
+
+	MeshData triangles[Meshes::MeshTypeCount];
+	std::vector<LightmapInstance> instances;
+	std::vector<SceneObject*> bakedObjects;		// per instance, null for occluders
+	for (SceneObject& object : gScene.objects)
 	{
-		glGetShaderInfoLog(fragmentShaderId, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-
-		return false;
+		if (object.isDynamic || object.isLight || object.mesh >= Meshes::MeshTypeCount)
+			continue;
+		MeshData& mesh = triangles[object.mesh];
+		if (mesh.vertices.empty())
+			Meshes::GenerateTriangles(object.mesh, mesh);
+
+		LightmapInstance instance;
+		instance.triangles = &mesh;
+		instance.model = object.ModelMatrix();
+		instance.albedo = object.textureId ? UAverageTextureColor(gTextureStreamer.GetTexture(object.textureId)) : object.color;
+		instance.baked = !object.isUnlit;
+		instances.push_back(instance);
+		bakedObjects.push_back(instance.baked ? &object : nullptr);
 	}
 
-	// Attached compiled shaders to the shader program
-	glAttachShader(programId, vertexShaderId);
-	glAttachShader(programId, fragmentShaderId);
+	LightmapLight lights[2];
+	for (int i = 0; i < 2; ++i)
+		lights[i] = { gScene.lights[i].position, gScene.lights[i].color };
 
-	glLinkProgram(programId);   // links the shader program
-	// check for linking errors
-	glGetProgramiv(programId, GL_LINK_STATUS, &success);
-	if (!success)
+	Lightmap lightmap;
+	ThreadPool pool;
+	if (!BakeLightmap(instances, lights, 2, gScene.lightmapSettings, pool, lightmap))
 	{
-		glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-
-		return false;
+		LOG_ERROR << "Failed to bake the lightmap, the scene is lit live";
+		return;
 	}
 
-	glUseProgram(programId);    // Uses the shader program
-
-	return true;
-}
+	gLightmapTexture = CreateTexture2D(GpuCategory::Texture, "lightmap", GL_RGBA16F, lightmap.size, lightmap.size, 1,
+		GL_RGBA, GL_FLOAT, lightmap.texels.data());
 
+	int bakedCount = 0;
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		if (!bakedObjects[i])
+			continue;
+		bakedObjects[i]->lightmapMesh = meshes.AddMesh(lightmap.meshes[i], "lightmap chart");
+		++bakedCount;
+	}
 
-void UDestroyShaderProgram(GLuint programId)
-{
-	glDeleteProgram(programId);
+	LOG_INFO << "INFO: Baked the light of " << bakedCount << " objects into a " << lightmap.size << "x" << lightmap.size
+		<< " lightmap on " << pool.ThreadCount() << " threads in " << (glfwGetTime() - start) * 1000.0 << " ms";
 }
 
-// Images are loaded with Y axis going down, but OpenGL's Y axis goes up, so let's flip it
-void flipImageVertically(unsigned char* image, int width, int height, int channels)
+// Mean color of a mipmapped texture: its 1x1 top level
+glm::vec3 UAverageTextureColor(GLuint textureId)
 {
-	for (int j = 0; j < height / 2; ++j)
-	{
-		int index1 = j * width * channels;
-		int index2 = (height - 1 - j) * width * channels;
-
-		for (int i = width * channels; i > 0; --i)
-		{
-			unsigned char tmp = image[index1];
-			image[index1] = image[index2];
-			image[index2] = tmp;
-			++index1;
-			++index2;
-		}
-	}
+	GLint width = 0, height = 0;
+	glGetTextureLevelParameteriv(textureId, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(textureId, 0, GL_TEXTURE_HEIGHT, &height);
+	GLint level = MipLevelCount(width, height) - 1;
+
+	glm::vec3 color(1.0f);
+	glGetTextureImage(textureId, level, GL_RGB, GL_FLOAT, GLsizei(sizeof(color)), &color[0]);
+	return color;
 }
 
 /*Generate and load the texture*/
+// textureId is the streamer's id, not a GL texture; wrapping and filtering
+// come from the Repeat sampler of unit 0
 bool UCreateTexture(const char* filename, GLuint& textureId)
 {
-	int width, height, channels;
-	unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-	if (image)
-	{
-		flipImageVertically(image, width, height, channels);
-
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		else if (channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			cout << "Not implemented to handle image with " << channels << " channels" << endl;
-			return false;
-		}
-
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		return true;
-	}
-
-	// Error loading the image
-	return false;
+	textureId = gTextureStreamer.Add(filename);
+	return textureId != 0;
 }
 
 
 void UDestroyTexture(GLuint textureId)
 {
-	glGenTextures(1, &textureId);
+	gTextureStreamer.Remove(textureId);
+}
+
+// SceneLoader::MeshLoader: .mesh files are mapped, anything else imported
+int ULoadMesh(const char* filename)
+{
+	const char* dot = strrchr(filename, '.');
+	return dot && strcmp(dot, ".mesh") == 0 ? meshes.LoadMeshFile(filename) : meshes.ImportMesh(filename);
+}
+
+int UGenerateMesh(Meshes::MeshType type, int segments, int rings)
+{
+	return meshes.GenerateMesh(type, segments, rings);
 }
 
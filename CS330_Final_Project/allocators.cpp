@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocators.cpp
+// ========
+// arena allocators and heap allocation counters
+///////////////////////////////////////////////////////////////////////////////
+
+#include "allocators.h"
+#include "logging.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> gHeapAllocations(0);
+	std::atomic<uint64_t> gHeapBytes(0);
+
+	const size_t SCRATCH_ARENA_BYTES = 256 * 1024;
+
+	size_t UAlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+// The array and nothrow forms of the default operators call these, so
+// replacing them counts every allocation made with new
+void* operator new(size_t bytes)
+{
+	gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	gHeapBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+	void* memory = malloc(bytes ? bytes : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+// a replaced unsized delete needs the sized one beside it, or sized deletes
+// free through the library's
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+HeapCounters GetHeapCounters()
+{
+	HeapCounters counters;
+	counters.allocations = gHeapAllocations.load(std::memory_order_relaxed);
+	counters.bytes = gHeapBytes.load(std::memory_order_relaxed);
+	return counters;
+}
+
+LinearArena::LinearArena(size_t capacity)
+{
+	Block first = { static_cast<unsigned char*>(::operator new(capacity)), capacity, 0 };
+	blocks.reserve(8);
+	blocks.push_back(first);
+}
+
+LinearArena::~LinearArena()
+{
+	for (const Block& block : blocks)
+		::operator delete(block.memory);
+}
+
+///////////////////////////////////////////////////
+//	Allocate(size_t, size_t)
+//
+//	bytes: size of the allocation
+//	alignment: power of two alignment
+//
+//	Bump allocate from the last block, or start an
+//	overflow block at least twice the size of the
+//	last one when it is full
+///////////////////////////////////////////////////
+void* LinearArena::Allocate(size_t bytes, size_t alignment)
+{
+	++allocations;
+
+	Block* block = &blocks.back();
+	uintptr_t base = reinterpret_cast<uintptr_t>(block->memory);
+	size_t offset = UAlignUp(base + block->used, alignment) - base;
+	if (offset + bytes > block->size)
+	{
+		size_t size = block->size * 2;
+		while (size < bytes + alignment)
+			size *= 2;
+		Block overflow = { static_cast<unsigned char*>(::operator new(size)), size, 0 };
+		blocks.push_back(overflow);
+
+		block = &blocks.back();
+		base = reinterpret_cast<uintptr_t>(block->memory);
+		offset = UAlignUp(base, alignment) - base;
+	}
+
+	block->used = offset + bytes;
+	size_t used = Used();
+	if (used > highWater)
+		highWater = used;
+	return block->memory + offset;
+}
+
+ArenaMark LinearArena::Mark() const
+{
+	ArenaMark mark;
+	mark.block = blocks.size() - 1;
+	mark.used = blocks.back().used;
+	return mark;
+}
+
+///////////////////////////////////////////////////
+//	Rewind(const ArenaMark&)
+//
+//	mark: position returned by Mark()
+//
+//	Drop the overflow blocks started after the mark.
+//	When the arena ends up empty after overflowing,
+//	replace the first block by one that holds the
+//	peak use, so the overflow does not repeat
+///////////////////////////////////////////////////
+void LinearArena::Rewind(const ArenaMark& mark)
+{
+	while (blocks.size() > mark.block + 1)
+	{
+		::operator delete(blocks.back().memory);
+		blocks.pop_back();
+	}
+	blocks.back().used = mark.used;
+
+	if (mark.block == 0 && mark.used == 0)
+	{
+		allocations = 0;
+		if (highWater > blocks[0].size)
+		{
+			size_t size = UAlignUp(highWater + highWater / 4, 4096);
+			::operator delete(blocks[0].memory);
+			blocks[0].memory = static_cast<unsigned char*>(::operator new(size));
+			blocks[0].size = size;
+		}
+	}
+}
+
+size_t LinearArena::Used() const
+{
+	size_t used = 0;
+	for (const Block& block : blocks)
+		used += block.used;
+	return used;
+}
+
+LinearArena& ScratchArena()
+{
+	thread_local LinearArena arena(SCRATCH_ARENA_BYTES);
+	return arena;
+}
+
+void FrameMemory::BeginFrame()
+{
+	arena.Reset();
+	frameStart = GetHeapCounters();
+}
+
+void FrameMemory::EndFrame()
+{
+	HeapCounters now = GetHeapCounters();
+	lastAllocations = now.allocations - frameStart.allocations;
+	uint64_t bytes = now.bytes - frameStart.bytes;
+
+	++frames;
+	if (lastAllocations > 0)
+	{
+		++framesWithAllocations;
+		lastFrameWithAllocations = frames;
+	}
+	if (lastAllocations > maxAllocations)
+		maxAllocations = lastAllocations;
+	if (bytes > maxBytes)
+		maxBytes = bytes;
+	if (arena.Allocations() > arenaAllocations)
+		arenaAllocations = arena.Allocations();
+}
+
+void FrameMemory::Report(const char* label) const
+{
+	LOG_INFO << "INFO: " << label << ": " << frames << " frames, " << framesWithAllocations
+		<< " with heap allocations (last in frame " << lastFrameWithAllocations << "), worst frame "
+		<< maxAllocations << " allocations " << maxBytes << " bytes; frame arena peak " << arena.HighWater()
+		<< " bytes in up to " << arenaAllocations << " allocations";
+}
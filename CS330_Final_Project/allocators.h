@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocators.h
+// ========
+// arena allocators and heap allocation counters
+//
+// LinearArena hands out memory by bumping an offset and frees it all at once.
+// The frame arena is reset at the start of every frame and holds per frame
+// data such as the draw list; the scratch arena of each thread holds the
+// temporaries of load time work such as mesh generation and is rewound by
+// ArenaScope. Scene objects need no pool: they live by value in one vector
+// that is only resized when the scene file is loaded.
+//
+// All operator new calls of the process are counted, so FrameMemory can tell
+// how many heap allocations each frame made. The goal for a steady state
+// frame is zero.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Process wide operator new totals since startup, all threads
+struct HeapCounters
+{
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+};
+
+HeapCounters GetHeapCounters();
+
+// Position in a LinearArena to rewind to
+struct ArenaMark
+{
+	size_t block = 0;		// 0 is the first block, then the overflow blocks
+	size_t used = 0;
+};
+
+class LinearArena
+{
+public:
+	// capacity: bytes of the first block. When it runs out, overflow blocks
+	// are taken from the heap, and once the arena is empty again the first
+	// block grows past the peak use, so the next cycle of the same size
+	// makes no heap allocation.
+	explicit LinearArena(size_t capacity);
+	~LinearArena();
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	// Uninitialized storage for count objects; only for trivially destructible types
+	template <class T>
+	T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+	// Free everything
+	void Reset() { Rewind(ArenaMark()); }
+
+	// Free everything allocated after Mark() was called
+	ArenaMark Mark() const;
+	void Rewind(const ArenaMark& mark);
+
+	size_t Capacity() const { return blocks[0].size; }
+	size_t Used() const;
+	size_t HighWater() const { return highWater; }
+	uint64_t Allocations() const { return allocations; }	// since the arena was last empty
+
+private:
+	struct Block
+	{
+		unsigned char* memory;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Block> blocks;			// more than one only until the arena is empty again
+	size_t highWater = 0;
+	uint64_t allocations = 0;
+};
+
+// Rewinds an arena to where it was when the scope was entered
+class ArenaScope
+{
+public:
+	explicit ArenaScope(LinearArena& arena) : arena(arena), mark(arena.Mark()) {}
+	~ArenaScope() { arena.Rewind(mark); }
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+	LinearArena& arena;
+	ArenaMark mark;
+};
+
+// Arena of the calling thread for temporary load time data
+LinearArena& ScratchArena();
+
+// Frame arena plus per frame heap allocation statistics
+class FrameMemory
+{
+public:
+	explicit FrameMemory(size_t arenaBytes) : arena(arenaBytes) {}
+
+	LinearArena& Arena() { return arena; }
+
+	// Reset the frame arena and start counting heap allocations
+	void BeginFrame();
+	// Record what the frame allocated
+	void EndFrame();
+
+	uint64_t LastFrameAllocations() const { return lastAllocations; }
+
+	// One line summary: frames that touched the heap, the worst frame and
+	// the arena peak
+	void Report(const char* label) const;
+
+private:
+	LinearArena arena;
+	HeapCounters frameStart;
+	uint64_t frames = 0;
+	uint64_t framesWithAllocations = 0;
+	uint64_t lastFrameWithAllocations = 0;
+	uint64_t lastAllocations = 0;
+	uint64_t maxAllocations = 0;
+	uint64_t maxBytes = 0;
+	uint64_t arenaAllocations = 0;
+};
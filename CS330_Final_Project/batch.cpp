@@ -0,0 +1,297 @@
+///////////////////////////////////////////////////////////////////////////////
+// batch.cpp
+// ========
+// renders a job file of scene variants to still images without restarting
+///////////////////////////////////////////////////////////////////////////////
+
+#include "batch.h"
+#include "fileutils.h"
+#include "gpuresources.h"
+#include "imageio.h"
+#include "json.h"
+#include "logging.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const unsigned WRITER_THREADS = 2;
+	// read back images waiting for a writer; past this the render thread waits
+	const int MAX_PENDING_WRITES = 16;
+	// a claim this old was left by a process that stopped mid-job; one job
+	// takes a frame and an encode, far below this
+	const int STALE_CLAIM_SECONDS = 600;
+
+	// Create an empty file, failing when it exists: atomic between processes
+	bool UCreateExclusive(const std::string& path)
+	{
+#ifdef _WIN32
+		int file = _open(path.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY, _S_IREAD | _S_IWRITE);
+		if (file < 0)
+			return false;
+		_close(file);
+#else
+		int file = open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+		if (file < 0)
+			return false;
+		close(file);
+#endif
+		return true;
+	}
+
+	// Claim a job, taking over a claim a dead process left behind
+	bool UClaim(const std::string& path, int& reclaimed)
+	{
+		if (UCreateExclusive(path))
+			return true;
+
+		std::error_code error;
+		std::filesystem::file_time_type written = std::filesystem::last_write_time(path, error);
+		if (error || std::filesystem::file_time_type::clock::now() - written < std::chrono::seconds(STALE_CLAIM_SECONDS))
+			return false;
+
+		// two processes taking over together may both render the job; they
+		// write the same image
+		std::filesystem::remove(path, error);
+		if (!UCreateExclusive(path))
+			return false;
+		LOG_WARNING << "WARNING::BATCH::STALE_CLAIM taking over " << path;
+		++reclaimed;
+		return true;
+	}
+
+	bool UFileExists(const std::string& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return bool(in);
+	}
+
+	// Read a required [x, y, z]
+	bool UReadVec3(const JsonValue& json, glm::vec3& value)
+	{
+		if (!json.IsArray() || json.Size() != 3)
+			return false;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (!json[i].IsNumber())
+				return false;
+			value[i] = float(json[i].number);
+		}
+		return true;
+	}
+}
+
+bool BatchRenderer::Load(const char* filename)
+{
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+	{
+		LOG_ERROR << "ERROR::BATCH::CANNOT_OPEN " << filename;
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	std::string text = buffer.str();
+
+	JsonValue document;
+	std::string error;
+	if (!ParseJson(text.data(), text.size(), document, &error))
+	{
+		LOG_ERROR << "ERROR::BATCH::BAD_JSON " << filename << ": " << error;
+		return false;
+	}
+
+	outputDirectory = document.GetString("output", outputDirectory.c_str());
+	width = document.GetInt("width", width);
+	height = document.GetInt("height", height);
+	if (width <= 0 || height <= 0)
+	{
+		LOG_ERROR << "ERROR::BATCH::BAD_SIZE " << width << "x" << height;
+		return false;
+	}
+
+	const JsonValue* list = document.Find("jobs");
+	if (!list || !list->IsArray() || list->Size() == 0)
+	{
+		LOG_ERROR << "ERROR::BATCH::NO_JOBS";
+		return false;
+	}
+
+	jobs.clear();
+	for (const JsonValue& json : list->items)
+	{
+		BatchJob job;
+		job.pose.name = json.GetString("name", "");
+		job.pose.fov = float(json.GetNumber("fov", 45.0));
+		const JsonValue* position = json.Find("position");
+		const JsonValue* target = json.Find("target");
+		bool valid = !job.pose.name.empty() && position && target && UReadVec3(*position, job.pose.position) &&
+			UReadVec3(*target, job.pose.target);
+
+		if (const JsonValue* colors = json.Find("lightColors"))
+		{
+			valid = valid && colors->IsArray();
+			for (size_t i = 0; valid && i < colors->Size(); ++i)
+			{
+				glm::vec3 color;
+				valid = UReadVec3((*colors)[i], color);
+				job.lightColors.push_back(color);
+			}
+		}
+		if (const JsonValue* textures = json.Find("textures"))
+		{
+			valid = valid && textures->IsObject();
+			for (const auto& member : textures->members)
+			{
+				valid = valid && member.second.IsString();
+				job.textures.emplace_back(member.first, member.second.string);
+			}
+		}
+
+		if (!valid)
+		{
+			LOG_ERROR << "ERROR::BATCH::BAD_JOB " << job.pose.name;
+			return false;
+		}
+		jobs.push_back(std::move(job));
+	}
+	return true;
+}
+
+bool BatchRenderer::ChangesLights() const
+{
+	return std::any_of(jobs.begin(), jobs.end(), [](const BatchJob& job) { return !job.lightColors.empty(); });
+}
+
+///////////////////////////////////////////////////
+//	Run(JobRenderer, double)
+//
+//	render: draws one job
+//	startupSeconds: time to get to the first job
+//
+//	A claimed job is looked up on disk after the
+//	claim, never before: a process that finished
+//	it wrote the image before dropping its claim,
+//	so the job is either seen done or still held
+///////////////////////////////////////////////////
+bool BatchRenderer::Run(JobRenderer render, double startupSeconds)
+{
+	if (!MakeDirectories(outputDirectory))
+	{
+		LOG_ERROR << "ERROR::BATCH::CANNOT_CREATE_DIRECTORY " << outputDirectory;
+		return false;
+	}
+	double start = SecondsNow();
+
+	GLuint fbo, names[2];
+	glCreateRenderbuffers(2, names);
+	GpuRenderbuffer colorBuffer(names[0], GpuCategory::RenderTarget, TextureBytes(GL_RGBA8, width, height, 1),
+		"batch color");
+	GpuRenderbuffer depthBuffer(names[1], GpuCategory::RenderTarget,
+		TextureBytes(GL_DEPTH_COMPONENT24, width, height, 1), "batch depth");
+	glNamedRenderbufferStorage(colorBuffer.Get(), GL_RGBA8, width, height);
+	glNamedRenderbufferStorage(depthBuffer.Get(), GL_DEPTH_COMPONENT24, width, height);
+
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer.Get());
+	glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer.Get());
+	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG_ERROR << "ERROR::BATCH::FRAMEBUFFER_INCOMPLETE";
+		glDeleteFramebuffers(1, &fbo);
+		return false;
+	}
+
+	ThreadPool writers(WRITER_THREADS);
+	std::atomic<int> pendingWrites{ 0 };
+	std::atomic<int> failedWrites{ 0 };
+	int rendered = 0, skipped = 0, failed = 0, reclaimed = 0;
+	for (const BatchJob& job : jobs)
+	{
+		std::string imagePath = JoinPath(outputDirectory, job.pose.name + ".png");
+		std::string claimPath = imagePath + ".claim";
+		if (!UClaim(claimPath, reclaimed))
+		{
+			++skipped;
+			continue;
+		}
+		if (UFileExists(imagePath))
+		{
+			remove(claimPath.c_str());
+			++skipped;
+			continue;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, width, height);
+		if (!render(job, width, height))
+		{
+			remove(claimPath.c_str());
+			++failed;
+			continue;
+		}
+
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.channels = 3;
+		image.pixels.resize(size_t(width) * height * 3);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, image.pixels.data());
+		++rendered;
+
+		// the writers only fall behind when encoding is slower than drawing
+		if (pendingWrites >= MAX_PENDING_WRITES)
+			writers.Wait();
+		++pendingWrites;
+		writers.Submit([image = std::move(image), imagePath, claimPath, &pendingWrites, &failedWrites]() mutable {
+			flipImageVertically(image.pixels.data(), image.width, image.height, image.channels);
+			// written aside and renamed into place, so a process killed mid
+			// write leaves no partial image that would mark the job done
+			std::string partialPath = imagePath + ".tmp";
+			std::error_code error;
+			bool written = WritePng(partialPath.c_str(), image);
+			if (written)
+				std::filesystem::rename(partialPath, imagePath, error);
+			if (!written || error)
+			{
+				LOG_ERROR << "ERROR::BATCH::CANNOT_WRITE " << imagePath;
+				remove(partialPath.c_str());
+				++failedWrites;
+			}
+			remove(claimPath.c_str());
+			--pendingWrites;
+		});
+	}
+	writers.Wait();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+
+	// one thread renders, so the rate is that of one process; processes
+	// sharing the job file add up
+	double seconds = std::max(SecondsNow() - start, 1e-6);
+	failed += failedWrites;
+	LOG_INFO << "INFO: Batch: " << rendered << " images in " << seconds << " s, " << rendered / seconds << " images/s; "
+		<< skipped << " jobs done or claimed elsewhere, " << reclaimed << " stale claims taken over, " << failed
+		<< " failed; startup " << startupSeconds << " s, "
+		<< (rendered > 0 ? startupSeconds / rendered : startupSeconds) << " s per image";
+	return failed == 0;
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// batch.h
+// ========
+// renders a job file of scene variants to still images without restarting
+//
+// The program starts once, with its meshes, shaders and textures, and then
+// renders job after job offscreen; a job is a camera pose with light colors
+// and textures swapped in for it. The pixels of a finished job are read back
+// and handed to writer threads, which encode and save the PNG while the
+// next jobs render.
+//
+// Several processes may run the same job file to use more cores: they pull
+// from it as a shared queue. A job is claimed by creating <name>.png.claim
+// exclusively in the output directory, and the claim is removed once the
+// image is on disk. Images are written to <name>.png.tmp and renamed, so a
+// <name>.png is always complete. Every job is rendered once and a rerun
+// only renders the images that are still missing. A process that dies
+// mid-job leaves its claim behind; claims older than ten minutes are taken
+// over, and deleting the .claim files of a run that no longer runs frees
+// its jobs at once.
+//
+// Job file:
+// {
+//   "output": "batch", "width": 1200, "height": 800,
+//   "jobs": [
+//     { "name": "oak-warm", "position": [0, 2, 2], "target": [0, 1, 0], "fov": 45,
+//       "lightColors": [[1.0, 0.9, 0.8], [0.4, 0.4, 0.5]],
+//       "textures": { "table": "resources/textures/oak.jpg" } }
+//   ]
+// }
+// "lightColors" replaces the colors of the first scene lights in order;
+// "textures" maps object names to the image each of them is drawn with.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "regression.h"
+
+struct BatchJob
+{
+	RegressionPose pose;					// its name names the image
+	std::vector<glm::vec3> lightColors;
+	std::vector<std::pair<std::string, std::string>> textures;	// object name, image file
+};
+
+class BatchRenderer
+{
+public:
+	// Applies a job to the scene and draws its pose into the bound
+	// framebuffer of width x height; false when the job cannot be drawn
+	typedef bool (*JobRenderer)(const BatchJob& job, int width, int height);
+
+	bool Load(const char* filename);
+
+	// Render every job no other process has claimed. startupSeconds, the time
+	// spent before the first job, is reported spread over the images.
+	// Returns false when a job failed.
+	bool Run(JobRenderer render, double startupSeconds);
+
+	const std::vector<BatchJob>& GetJobs() const { return jobs; }
+	bool ChangesLights() const;
+
+private:
+	std::string outputDirectory = "batch";
+	int width = 1200;
+	int height = 800;
+	std::vector<BatchJob> jobs;
+};
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// bounds.h
+// ========
+// axis aligned bounding boxes and view frustums used for culling and
+// for deciding which cached render results an object can affect
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+
+// Axis aligned bounding box
+struct Bounds
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool IsEmpty() const { return min.x > max.x; }
+	glm::vec3 Center() const { return (min + max) * 0.5f; }
+	glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+	void Expand(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void Expand(const Bounds& other)
+	{
+		if (other.IsEmpty())
+			return;
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	// Box enclosing this box after it has been transformed by matrix
+	Bounds Transformed(const glm::mat4& matrix) const
+	{
+		Bounds result;
+		if (IsEmpty())
+			return result;
+
+		// Arvo's method: transform the center and take the absolute
+		// value of the matrix to grow the extents
+		glm::vec3 center = Center();
+		glm::vec3 extents = Extents();
+		glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+		glm::vec3 newExtents(0.0f);
+		for (int col = 0; col < 3; ++col)
+		{
+			for (int row = 0; row < 3; ++row)
+				newExtents[row] += fabsf(matrix[col][row]) * extents[col];
+		}
+		result.min = newCenter - newExtents;
+		result.max = newCenter + newExtents;
+		return result;
+	}
+};
+
+// Six clip planes of a view-projection matrix, normals pointing inwards
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann plane extraction from a combined projection * view matrix
+	static Frustum FromMatrix(const glm::mat4& m)
+	{
+		Frustum frustum;
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				frustum.planes[i * 2][j] = m[j][3] + m[j][i];
+				frustum.planes[i * 2 + 1][j] = m[j][3] - m[j][i];
+			}
+		}
+		for (int i = 0; i < 6; ++i)
+			frustum.planes[i] = frustum.planes[i] / glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
+	// Conservative box test: false only when the box is fully outside one plane
+	bool Intersects(const Bounds& box) const
+	{
+		if (box.IsEmpty())
+			return false;
+
+		glm::vec3 center = box.Center();
+		glm::vec3 extents = box.Extents();
+		for (int i = 0; i < 6; ++i)
+		{
+			glm::vec3 normal(planes[i]);
+			float radius = glm::dot(extents, glm::abs(normal));
+			if (glm::dot(normal, center) + planes[i].w < -radius)
+				return false;
+		}
+		return true;
+	}
+};
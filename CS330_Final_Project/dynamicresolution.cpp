@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ========
+// renders the scene at a resolution scaled to hold a GPU frame time target
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dynamicresolution.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// changes of the scale smaller than this are not worth a visible jump
+	const float SCALE_DEADBAND = 0.02f;
+	// largest change per measured frame; down faster than up so a spike is
+	// absorbed quickly and recovery does not oscillate
+	const float SCALE_STEP_DOWN = 0.05f;
+	const float SCALE_STEP_UP = 0.02f;
+	// weight of a new sample in the filtered GPU time
+	const double GPU_TIME_FILTER = 0.1;
+}
+
+bool DynamicResolution::Create(int outputWidth, int outputHeight)
+{
+	this->outputWidth = outputWidth;
+	this->outputHeight = outputHeight;
+
+	glGenQueries(QUERY_FRAMES * 2, &queries[0][0]);
+	return UAllocateTarget();
+}
+
+void DynamicResolution::Destroy()
+{
+	glDeleteQueries(QUERY_FRAMES * 2, &queries[0][0]);
+	glDeleteFramebuffers(1, &fbo);
+	fbo = 0;
+	colorTexture.Reset();
+	depthBuffer.Reset();
+}
+
+void DynamicResolution::Resize(int outputWidth, int outputHeight)
+{
+	if (outputWidth <= 0 || outputHeight <= 0)
+		return;
+	if (outputWidth == this->outputWidth && outputHeight == this->outputHeight)
+		return;
+
+	this->outputWidth = outputWidth;
+	this->outputHeight = outputHeight;
+	UAllocateTarget();
+}
+
+void DynamicResolution::SetTarget(double milliseconds, float minimumScale)
+{
+	targetMilliseconds = milliseconds;
+	this->minimumScale = std::min(std::max(minimumScale, 0.1f), 1.0f);
+	scale = std::max(scale, this->minimumScale);
+}
+
+int DynamicResolution::GetRenderWidth() const
+{
+	return std::max(1, int(float(outputWidth) * scale + 0.5f));
+}
+
+int DynamicResolution::GetRenderHeight() const
+{
+	return std::max(1, int(float(outputHeight) * scale + 0.5f));
+}
+
+///////////////////////////////////////////////////
+//	BeginFrame()
+//
+//	Pick up the timings that are ready, adjust the
+//	scale, then redirect drawing to the target
+///////////////////////////////////////////////////
+void DynamicResolution::BeginFrame()
+{
+	drawing = enabled && fbo != 0;
+	if (!drawing)
+		return;
+
+	UReadTimings();
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, GetRenderWidth(), GetRenderHeight());
+
+	glQueryCounter(queries[queryFrame][0], GL_TIMESTAMP);
+}
+
+void DynamicResolution::EndFrame()
+{
+	if (!drawing)
+		return;
+	drawing = false;
+
+	glQueryCounter(queries[queryFrame][1], GL_TIMESTAMP);
+	queryPending[queryFrame] = true;
+	queryScale[queryFrame] = scale;
+	queryFrame = (queryFrame + 1) % QUERY_FRAMES;
+
+	// stretch the drawn part over the output; linear filtering smooths the upscale
+	int renderWidth = GetRenderWidth();
+	int renderHeight = GetRenderHeight();
+	bool fullSize = renderWidth == outputWidth && renderHeight == outputHeight;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, outputWidth, outputHeight,
+		GL_COLOR_BUFFER_BIT, fullSize ? GL_NEAREST : GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	glViewport(0, 0, outputWidth, outputHeight);
+}
+
+// Immutable storage cannot change size, so every resize creates the color
+// texture and depth buffer anew and reattaches them
+bool DynamicResolution::UAllocateTarget()
+{
+	if (!fbo)
+		glCreateFramebuffers(1, &fbo);
+
+	// only blitted from, so the texture needs no sampling state
+	colorTexture = CreateTexture2D(GpuCategory::RenderTarget, "scaled color target", GL_RGBA8, outputWidth,
+		outputHeight, 1);
+	GLuint depth = 0;
+	glCreateRenderbuffers(1, &depth);
+	glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, outputWidth, outputHeight);
+	depthBuffer = GpuRenderbuffer(depth, GpuCategory::RenderTarget,
+		TextureBytes(GL_DEPTH_COMPONENT24, outputWidth, outputHeight, 1), "scaled depth target");
+
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, colorTexture.Get(), 0);
+	glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer.Get());
+	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG_ERROR << "ERROR::DYNAMIC_RESOLUTION::FRAMEBUFFER_INCOMPLETE";
+		glDeleteFramebuffers(1, &fbo);
+		fbo = 0;
+		colorTexture.Reset();
+		depthBuffer.Reset();
+		return false;
+	}
+	return true;
+}
+
+// Read every finished frame's GPU time without waiting for unfinished ones
+void DynamicResolution::UReadTimings()
+{
+	for (int i = 0; i < QUERY_FRAMES; ++i)
+	{
+		int frame = (queryFrame + i) % QUERY_FRAMES;	// oldest first
+		if (!queryPending[frame])
+			continue;
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(queries[frame][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			// the slot is about to be reused; its sample is dropped
+			if (frame == queryFrame)
+				queryPending[frame] = false;
+			continue;
+		}
+
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(queries[frame][0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[frame][1], GL_QUERY_RESULT, &end);
+		queryPending[frame] = false;
+		UUpdateScale(double(end - start) / 1000000.0, queryScale[frame]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	UUpdateScale(double, float)
+//
+//	frameMilliseconds: GPU time of one frame
+//	frameScale: scale that frame was drawn at
+//
+//	The frame cost is taken as proportional to the
+//	pixel count, so each sample is turned into the
+//	time at full scale before it is filtered, and
+//	the scale that meets the target is
+//	sqrt(target / full scale time)
+///////////////////////////////////////////////////
+void DynamicResolution::UUpdateScale(double frameMilliseconds, float frameScale)
+{
+	if (frameMilliseconds <= 0.0 || frameScale <= 0.0f)
+		return;
+	double fullScale = frameMilliseconds / (double(frameScale) * frameScale);
+	if (gpuMilliseconds == 0.0)
+	{
+		gpuMilliseconds = frameMilliseconds;
+		fullScaleMilliseconds = fullScale;
+	}
+	gpuMilliseconds += (frameMilliseconds - gpuMilliseconds) * GPU_TIME_FILTER;
+	fullScaleMilliseconds += (fullScale - fullScaleMilliseconds) * GPU_TIME_FILTER;
+
+	float wanted = float(std::sqrt(targetMilliseconds / fullScaleMilliseconds));
+	wanted = std::min(std::max(wanted, minimumScale), 1.0f);
+
+	float change = wanted - scale;
+	if (std::fabs(change) < SCALE_DEADBAND && wanted != 1.0f && wanted != minimumScale)
+		return;
+	scale += std::min(std::max(change, -SCALE_STEP_DOWN), SCALE_STEP_UP);
+}
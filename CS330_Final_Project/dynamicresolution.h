@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ========
+// renders the scene at a resolution scaled to hold a GPU frame time target
+//
+// The scene is drawn into an offscreen color/depth target the size of the
+// output, but only into its lower left width * scale x height * scale part;
+// a filtered blit stretches that part over the output. The target is only
+// reallocated when the output size changes, never when the scale does.
+//
+// The GPU time of every frame is measured with timestamp queries that are
+// read a few frames later, so measuring never stalls the pipeline. The
+// controller moves the scale towards the one whose pixel count fits the
+// target time and ignores changes too small to matter.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "gpuresources.h"
+
+class DynamicResolution
+{
+public:
+	bool Create(int outputWidth, int outputHeight);
+	void Destroy();
+
+	// Reallocate the target for a new output size; ignored for a zero size
+	// (minimized window)
+	void Resize(int outputWidth, int outputHeight);
+
+	// GPU milliseconds per frame to hold; the scale stays within
+	// [minimumScale, 1]
+	void SetTarget(double milliseconds, float minimumScale);
+
+	// When disabled the scene is drawn straight to the output at full size
+	void SetEnabled(bool enabled) { this->enabled = enabled; }
+	bool IsEnabled() const { return enabled; }
+
+	// Bind the scaled target and its viewport, and start timing the frame.
+	// The output is whatever draw framebuffer is bound now.
+	void BeginFrame();
+
+	// Stop timing, upscale into the output framebuffer and restore it
+	void EndFrame();
+
+	float GetScale() const { return scale; }
+	int GetRenderWidth() const;
+	int GetRenderHeight() const;
+	double GetGpuMilliseconds() const { return gpuMilliseconds; }	// filtered
+
+private:
+	static const int QUERY_FRAMES = 4;		// frames in flight before a result is read
+
+	GLuint fbo = 0;
+	GpuTexture colorTexture;
+	GpuRenderbuffer depthBuffer;
+	int outputWidth = 0;
+	int outputHeight = 0;
+
+	GLuint queries[QUERY_FRAMES][2] = {};	// start and end timestamps
+	bool queryPending[QUERY_FRAMES] = {};
+	float queryScale[QUERY_FRAMES] = {};	// scale the timed frame was drawn at
+	int queryFrame = 0;
+
+	GLint outputFramebuffer = 0;			// bound at BeginFrame
+	bool enabled = true;
+	bool drawing = false;					// between BeginFrame and EndFrame while enabled
+
+	float scale = 1.0f;
+	float minimumScale = 0.5f;
+	double targetMilliseconds = 14.0;
+	double gpuMilliseconds = 0.0;
+	double fullScaleMilliseconds = 0.0;		// filtered GPU time estimated at scale 1
+
+	bool UAllocateTarget();
+	void UReadTimings();
+	void UUpdateScale(double frameMilliseconds, float frameScale);
+};
@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+// fileutils.cpp
+// ========
+// paths, directories and wall time shared by the offscreen runs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "fileutils.h"
+
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+double SecondsNow()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool MakeDirectories(const std::string& path)
+{
+	if (path.empty())
+		return true;
+	std::error_code error;
+	std::filesystem::create_directories(path, error);
+	return !error;
+}
+
+std::string JoinPath(const std::string& directory, const std::string& name)
+{
+	if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+		return directory + name;
+	return directory + "/" + name;
+}
@@ -0,0 +1,18 @@
+///////////////////////////////////////////////////////////////////////////////
+// fileutils.h
+// ========
+// paths, directories and wall time shared by the offscreen runs
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+// Seconds on a steady clock, for measuring spans
+double SecondsNow();
+
+// Create the directory and any missing parents; true when it exists after
+bool MakeDirectories(const std::string& path);
+
+// directory/name, without doubling a trailing separator
+std::string JoinPath(const std::string& directory, const std::string& name);
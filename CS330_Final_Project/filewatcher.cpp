@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ========
+// change notification for files edited while the program runs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "filewatcher.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Polling interval of the modification time fallback
+	const double POLL_INTERVAL = 0.25;
+
+	double UNow()
+	{
+		using namespace std::chrono;
+		return duration<double>(steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+}
+
+int64_t FileWatcher::UModifiedTime(const std::string& path)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0)
+		return -1;
+	return int64_t(info.st_mtime);
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return -1;
+#ifdef __linux__
+	return int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+	return int64_t(info.st_mtime);
+#endif
+#endif
+}
+
+///////////////////////////////////////////////////
+//	Watch(const std::string&)
+//
+//	filename: file to report changes of
+//
+//	Register a file; changes are reported by
+//	PollChanges from now on
+///////////////////////////////////////////////////
+bool FileWatcher::Watch(const std::string& filename)
+{
+	WatchedFile file;
+	file.path = filename;
+	size_t separator = filename.find_last_of("/\\");
+	file.directory = separator == std::string::npos ? std::string() : filename.substr(0, separator + 1);
+	file.name = separator == std::string::npos ? filename : filename.substr(separator + 1);
+	file.modifiedTime = UModifiedTime(filename);
+	file.watchDescriptor = -1;
+
+#ifdef __linux__
+	if (inotifyFd < 0)
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (inotifyFd >= 0)
+	{
+		// watching the directory sees files that are replaced by a rename
+		std::string directory = file.directory.empty() ? "." : file.directory;
+		file.watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (file.watchDescriptor < 0)
+			LOG_ERROR << "ERROR::FILEWATCHER::CANNOT_WATCH " << directory << ", polling instead";
+	}
+#endif
+
+	files.push_back(file);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	PollChanges(std::vector<std::string>&)
+//
+//	changed: receives the paths of the changed files
+//
+//	Drain pending notifications without blocking.
+//	Returns true when any watched file changed
+///////////////////////////////////////////////////
+bool FileWatcher::PollChanges(std::vector<std::string>& changed)
+{
+	changed.clear();
+
+#ifdef __linux__
+	if (inotifyFd >= 0)
+	{
+		alignas(struct inotify_event) char buffer[4096];
+		for (;;)
+		{
+			ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+			if (length <= 0)
+				break;	// EAGAIN: nothing more queued
+
+			for (char* p = buffer; p < buffer + length; )
+			{
+				const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+				for (const WatchedFile& file : files)
+				{
+					if (event->wd == file.watchDescriptor && event->len > 0 && file.name == event->name &&
+						std::find(changed.begin(), changed.end(), file.path) == changed.end())
+						changed.push_back(file.path);
+				}
+				p += sizeof(struct inotify_event) + event->len;
+			}
+		}
+	}
+#endif
+
+	// files without a working inotify watch fall back to polling
+	double now = UNow();
+	if (now - lastPollTime >= POLL_INTERVAL)
+	{
+		lastPollTime = now;
+		for (WatchedFile& file : files)
+		{
+			if (file.watchDescriptor >= 0)
+				continue;
+
+			int64_t modifiedTime = UModifiedTime(file.path);
+			if (modifiedTime != file.modifiedTime)
+			{
+				file.modifiedTime = modifiedTime;
+				if (modifiedTime >= 0)
+					changed.push_back(file.path);
+			}
+		}
+	}
+
+	return !changed.empty();
+}
@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ========
+// change notification for files edited while the program runs
+//
+// On Linux the parent directories are watched with inotify, which also sees
+// editors that save by writing a temporary file and renaming it over the
+// original. Elsewhere the modification times are polled a few times a second.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	~FileWatcher();
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Start watching a file. It does not need to exist yet.
+	bool Watch(const std::string& filename);
+
+	// Non-blocking; fills changed with the watched files written since the last call
+	bool PollChanges(std::vector<std::string>& changed);
+
+private:
+	struct WatchedFile
+	{
+		std::string path;
+		std::string directory;		// directory part, with a trailing separator
+		std::string name;			// file name without the directory
+		int64_t modifiedTime;		// polling fallback: last seen modification time
+		int watchDescriptor;		// inotify watch on the directory
+	};
+
+	std::vector<WatchedFile> files;
+	int inotifyFd = -1;
+	double lastPollTime = 0.0;
+
+	static int64_t UModifiedTime(const std::string& path);
+};
@@ -0,0 +1,353 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ========
+// records the rendered frames to a PNG sequence or a YUV video file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framecapture.h"
+#include "imageio.h"
+#include "logging.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double UMillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	///////////////////////////////////////////////////
+	//	UToYuv420(const unsigned char*, int, int, std::vector<unsigned char>&)
+	//
+	//	rgba: rows bottom to top, as read back from GL
+	//	width, height: even frame size
+	//	planes: receives the Y, U and V planes, top to bottom
+	//
+	//	BT.601 limited range in integer arithmetic; the
+	//	chroma of every 2x2 block is the mean of its four
+	//	pixels
+	///////////////////////////////////////////////////
+	void UToYuv420(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& planes)
+	{
+		size_t lumaSize = size_t(width) * height;
+		size_t chromaSize = lumaSize / 4;
+		planes.resize(lumaSize + 2 * chromaSize);
+		unsigned char* luma = planes.data();
+		unsigned char* u = luma + lumaSize;
+		unsigned char* v = u + chromaSize;
+
+		for (int y = 0; y < height; y += 2)
+		{
+			const unsigned char* rows[2] = {
+				rgba + size_t(height - 1 - y) * width * 4,
+				rgba + size_t(height - 2 - y) * width * 4,
+			};
+			for (int x = 0; x < width; x += 2)
+			{
+				int r = 0, g = 0, b = 0;
+				for (int dy = 0; dy < 2; ++dy)
+				{
+					for (int dx = 0; dx < 2; ++dx)
+					{
+						const unsigned char* p = rows[dy] + size_t(x + dx) * 4;
+						luma[size_t(y + dy) * width + x + dx] =
+							(unsigned char)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+						r += p[0];
+						g += p[1];
+						b += p[2];
+					}
+				}
+				r = (r + 2) / 4;
+				g = (g + 2) / 4;
+				b = (b + 2) / 4;
+				size_t chroma = size_t(y / 2) * (width / 2) + x / 2;
+				u[chroma] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+				v[chroma] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			}
+		}
+	}
+}
+
+FrameCapture::FrameCapture()
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	Stop();
+}
+
+///////////////////////////////////////////////////
+//	Start(const std::string&, CaptureFormat, int, int, int)
+//
+//	directory: created if needed
+//	format: PNG sequence or Y4M video
+//	width, height: size of the frames; odd sizes are
+//		rounded down to even for Y4M
+//	framesPerSecond: frame rate in the Y4M header
+//
+//	Create the slot buffers and map them for good;
+//	persistent coherent mappings need no map/unmap
+//	per frame and no flush before reading
+///////////////////////////////////////////////////
+bool FrameCapture::Start(const std::string& directory, CaptureFormat format, int width, int height, int framesPerSecond)
+{
+	Stop();
+
+	if (format == CaptureFormat::Y4m)
+	{
+		width &= ~1;
+		height &= ~1;
+	}
+	if (width <= 0 || height <= 0)
+	{
+		LOG_ERROR << "ERROR::CAPTURE::BAD_SIZE " << width << "x" << height;
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		LOG_ERROR << "ERROR::CAPTURE::CANNOT_CREATE_DIRECTORY " << directory;
+		return false;
+	}
+
+	if (format == CaptureFormat::Y4m)
+	{
+		std::string filename = directory + "/capture.y4m";
+		video.open(filename, std::ios::binary | std::ios::trunc);
+		if (!video)
+		{
+			LOG_ERROR << "ERROR::CAPTURE::CANNOT_CREATE " << filename;
+			return false;
+		}
+		video << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond << ":1 Ip A1:1 C420jpeg\n";
+	}
+
+	this->directory = directory;
+	this->format = format;
+	this->width = width;
+	this->height = height;
+	frameNumber = 0;
+	sequence = 0;
+	nextSlot = 0;
+	nextVideoFrame = 0;
+	finishedFrames.clear();
+	stats = CaptureStats();
+
+	const GLbitfield MAP_FLAGS = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr size = GLsizeiptr(width) * height * 4;
+	for (Slot& slot : slots)
+	{
+		GLuint buffer = 0;
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, size, nullptr, MAP_FLAGS);
+		slot.buffer = GpuBuffer(buffer, GpuCategory::Staging, size_t(size), "capture readback");
+		slot.pixels = static_cast<const unsigned char*>(glMapNamedBufferRange(buffer, 0, size, MAP_FLAGS));
+		slot.fence = nullptr;
+		slot.state = Free;
+	}
+
+	encoders.reset(new ThreadPool(ENCODE_THREADS));
+	capturing = true;
+	LOG_INFO << "INFO: Capturing " << width << "x" << height << " frames to " << directory
+		<< (format == CaptureFormat::Y4m ? "/capture.y4m" : " as PNG");
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	CaptureFrame()
+//
+//	Hand the slots the GPU has finished to the
+//	encoders, then queue a copy of this frame into
+//	the next slot, or drop the frame when that slot
+//	is still busy
+///////////////////////////////////////////////////
+void FrameCapture::CaptureFrame()
+{
+	if (!capturing)
+		return;
+	Clock::time_point start = Clock::now();
+	uint64_t frame = frameNumber++;
+
+	UPollFences(false);
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	Slot& slot = slots[nextSlot];
+	bool sizeMatches = viewport[2] >= width && viewport[3] >= height;
+	bool slotFree = slot.state.load(std::memory_order_acquire) == Free;
+
+	if (sizeMatches && slotFree)
+	{
+		// the copy runs on the GPU into the buffer; glReadPixels returns at once
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer.Get());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(viewport[0], viewport[1], width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.frame = frame;
+		slot.sequence = sequence++;
+		slot.state.store(Reading, std::memory_order_release);
+		nextSlot = (nextSlot + 1) % RING_SIZE;
+	}
+
+	size_t inFlight = 0;
+	for (const Slot& s : slots)
+		inFlight += s.state.load(std::memory_order_relaxed) != Free ? 1 : 0;
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	if (!sizeMatches)
+		++stats.skipped;
+	else if (!slotFree)
+		++stats.dropped;
+	stats.maxInFlight = std::max(stats.maxInFlight, inFlight);
+	stats.renderMilliseconds += UMillisecondsSince(start);
+}
+
+void FrameCapture::Stop()
+{
+	if (!capturing)
+		return;
+	capturing = false;
+
+	UPollFences(true);
+	encoders->Wait();
+	encoders.reset();
+
+	for (Slot& slot : slots)
+	{
+		glUnmapNamedBuffer(slot.buffer.Get());
+		slot.buffer.Reset();
+		slot.pixels = nullptr;
+	}
+	if (video.is_open())
+		video.close();
+
+	CaptureStats result = GetStats();
+	size_t seen = size_t(frameNumber);
+	LOG_INFO << "INFO: Capture: " << result.captured << " of " << seen << " frames written, " << result.dropped
+		<< " dropped with every slot busy or their readback lost, " << result.skipped << " skipped for their size; up to "
+		<< result.maxInFlight << " of " << RING_SIZE << " slots in flight";
+	if (seen > 0 && result.captured > 0)
+	{
+		LOG_INFO << "INFO: Capture: " << result.renderMilliseconds / double(seen) << " ms per frame on the render thread, "
+			<< result.encodeMilliseconds / double(result.captured) << " ms per frame to encode on "
+			<< ENCODE_THREADS << " threads";
+	}
+}
+
+CaptureStats FrameCapture::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+// Pass every slot whose copy has finished to an encoder; with wait, block
+// until all of them have. A copy that fails or does not finish within the
+// wait is dropped, and the video moves on past its frame
+void FrameCapture::UPollFences(bool wait)
+{
+	for (int i = 0; i < RING_SIZE; ++i)
+	{
+		Slot& slot = slots[(nextSlot + i) % RING_SIZE];	// oldest first
+		if (slot.state.load(std::memory_order_acquire) != Reading)
+			continue;
+
+		GLbitfield flags = wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+		GLuint64 timeout = wait ? GLuint64(1000000000) : 0;
+		GLenum result = glClientWaitSync(slot.fence, flags, timeout);
+		bool finished = result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+		if (!finished && !wait && result != GL_WAIT_FAILED)
+			continue;
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+		if (!finished)
+		{
+			LOG_ERROR << "ERROR::CAPTURE::READBACK_FAILED frame " << slot.frame;
+			slot.state.store(Free, std::memory_order_release);
+			{
+				std::lock_guard<std::mutex> lock(statsMutex);
+				++stats.dropped;
+			}
+			if (format == CaptureFormat::Y4m)
+			{
+				std::vector<unsigned char> none;
+				UWriteVideoFrame(slot.sequence, none);
+			}
+			continue;
+		}
+		slot.state.store(Encoding, std::memory_order_release);
+		encoders->Submit([this, &slot] { UEncode(slot); });
+	}
+}
+
+// Runs on an encoder thread
+void FrameCapture::UEncode(Slot& slot)
+{
+	Clock::time_point start = Clock::now();
+
+	if (format == CaptureFormat::Png)
+	{
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.channels = 3;
+		image.pixels.resize(size_t(width) * height * 3);
+		for (int y = 0; y < height; ++y)
+		{
+			const unsigned char* source = slot.pixels + size_t(height - 1 - y) * width * 4;
+			unsigned char* target = image.Row(y);
+			for (int x = 0; x < width; ++x)
+			{
+				target[x * 3] = source[x * 4];
+				target[x * 3 + 1] = source[x * 4 + 1];
+				target[x * 3 + 2] = source[x * 4 + 2];
+			}
+		}
+		slot.state.store(Free, std::memory_order_release);
+
+		char name[32];
+		snprintf(name, sizeof(name), "/frame_%06llu.png", (unsigned long long)slot.frame);
+		WritePng((directory + name).c_str(), image);
+	}
+	else
+	{
+		std::vector<unsigned char> planes;
+		UToYuv420(slot.pixels, width, height, planes);
+		uint64_t frameSequence = slot.sequence;
+		slot.state.store(Free, std::memory_order_release);
+		UWriteVideoFrame(frameSequence, planes);
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	++stats.captured;
+	stats.encodeMilliseconds += UMillisecondsSince(start);
+}
+
+// Append the frame, and every later one already finished, in sequence order;
+// empty planes stand for a dropped frame, which is passed over
+void FrameCapture::UWriteVideoFrame(uint64_t sequence, std::vector<unsigned char>& planes)
+{
+	std::lock_guard<std::mutex> lock(videoMutex);
+	finishedFrames[sequence].swap(planes);
+	for (auto next = finishedFrames.begin(); next != finishedFrames.end() && next->first == nextVideoFrame; )
+	{
+		if (!next->second.empty())
+		{
+			video << "FRAME\n";
+			video.write(reinterpret_cast<const char*>(next->second.data()), std::streamsize(next->second.size()));
+		}
+		next = finishedFrames.erase(next);
+		++nextVideoFrame;
+	}
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ========
+// records the rendered frames to a PNG sequence or a YUV video file
+//
+// Each captured frame is copied by the GPU into one slot of a ring of
+// pixel pack buffers, followed by a fence. Later frames poll the fences
+// without waiting; a finished slot is handed to an encoder thread, which
+// reads the pixels straight from the persistently mapped buffer and frees
+// the slot when done. The render thread never waits for the GPU or the
+// encoders: when every slot is still busy the frame is dropped and counted
+// instead, so capturing does not change the frame pacing being measured.
+//
+// Formats:
+//   Png  frame_000000.png ... in the output directory, numbered by frame,
+//        so dropped frames show as gaps
+//   Y4m  capture.y4m, YUV4MPEG2 4:2:0 (raw BT.601 planes with a small
+//        header ffmpeg and most players read directly); frames are written
+//        in order, dropped frames are left out
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gpuresources.h"
+
+class ThreadPool;
+
+enum class CaptureFormat
+{
+	Png,
+	Y4m,
+};
+
+struct CaptureStats
+{
+	size_t captured = 0;			// frames read back and encoded
+	size_t dropped = 0;				// every slot busy, or the readback failed or outlasted Stop
+	size_t skipped = 0;				// viewport smaller than the capture size
+	size_t maxInFlight = 0;			// most slots busy at once
+	double renderMilliseconds = 0.0;	// render thread time in CaptureFrame, total
+	double encodeMilliseconds = 0.0;	// encoder time, total over every thread
+};
+
+class FrameCapture
+{
+public:
+	FrameCapture();
+	~FrameCapture();
+
+	// Start recording width x height frames into directory; framesPerSecond
+	// only goes into the Y4M header
+	bool Start(const std::string& directory, CaptureFormat format, int width, int height, int framesPerSecond);
+
+	// Read back the bound read framebuffer's color; call after the frame is
+	// drawn and before the buffers are swapped
+	void CaptureFrame();
+
+	// Finish the frames in flight, close the output and print the stats
+	void Stop();
+
+	bool IsCapturing() const { return capturing; }
+	CaptureStats GetStats() const;
+
+private:
+	static const int RING_SIZE = 8;			// frames between readback and the end of encoding
+	static const unsigned ENCODE_THREADS = 2;
+
+	enum SlotState
+	{
+		Free,
+		Reading,		// the GPU copy is queued behind a fence
+		Encoding,		// owned by an encoder thread
+	};
+
+	struct Slot
+	{
+		GpuBuffer buffer;
+		const unsigned char* pixels = nullptr;	// persistent mapping, RGBA rows bottom to top
+		GLsync fence = nullptr;
+		uint64_t frame = 0;					// frame number, names PNG files
+		uint64_t sequence = 0;				// order among the captured frames
+		std::atomic<int> state{ Free };
+	};
+
+	bool capturing = false;
+	CaptureFormat format = CaptureFormat::Png;
+	std::string directory;
+	int width = 0;
+	int height = 0;
+	uint64_t frameNumber = 0;				// frames seen since Start, captured or not
+	uint64_t sequence = 0;					// frames read back since Start
+	int nextSlot = 0;
+	Slot slots[RING_SIZE];
+	std::unique_ptr<ThreadPool> encoders;
+
+	// Y4M frames finish out of order and are appended in frame order
+	std::ofstream video;
+	std::mutex videoMutex;
+	std::map<uint64_t, std::vector<unsigned char>> finishedFrames;
+	uint64_t nextVideoFrame = 0;
+
+	mutable std::mutex statsMutex;
+	CaptureStats stats;
+
+	void UPollFences(bool wait);
+	void UEncode(Slot& slot);
+	void UWriteVideoFrame(uint64_t sequence, std::vector<unsigned char>& planes);
+};
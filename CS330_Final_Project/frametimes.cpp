@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimes.cpp
+// ========
+// collects frame times and summarizes their distribution
+///////////////////////////////////////////////////////////////////////////////
+
+#include "frametimes.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	// Nearest rank percentile of sorted values
+	double UPercentile(const std::vector<double>& sorted, double percent)
+	{
+		size_t rank = size_t(percent / 100.0 * double(sorted.size()) + 0.5);
+		rank = std::min(std::max(rank, size_t(1)), sorted.size());
+		return sorted[rank - 1];
+	}
+}
+
+FrameTimeSummary FrameTimes::Summarize() const
+{
+	FrameTimeSummary summary;
+	if (times.empty())
+		return summary;
+
+	std::vector<double> sorted(times);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (double time : sorted)
+		total += time;
+
+	summary.frames = sorted.size();
+	summary.mean = total / double(sorted.size()) * 1000.0;
+	summary.min = sorted.front() * 1000.0;
+	summary.median = UPercentile(sorted, 50.0) * 1000.0;
+	summary.p95 = UPercentile(sorted, 95.0) * 1000.0;
+	summary.p99 = UPercentile(sorted, 99.0) * 1000.0;
+	summary.max = sorted.back() * 1000.0;
+	return summary;
+}
+
+void FrameTimes::Report(const char* label) const
+{
+	FrameTimeSummary summary = Summarize();
+	LOG_INFO << "INFO: " << label << ": " << summary.frames << " frames, ms mean " << summary.mean
+		<< " min " << summary.min << " median " << summary.median << " p95 " << summary.p95
+		<< " p99 " << summary.p99 << " max " << summary.max;
+}
+
+bool FrameTimes::WriteCsv(const char* filename) const
+{
+	std::ofstream out(filename, std::ios::trunc);
+	if (!out)
+	{
+		LOG_ERROR << "ERROR::FRAMETIMES::CANNOT_CREATE " << filename;
+		return false;
+	}
+
+	out << "frame,milliseconds\n";
+	for (size_t i = 0; i < times.size(); ++i)
+		out << i << ',' << times[i] * 1000.0 << '\n';
+	return bool(out);
+}
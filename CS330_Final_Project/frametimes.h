@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimes.h
+// ========
+// collects frame times and summarizes their distribution
+//
+// Percentiles rather than averages are reported, since a build that adds
+// the occasional long frame looks the same as the old one on average.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct FrameTimeSummary
+{
+	size_t frames = 0;
+	double mean = 0.0;		// all times in milliseconds
+	double min = 0.0;
+	double median = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+class FrameTimes
+{
+public:
+	void Add(double seconds) { times.push_back(seconds); }
+	size_t Count() const { return times.size(); }
+
+	FrameTimeSummary Summarize() const;
+
+	// Print the summary on stdout, prefixed by label
+	void Report(const char* label) const;
+
+	// One frame time in milliseconds per line, for comparing runs offline
+	bool WriteCsv(const char* filename) const;
+
+private:
+	std::vector<double> times;	// seconds, in frame order
+};
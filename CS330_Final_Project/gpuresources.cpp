@@ -0,0 +1,330 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresources.cpp
+// ========
+// immutable GL buffers, textures and shared samplers on direct state access
+///////////////////////////////////////////////////////////////////////////////
+
+#include "gpuresources.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	const char* const CATEGORY_NAMES[] = { "mesh", "texture", "render target", "shader", "staging" };
+	const char* const TYPE_NAMES[] = { "buffer", "vertex array", "texture", "renderbuffer", "program" };
+
+	struct TrackedObject
+	{
+		GpuCategory category;
+		size_t bytes;
+		std::string label;
+	};
+
+	// Every live handle; programs are also created by the shader compile
+	// thread, hence the lock
+	struct Registry
+	{
+		std::mutex mutex;
+		std::unordered_map<uint64_t, TrackedObject> objects;
+		GpuMemoryStats stats;
+		bool overBudget = false;
+	};
+
+	Registry& URegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	uint64_t UKey(GpuObjectType type, GLuint name)
+	{
+		return (uint64_t(type) << 32) | name;
+	}
+
+	double UMegabytes(size_t bytes)
+	{
+		return double(bytes) / (1024.0 * 1024.0);
+	}
+
+	// Totals changed: keep the peak and warn once per crossing of the budget
+	void UUpdateTotals(Registry& registry)
+	{
+		GpuMemoryStats& stats = registry.stats;
+		stats.peakBytes = std::max(stats.peakBytes, stats.totalBytes);
+		bool over = stats.budgetBytes > 0 && stats.totalBytes > stats.budgetBytes;
+		if (over && !registry.overBudget)
+		{
+			LOG_WARNING << "WARNING::GPU::OVER_BUDGET " << UMegabytes(stats.totalBytes) << " MB in use, budget "
+				<< UMegabytes(stats.budgetBytes) << " MB";
+		}
+		registry.overBudget = over;
+	}
+
+	size_t UBytesPerTexel(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:					return 1;
+		case GL_RG8:
+		case GL_R16F:
+		case GL_DEPTH_COMPONENT16:	return 2;
+		case GL_RGBA16F:
+		case GL_RG32F:				return 8;
+		case GL_RGBA32F:			return 16;
+		default:					return 4;	// RGBA8, RGB8 padded, R32F, 24 and 32 bit depth
+		}
+	}
+}
+
+void gpudetail::Track(GpuObjectType type, GLuint name, GpuCategory category, size_t bytes, const char* label)
+{
+	Registry& registry = URegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto inserted = registry.objects.emplace(UKey(type, name), TrackedObject{ category, bytes, label ? label : "" });
+	if (!inserted.second)
+	{
+		LOG_ERROR << "ERROR::GPU::ALREADY_OWNED " << TYPE_NAMES[int(type)] << " " << name << " "
+			<< (label ? label : "(unnamed)");
+		return;
+	}
+	registry.stats.bytes[size_t(category)] += bytes;
+	registry.stats.objects[size_t(category)] += 1;
+	registry.stats.totalBytes += bytes;
+	UUpdateTotals(registry);
+}
+
+void gpudetail::SetBytes(GpuObjectType type, GLuint name, size_t bytes)
+{
+	Registry& registry = URegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto found = registry.objects.find(UKey(type, name));
+	if (found == registry.objects.end())
+		return;
+	TrackedObject& object = found->second;
+	registry.stats.bytes[size_t(object.category)] += bytes - object.bytes;
+	registry.stats.totalBytes += bytes - object.bytes;
+	object.bytes = bytes;
+	UUpdateTotals(registry);
+}
+
+void gpudetail::Release(GpuObjectType type, GLuint name)
+{
+	{
+		Registry& registry = URegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		auto found = registry.objects.find(UKey(type, name));
+		if (found != registry.objects.end())
+		{
+			const TrackedObject& object = found->second;
+			registry.stats.bytes[size_t(object.category)] -= object.bytes;
+			registry.stats.objects[size_t(object.category)] -= 1;
+			registry.stats.totalBytes -= object.bytes;
+			registry.objects.erase(found);
+			UUpdateTotals(registry);
+		}
+	}
+
+	switch (type)
+	{
+	case GpuObjectType::Buffer:			glDeleteBuffers(1, &name); break;
+	case GpuObjectType::VertexArray:	glDeleteVertexArrays(1, &name); break;
+	case GpuObjectType::Texture:		glDeleteTextures(1, &name); break;
+	case GpuObjectType::Renderbuffer:	glDeleteRenderbuffers(1, &name); break;
+	// a program that is still bound is only flagged; it goes once unused
+	default:							glDeleteProgram(name); break;
+	}
+}
+
+GpuMemoryStats GetGpuMemoryStats()
+{
+	Registry& registry = URegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.stats;
+}
+
+void SetGpuMemoryBudget(size_t bytes)
+{
+	Registry& registry = URegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.stats.budgetBytes = bytes;
+	UUpdateTotals(registry);
+}
+
+void ReportGpuMemory(const char* label)
+{
+	GpuMemoryStats stats = GetGpuMemoryStats();
+	LOG_INFO << "INFO: " << label << ": " << UMegabytes(stats.bytes[size_t(GpuCategory::Mesh)]) << " MB meshes, "
+		<< UMegabytes(stats.bytes[size_t(GpuCategory::Texture)]) << " MB textures, "
+		<< UMegabytes(stats.bytes[size_t(GpuCategory::RenderTarget)]) << " MB render targets, "
+		<< UMegabytes(stats.bytes[size_t(GpuCategory::Shader)]) << " MB shaders, "
+		<< UMegabytes(stats.bytes[size_t(GpuCategory::Staging)]) << " MB staging; "
+		<< UMegabytes(stats.totalBytes) << " MB in use, peak " << UMegabytes(stats.peakBytes) << " MB";
+}
+
+///////////////////////////////////////////////////
+//	ReportGpuLeaks()
+//
+//	Log every registered object with its label and
+//	size, biggest first. Call after every owner has
+//	been destroyed and before the context goes; a
+//	leaked handle would otherwise delete its object
+//	on a dead context
+///////////////////////////////////////////////////
+bool ReportGpuLeaks()
+{
+	Registry& registry = URegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	if (registry.objects.empty())
+		return true;
+
+	std::vector<std::pair<uint64_t, const TrackedObject*>> leaks;
+	for (const auto& entry : registry.objects)
+		leaks.emplace_back(entry.first, &entry.second);
+	std::sort(leaks.begin(), leaks.end(), [](const auto& a, const auto& b) { return a.second->bytes > b.second->bytes; });
+
+	LOG_ERROR << "ERROR::GPU::LEAKS " << leaks.size() << " objects, " << UMegabytes(registry.stats.totalBytes)
+		<< " MB still alive at shutdown";
+	for (const auto& leak : leaks)
+	{
+		const TrackedObject& object = *leak.second;
+		LOG_ERROR << "ERROR::GPU::LEAK " << TYPE_NAMES[leak.first >> 32] << " " << GLuint(leak.first) << " ("
+			<< CATEGORY_NAMES[size_t(object.category)] << ", " << object.bytes << " bytes) " << object.label;
+	}
+	return false;
+}
+
+size_t TextureBytes(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei levels)
+{
+	size_t bytes = 0;
+	for (GLsizei level = 0; level < levels; ++level)
+	{
+		bytes += size_t(width) * size_t(height) * UBytesPerTexel(internalFormat);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return bytes;
+}
+
+bool HasDirectStateAccess()
+{
+	return GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+}
+
+GpuBuffer CreateStaticBuffer(GpuCategory category, const char* label, GLsizeiptr size, const void* data)
+{
+	GLuint buffer = 0;
+	glCreateBuffers(1, &buffer);
+	// zero flags: no mapping, no glBufferSubData; the contents are final
+	if (size > 0)
+		glNamedBufferStorage(buffer, size, data, 0);
+	return GpuBuffer(buffer, category, size_t(size), label);
+}
+
+///////////////////////////////////////////////////
+//	CreateVertexArray(const char*, GLuint, GLsizei, const VertexAttributeFormat*, size_t, GLuint)
+//
+//	label: owner of the mesh, for the GPU memory reports
+//	vertexBuffer: interleaved vertices, bound to binding 0
+//	stride: bytes per vertex
+//	attributes: formats of the attributes, attributeCount of them
+//	indexBuffer: element buffer, or 0 for arrays
+//
+//	The format is described once, separate from the
+//	buffer, so nothing is read from the bound
+//	GL_ARRAY_BUFFER as glVertexAttribPointer does
+///////////////////////////////////////////////////
+GpuVertexArray CreateVertexArray(const char* label, GLuint vertexBuffer, GLsizei stride,
+	const VertexAttributeFormat* attributes, size_t attributeCount, GLuint indexBuffer)
+{
+	const GLuint BINDING = 0;
+
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+	glVertexArrayVertexBuffer(vao, BINDING, vertexBuffer, 0, stride);
+	for (size_t i = 0; i < attributeCount; ++i)
+	{
+		const VertexAttributeFormat& attribute = attributes[i];
+		glEnableVertexArrayAttrib(vao, attribute.location);
+		glVertexArrayAttribFormat(vao, attribute.location, attribute.componentCount, attribute.componentType,
+			GL_FALSE, attribute.offset);
+		glVertexArrayAttribBinding(vao, attribute.location, BINDING);
+	}
+	if (indexBuffer)
+		glVertexArrayElementBuffer(vao, indexBuffer);
+	// the state of a vertex array is too small to count
+	return GpuVertexArray(vao, GpuCategory::Mesh, 0, label);
+}
+
+GLsizei MipLevelCount(GLsizei width, GLsizei height)
+{
+	GLsizei levels = 1;
+	for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+		++levels;
+	return levels;
+}
+
+///////////////////////////////////////////////////
+//	CreateTexture2D(GpuCategory, const char*, GLenum, GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void*)
+//
+//	category, label: how the texture is reported
+//	internalFormat: sized format of the storage
+//	width, height: size of level 0
+//	levels: mip levels to allocate
+//	format, type, pixels: level 0 contents, or null
+//
+//	Allocate every level at once and upload level 0.
+//	Rows are expected tightly packed and 4 byte
+//	aligned, which RGBA8 and float rows always are.
+///////////////////////////////////////////////////
+GpuTexture CreateTexture2D(GpuCategory category, const char* label, GLenum internalFormat, GLsizei width,
+	GLsizei height, GLsizei levels, GLenum format, GLenum type, const void* pixels)
+{
+	GLuint texture = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, levels, internalFormat, width, height);
+	if (pixels)
+	{
+		glTextureSubImage2D(texture, 0, 0, 0, width, height, format, type, pixels);
+		if (levels > 1)
+			glGenerateTextureMipmap(texture);
+	}
+	return GpuTexture(texture, category, TextureBytes(internalFormat, width, height, levels), label);
+}
+
+void SamplerLibrary::Create()
+{
+	glCreateSamplers(SamplerTypeCount, samplers);
+
+	// material textures are minified through their mip chain, the levels the
+	// texture streamer loads by on-screen size
+	glSamplerParameteri(samplers[Repeat], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glSamplerParameteri(samplers[Repeat], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[Repeat], GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glSamplerParameteri(samplers[Repeat], GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glSamplerParameteri(samplers[Clamp], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[Clamp], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[Clamp], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(samplers[Clamp], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// a border depth of 1 keeps everything outside the light frustum lit
+	const GLfloat borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glSamplerParameteri(samplers[ShadowCompare], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[ShadowCompare], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[ShadowCompare], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glSamplerParameteri(samplers[ShadowCompare], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glSamplerParameterfv(samplers[ShadowCompare], GL_TEXTURE_BORDER_COLOR, borderColor);
+	glSamplerParameteri(samplers[ShadowCompare], GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glSamplerParameteri(samplers[ShadowCompare], GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+}
+
+void SamplerLibrary::Destroy()
+{
+	glDeleteSamplers(SamplerTypeCount, samplers);
+	std::fill(samplers, samplers + SamplerTypeCount, 0u);
+}
@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresources.h
+// ========
+// immutable GL buffers, textures and shared samplers on direct state access
+//
+// Every object is created with glCreate* and edited by name, so creating one
+// never disturbs the bindings of the frame being drawn. Storage is immutable
+// (glNamedBufferStorage, glTextureStorage2D): its size and format are fixed
+// at creation, which lets the driver skip the reallocation and validation
+// paths of glBufferData and glTexImage2D. To change a size, delete the
+// object and create a new one.
+//
+// Filtering and wrapping live in a few shared sampler objects bound to the
+// fixed texture units once, instead of being set on every texture.
+//
+// Buffers, vertex arrays, textures, renderbuffers and programs are owned by
+// move-only handles that delete the object when they go. Every live handle
+// is in a registry with its estimated size and category, so the memory in
+// use can be reported and held to a budget, and whatever is still alive at
+// shutdown is reported as a leak.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Kinds of GL object the handles own
+enum class GpuObjectType : uint8_t
+{
+	Buffer,
+	VertexArray,
+	Texture,
+	Renderbuffer,
+	Program,
+	ObjectTypeCount
+};
+
+// What an object's memory is used for
+enum class GpuCategory : uint8_t
+{
+	Mesh,			// vertex and index buffers, vertex arrays
+	Texture,		// material textures and lightmaps
+	RenderTarget,	// shadow maps and offscreen color and depth
+	Shader,			// linked programs
+	Staging,		// buffers the CPU reads back
+	CategoryCount
+};
+
+struct GpuMemoryStats
+{
+	size_t bytes[size_t(GpuCategory::CategoryCount)] = {};
+	size_t objects[size_t(GpuCategory::CategoryCount)] = {};
+	size_t totalBytes = 0;
+	size_t peakBytes = 0;
+	size_t budgetBytes = 0;		// 0 without a budget
+};
+
+namespace gpudetail
+{
+	void Track(GpuObjectType type, GLuint name, GpuCategory category, size_t bytes, const char* label);
+	void SetBytes(GpuObjectType type, GLuint name, size_t bytes);
+	// Remove from the registry and delete the GL object
+	void Release(GpuObjectType type, GLuint name);
+}
+
+// Sole owner of one GL object; 0 when empty
+template <GpuObjectType Type>
+class GpuHandle
+{
+public:
+	GpuHandle() = default;
+
+	// Take over name, an object of Type just created, and register it.
+	// label names it in reports and should say where it came from.
+	GpuHandle(GLuint name, GpuCategory category, size_t bytes, const char* label)
+		: name(name)
+	{
+		if (name)
+			gpudetail::Track(Type, name, category, bytes, label);
+	}
+
+	~GpuHandle() { Reset(); }
+
+	GpuHandle(GpuHandle&& other) noexcept : name(other.name) { other.name = 0; }
+
+	GpuHandle& operator=(GpuHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			name = other.name;
+			other.name = 0;
+		}
+		return *this;
+	}
+
+	GpuHandle(const GpuHandle&) = delete;
+	GpuHandle& operator=(const GpuHandle&) = delete;
+
+	GLuint Get() const { return name; }
+	explicit operator bool() const { return name != 0; }
+
+	// New estimate after the storage of the object changed
+	void SetBytes(size_t bytes)
+	{
+		if (name)
+			gpudetail::SetBytes(Type, name, bytes);
+	}
+
+	// Delete the object now
+	void Reset()
+	{
+		if (name)
+		{
+			gpudetail::Release(Type, name);
+			name = 0;
+		}
+	}
+
+private:
+	GLuint name = 0;
+};
+
+typedef GpuHandle<GpuObjectType::Buffer> GpuBuffer;
+typedef GpuHandle<GpuObjectType::VertexArray> GpuVertexArray;
+typedef GpuHandle<GpuObjectType::Texture> GpuTexture;
+typedef GpuHandle<GpuObjectType::Renderbuffer> GpuRenderbuffer;
+typedef GpuHandle<GpuObjectType::Program> GpuProgram;
+
+// Totals of the live objects
+GpuMemoryStats GetGpuMemoryStats();
+
+// Warn when the live objects grow past bytes; 0 turns the budget off
+void SetGpuMemoryBudget(size_t bytes);
+
+// One line with the megabytes of every category, the total and the peak
+void ReportGpuMemory(const char* label);
+
+// Report every object still alive, once everything should be deleted.
+// Returns true when there were none.
+bool ReportGpuLeaks();
+
+// Bytes of levels mip levels of a width x height texture of internalFormat
+size_t TextureBytes(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei levels);
+
+// Needs a GL 4.5 context or ARB_direct_state_access
+bool HasDirectStateAccess();
+
+// Buffer of size bytes filled from data, never written again by the CPU
+GpuBuffer CreateStaticBuffer(GpuCategory category, const char* label, GLsizeiptr size, const void* data);
+
+// One attribute of an interleaved vertex buffer
+struct VertexAttributeFormat
+{
+	GLuint location;
+	GLint componentCount;
+	GLenum componentType;
+	GLuint offset;			// bytes from the start of the vertex
+};
+
+// Vertex array that reads the attributes from vertexBuffer with stride bytes
+// per vertex, and its indices from indexBuffer unless that is 0
+GpuVertexArray CreateVertexArray(const char* label, GLuint vertexBuffer, GLsizei stride,
+	const VertexAttributeFormat* attributes, size_t attributeCount, GLuint indexBuffer);
+
+// Levels of a full mip chain down to 1x1
+GLsizei MipLevelCount(GLsizei width, GLsizei height);
+
+// 2D texture with levels levels of internalFormat. When pixels is not null it
+// fills level 0 from rows of format/type, bottom to top, and the other levels
+// are generated from it.
+GpuTexture CreateTexture2D(GpuCategory category, const char* label, GLenum internalFormat, GLsizei width,
+	GLsizei height, GLsizei levels, GLenum format = GL_RGBA, GLenum type = GL_UNSIGNED_BYTE, const void* pixels = nullptr);
+
+// Sampler objects shared by every texture of a kind
+class SamplerLibrary
+{
+public:
+	enum SamplerType
+	{
+		Repeat,			// material textures: linear, repeating
+		Clamp,			// lightmaps and render targets: linear, clamped to the edge
+		ShadowCompare,	// depth maps: hardware LEQUAL comparison, lit outside the map
+		SamplerTypeCount
+	};
+
+	void Create();
+	void Destroy();
+
+	GLuint Get(SamplerType type) const { return samplers[type]; }
+
+	// Sample every texture bound to unit with the sampler of type
+	void BindToUnit(GLuint unit, SamplerType type) const { glBindSampler(unit, samplers[type]); }
+
+private:
+	GLuint samplers[SamplerTypeCount] = {};
+};
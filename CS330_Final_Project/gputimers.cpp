@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputimers.cpp
+// ========
+// measures the GPU time of each render pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "gputimers.h"
+
+#include "logging.h"
+
+#include <sstream>
+
+namespace
+{
+	// weight of a new sample in the filtered pass time
+	const double PASS_TIME_FILTER = 0.1;
+}
+
+void GpuPassTimers::Destroy()
+{
+	for (Pass& pass : passes)
+		glDeleteQueries(QUERY_FRAMES * 2, &pass.queries[0][0]);
+	passes.clear();
+}
+
+int GpuPassTimers::AddPass(const char* name)
+{
+	passes.emplace_back();
+	passes.back().name = name;
+	glGenQueries(QUERY_FRAMES * 2, &passes.back().queries[0][0]);
+	return int(passes.size() - 1);
+}
+
+void GpuPassTimers::BeginPass(int pass)
+{
+	glQueryCounter(passes[pass].queries[queryFrame][0], GL_TIMESTAMP);
+}
+
+void GpuPassTimers::EndPass(int pass)
+{
+	glQueryCounter(passes[pass].queries[queryFrame][1], GL_TIMESTAMP);
+	passes[pass].pending[queryFrame] = true;
+}
+
+///////////////////////////////////////////////////
+//	EndFrame()
+//
+//	The next frame reuses the oldest set of queries,
+//	so its results are taken now; they were issued
+//	QUERY_FRAMES - 1 frames ago and are all but
+//	certainly available. Newer ones are read as
+//	soon as they are ready
+///////////////////////////////////////////////////
+void GpuPassTimers::EndFrame()
+{
+	queryFrame = (queryFrame + 1) % QUERY_FRAMES;
+	for (Pass& pass : passes)
+	{
+		for (int i = 0; i < QUERY_FRAMES; ++i)
+		{
+			int frame = (queryFrame + i) % QUERY_FRAMES;	// oldest first
+			if (pass.pending[frame])
+				UReadPass(pass, frame, frame == queryFrame);
+		}
+	}
+}
+
+void GpuPassTimers::Report(const char* label) const
+{
+	std::ostringstream line;
+	line << "INFO: " << label << ":";
+	for (const Pass& pass : passes)
+	{
+		line << " " << pass.name << " ";
+		if (pass.samples)
+			line << pass.total / double(pass.samples) << " ms";
+		else
+			line << "not run";
+		line << (&pass == &passes.back() ? "" : ",");
+	}
+	LOG_INFO << line.str();
+}
+
+void GpuPassTimers::UReadPass(Pass& pass, int frame, bool wait)
+{
+	if (!wait)
+	{
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(pass.queries[frame][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return;
+	}
+
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(pass.queries[frame][0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(pass.queries[frame][1], GL_QUERY_RESULT, &end);
+	pass.pending[frame] = false;
+
+	double milliseconds = double(end - start) / 1000000.0;
+	pass.filtered = pass.samples ? pass.filtered + (milliseconds - pass.filtered) * PASS_TIME_FILTER : milliseconds;
+	pass.total += milliseconds;
+	++pass.samples;
+}
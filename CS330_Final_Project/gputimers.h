@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputimers.h
+// ========
+// measures the GPU time of each render pass
+//
+// Every pass is bracketed by a pair of timestamp queries. Timestamps, unlike
+// GL_TIME_ELAPSED queries, can be issued while another timer is running, so
+// passes may sit inside the regression suite's frame timer. Results are read
+// QUERY_FRAMES frames later, when the GPU has long finished with them, so
+// timing never stalls the pipeline.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class GpuPassTimers
+{
+public:
+	void Destroy();
+
+	// Register a pass and return its index for BeginPass/EndPass
+	int AddPass(const char* name);
+
+	// Bracket the GL commands of a pass. A pass skipped in a frame simply
+	// has no sample for it.
+	void BeginPass(int pass);
+	void EndPass(int pass);
+
+	// Once per frame after the last pass: collect finished results and move
+	// on to the next set of queries
+	void EndFrame();
+
+	// Filtered time of a pass in the frames it ran, in milliseconds
+	double GetMilliseconds(int pass) const { return passes[pass].filtered; }
+
+	// Print the mean time of every pass over the run on stdout
+	void Report(const char* label) const;
+
+private:
+	static const int QUERY_FRAMES = 4;	// frames in flight before a result is read
+
+	struct Pass
+	{
+		std::string name;
+		GLuint queries[QUERY_FRAMES][2] = {};	// start and end timestamps
+		bool pending[QUERY_FRAMES] = {};
+		double filtered = 0.0;
+		double total = 0.0;				// sum of every sample, for Report
+		size_t samples = 0;
+	};
+
+	std::vector<Pass> passes;
+	int queryFrame = 0;
+
+	void UReadPass(Pass& pass, int frame, bool wait);
+};
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////////
+// imageio.cpp
+// ========
+// 8 bit images in memory and on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "imageio.h"
+#include "logging.h"
+
+#include <GLFW/stb_image.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	struct CrcTable
+	{
+		uint32_t entries[256];
+
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entries[n] = c;
+			}
+		}
+	};
+
+	uint32_t UCrc32(uint32_t crc, const unsigned char* data, size_t length)
+	{
+		static const CrcTable table;	// built once, thread safe
+
+		crc = ~crc;
+		for (size_t i = 0; i < length; ++i)
+			crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void UPutBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back(uint8_t(value >> 24));
+		out.push_back(uint8_t(value >> 16));
+		out.push_back(uint8_t(value >> 8));
+		out.push_back(uint8_t(value));
+	}
+
+	void UWriteChunk(std::ofstream& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> chunk;
+		UPutBigEndian(chunk, uint32_t(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		UPutBigEndian(chunk, UCrc32(0, chunk.data() + 4, chunk.size() - 4));
+		out.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+	}
+}
+
+bool ReadImage(const char* filename, Image& image, int channels)
+{
+	int width, height, fileChannels;
+	unsigned char* pixels = stbi_load(filename, &width, &height, &fileChannels, channels);
+	if (!pixels)
+	{
+		LOG_ERROR << "ERROR::IMAGE::CANNOT_READ " << filename;
+		return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.channels = channels ? channels : fileChannels;
+	image.pixels.assign(pixels, pixels + size_t(width) * height * image.channels);
+	stbi_image_free(pixels);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	WritePng(const char*, const Image&)
+//
+//	filename: file to create
+//	image: 1 to 4 channel image
+//
+//	Every row uses filter type 0 and the zlib stream
+//	is made of stored (uncompressed) deflate blocks
+///////////////////////////////////////////////////
+bool WritePng(const char* filename, const Image& image)
+{
+	static const unsigned char COLOR_TYPES[5] = { 0, 0, 4, 2, 6 };
+	if (image.channels < 1 || image.channels > 4 || image.width <= 0 || image.height <= 0)
+	{
+		LOG_ERROR << "ERROR::IMAGE::BAD_FORMAT " << filename;
+		return false;
+	}
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		LOG_ERROR << "ERROR::IMAGE::CANNOT_CREATE " << filename;
+		return false;
+	}
+
+	static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+
+	std::vector<unsigned char> header;
+	UPutBigEndian(header, uint32_t(image.width));
+	UPutBigEndian(header, uint32_t(image.height));
+	header.push_back(8);							// bit depth
+	header.push_back(COLOR_TYPES[image.channels]);
+	header.push_back(0);							// deflate
+	header.push_back(0);							// adaptive filtering
+	header.push_back(0);							// no interlace
+	UWriteChunk(out, "IHDR", header);
+
+	// filtered scanlines: a 0 filter byte before every row
+	size_t rowBytes = size_t(image.width) * image.channels;
+	std::vector<unsigned char> raw;
+	raw.reserve((rowBytes + 1) * image.height);
+	for (int y = 0; y < image.height; ++y)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), image.Row(y), image.Row(y) + rowBytes);
+	}
+
+	std::vector<unsigned char> zlib;
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	uint32_t adlerA = 1, adlerB = 0;
+	for (size_t offset = 0; ; )
+	{
+		size_t length = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+		bool last = offset + length == raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back(uint8_t(length));
+		zlib.push_back(uint8_t(length >> 8));
+		zlib.push_back(uint8_t(~length));
+		zlib.push_back(uint8_t(~length >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+
+		for (size_t i = offset; i < offset + length; ++i)
+		{
+			adlerA = (adlerA + raw[i]) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+		offset += length;
+		if (last)
+			break;
+	}
+	UPutBigEndian(zlib, (adlerB << 16) | adlerA);
+	UWriteChunk(out, "IDAT", zlib);
+	UWriteChunk(out, "IEND", std::vector<unsigned char>());
+
+	if (!out)
+	{
+		LOG_ERROR << "ERROR::IMAGE::WRITE_FAILED " << filename;
+		return false;
+	}
+	return true;
+}
+
+void flipImageVertically(unsigned char* image, int width, int height, int channels)
+{
+	for (int j = 0; j < height / 2; ++j)
+	{
+		int index1 = j * width * channels;
+		int index2 = (height - 1 - j) * width * channels;
+
+		for (int i = width * channels; i > 0; --i)
+		{
+			unsigned char tmp = image[index1];
+			image[index1] = image[index2];
+			image[index2] = tmp;
+			++index1;
+			++index2;
+		}
+	}
+}
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+// imageio.h
+// ========
+// 8 bit images in memory and on disk
+//
+// Images are read with stb_image (any format it knows) and written as PNG.
+// The PNG writer stores the pixels without compression, which keeps it small
+// and dependency free; its files are only used for tests and captures.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Rows top to bottom, channels interleaved
+struct Image
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;		// 1 gray, 2 gray+alpha, 3 RGB, 4 RGBA
+	std::vector<unsigned char> pixels;
+
+	unsigned char* Row(int y) { return pixels.data() + size_t(y) * width * channels; }
+	const unsigned char* Row(int y) const { return pixels.data() + size_t(y) * width * channels; }
+};
+
+// Read an image converted to the given channel count, or to its own when 0
+bool ReadImage(const char* filename, Image& image, int channels = 0);
+
+bool WritePng(const char* filename, const Image& image);
+
+// Images are loaded with Y axis going down, but OpenGL's Y axis goes up, so let's flip it
+void flipImageVertically(unsigned char* image, int width, int height, int channels);
@@ -0,0 +1,1297 @@
+///////////////////////////////////////////////////////////////////////////////
+// importer.cpp
+// ========
+// streaming Wavefront OBJ and glTF 2.0 importer
+//
+// OBJ files are memory mapped and cut into chunks at line boundaries. Each
+// chunk is parsed on its own thread into chunk local attribute lists and
+// face corners; a serial pass then resolves the corner indices, welds
+// identical position/uv/normal triples with a hash table and builds the
+// vertex and index lists. glTF primitives are converted in parallel, one
+// job per primitive instance.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "importer.h"
+#include "json.h"
+#include "logging.h"
+#include "textparse.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	const size_t MIN_CHUNK_BYTES = 1 << 20;		// smaller files are not worth splitting
+	const int MAX_NODE_DEPTH = 64;
+
+	unsigned UWorkerCount()
+	{
+		unsigned count = std::thread::hardware_concurrency();
+		return count > 0 ? count : 1;
+	}
+
+	///////////////////////////////////////////////////
+	//	UParallelFor(size_t, unsigned, Function)
+	//
+	//	count: number of jobs
+	//	threads: maximum number of threads to use
+	//	job: called once with every index in [0, count)
+	//
+	//	Run the jobs on worker threads plus the calling
+	//	thread, which pull indices from a shared counter
+	///////////////////////////////////////////////////
+	template <typename Function>
+	void UParallelFor(size_t count, unsigned threads, Function job)
+	{
+		std::atomic<size_t> next(0);
+		auto worker = [&]() {
+			for (size_t i = next++; i < count; i = next++)
+				job(i);
+		};
+
+		std::vector<std::thread> workers;
+		size_t extraThreads = std::min<size_t>(threads, count);
+		for (size_t i = 1; i < extraThreads; ++i)
+			workers.emplace_back(worker);
+		worker();
+		for (std::thread& thread : workers)
+			thread.join();
+	}
+
+	// Lower case extension of a path, without the dot
+	std::string UExtension(const char* filename)
+	{
+		const char* dot = strrchr(filename, '.');
+		std::string extension = dot ? dot + 1 : "";
+		for (char& c : extension)
+			c = char(tolower((unsigned char)c));
+		return extension;
+	}
+
+	// Directory part of a path including the trailing separator
+	std::string UDirectory(const char* filename)
+	{
+		std::string path = filename;
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+	}
+
+	// Start a submesh at the current end of the index list
+	void UBeginSubmesh(ImportedModel& model, uint32_t materialId)
+	{
+		if (!model.submeshes.empty() && model.submeshes.back().indexCount == 0)
+		{
+			// nothing was drawn with the previous material, reuse the entry
+			model.submeshes.back().materialId = materialId;
+			return;
+		}
+
+		MeshFileSubmesh submesh = {};
+		submesh.firstIndex = uint32_t(model.indices.size());
+		submesh.primitive = MESH_FILE_TRIANGLES;
+		submesh.materialId = materialId;
+		model.submeshes.push_back(submesh);
+	}
+
+	void UEndSubmesh(ImportedModel& model)
+	{
+		if (!model.submeshes.empty())
+		{
+			MeshFileSubmesh& submesh = model.submeshes.back();
+			submesh.indexCount = uint32_t(model.indices.size()) - submesh.firstIndex;
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	UGenerateNormals(ImportedModel&, const std::vector<uint8_t>&)
+	//
+	//	model: model with complete vertex and index lists
+	//	needsNormal: one flag per vertex that has no normal
+	//
+	//	Give the flagged vertices the area weighted
+	//	average normal of the triangles that use them
+	///////////////////////////////////////////////////
+	void UGenerateNormals(ImportedModel& model, const std::vector<uint8_t>& needsNormal)
+	{
+		float* v = model.vertices.data();
+		const uint32_t stride = IMPORT_FLOATS_PER_VERTEX;
+
+		for (size_t i = 0; i + 2 < model.indices.size(); i += 3)
+		{
+			const uint32_t a = model.indices[i], b = model.indices[i + 1], c = model.indices[i + 2];
+			if (!needsNormal[a] && !needsNormal[b] && !needsNormal[c])
+				continue;
+
+			const float* pa = v + a * stride;
+			const float* pb = v + b * stride;
+			const float* pc = v + c * stride;
+			float e1[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+			float e2[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+			// the cross product length is twice the triangle area, so larger faces weigh more
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+
+			for (uint32_t corner : { a, b, c })
+			{
+				if (!needsNormal[corner])
+					continue;
+				float* normal = v + corner * stride + 3;
+				normal[0] += n[0];
+				normal[1] += n[1];
+				normal[2] += n[2];
+			}
+		}
+
+		for (size_t i = 0; i < needsNormal.size(); ++i)
+		{
+			if (!needsNormal[i])
+				continue;
+			float* normal = v + i * stride + 3;
+			float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length > 0.0f)
+			{
+				normal[0] /= length;
+				normal[1] /= length;
+				normal[2] /= length;
+			}
+			else
+				normal[1] = 1.0f;
+		}
+	}
+
+	// Fill in the bounds of every submesh and of the whole model
+	void UComputeModelBounds(ImportedModel& model)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			model.boundsMin[axis] = FLT_MAX;
+			model.boundsMax[axis] = -FLT_MAX;
+		}
+
+		for (MeshFileSubmesh& submesh : model.submeshes)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				submesh.boundsMin[axis] = FLT_MAX;
+				submesh.boundsMax[axis] = -FLT_MAX;
+			}
+			for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; ++i)
+			{
+				const float* position = &model.vertices[model.indices[i] * IMPORT_FLOATS_PER_VERTEX];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					submesh.boundsMin[axis] = std::min(submesh.boundsMin[axis], position[axis]);
+					submesh.boundsMax[axis] = std::max(submesh.boundsMax[axis], position[axis]);
+				}
+			}
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				model.boundsMin[axis] = std::min(model.boundsMin[axis], submesh.boundsMin[axis]);
+				model.boundsMax[axis] = std::max(model.boundsMax[axis], submesh.boundsMax[axis]);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Wavefront OBJ
+	///////////////////////////////////////////////////////////////////////////
+
+	enum ObjRelative : uint8_t
+	{
+		RELATIVE_POSITION = 1,
+		RELATIVE_UV = 2,
+		RELATIVE_NORMAL = 4
+	};
+
+	// One face corner. Indices are 0-based and absolute, except those flagged
+	// in relative, which count from the start of the chunk; -1 when absent.
+	struct ObjCorner
+	{
+		int position, uv, normal;
+		uint8_t relative;
+	};
+
+	// A group, object or material switch before the given corner of a chunk
+	struct ObjEvent
+	{
+		size_t corner;
+		bool isMaterial;
+		std::string name;
+	};
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<float> positions, uvs, normals;
+		std::vector<ObjCorner> corners;		// three per triangle
+		std::vector<ObjEvent> events;
+		const char* error = nullptr;		// start of the first malformed line
+	};
+
+	bool UIsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	// Read count floats separated by blanks; the ones past required may be missing
+	bool UReadFloats(const char*& p, const char* eol, float* values, int count, int required)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			SkipBlanks(p, eol);
+			if (!ParseFloat(p, eol, values[i]))
+			{
+				if (i < required)
+					return false;
+				values[i] = 0.0f;
+			}
+		}
+		return true;
+	}
+
+	// Turn a 1-based or negative OBJ index into the ObjCorner convention
+	bool UResolveObjIndex(int index, size_t localCount, int& resolved, uint8_t& relative, uint8_t flag)
+	{
+		if (index > 0)
+			resolved = index - 1;
+		else if (index < 0)
+		{
+			resolved = int(localCount) + index;
+			relative |= flag;
+		}
+		else
+			return false;
+		return true;
+	}
+
+	bool UReadFace(const char*& p, const char* eol, ObjChunk& chunk, std::vector<ObjCorner>& polygon)
+	{
+		polygon.clear();
+		for (;;)
+		{
+			SkipBlanks(p, eol);
+			if (p == eol || *p == '\r' || *p == '#')
+				break;
+
+			ObjCorner corner = { -1, -1, -1, 0 };
+			int index;
+			if (!ParseInt(p, eol, index) ||
+				!UResolveObjIndex(index, chunk.positions.size() / 3, corner.position, corner.relative, RELATIVE_POSITION))
+				return false;
+
+			if (p < eol && *p == '/')
+			{
+				++p;
+				if (p < eol && *p != '/')
+				{
+					if (!ParseInt(p, eol, index) ||
+						!UResolveObjIndex(index, chunk.uvs.size() / 2, corner.uv, corner.relative, RELATIVE_UV))
+						return false;
+				}
+				if (p < eol && *p == '/')
+				{
+					++p;
+					if (!ParseInt(p, eol, index) ||
+						!UResolveObjIndex(index, chunk.normals.size() / 3, corner.normal, corner.relative, RELATIVE_NORMAL))
+						return false;
+				}
+			}
+
+			if (p < eol && !UIsBlank(*p) && *p != '\r')
+				return false;
+			polygon.push_back(corner);
+		}
+
+		if (polygon.size() < 3)
+			return false;
+
+		// triangulate the polygon as a fan around its first corner
+		for (size_t i = 2; i < polygon.size(); ++i)
+		{
+			chunk.corners.push_back(polygon[0]);
+			chunk.corners.push_back(polygon[i - 1]);
+			chunk.corners.push_back(polygon[i]);
+		}
+		return true;
+	}
+
+	// Rest of the line with surrounding blanks and the line break removed
+	std::string UReadName(const char* p, const char* eol)
+	{
+		SkipBlanks(p, eol);
+		const char* last = eol;
+		while (last > p && (UIsBlank(last[-1]) || last[-1] == '\r'))
+			--last;
+		return std::string(p, last);
+	}
+
+	///////////////////////////////////////////////////
+	//	UParseObjChunk(ObjChunk&)
+	//
+	//	chunk: byte range to parse, starting at a line
+	//
+	//	Collect the attributes, triangulated faces and
+	//	group/material switches of a range of lines
+	///////////////////////////////////////////////////
+	void UParseObjChunk(ObjChunk& chunk)
+	{
+		// rough guess: vertex lines are about 30 bytes, face lines somewhat longer
+		size_t bytes = size_t(chunk.end - chunk.begin);
+		chunk.positions.reserve(bytes / 40);
+		chunk.corners.reserve(bytes / 20);
+
+		std::vector<ObjCorner> polygon;
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+
+		while (p < end)
+		{
+			const char* line = p;
+			const char* eol = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+			if (!eol)
+				eol = end;
+
+			SkipBlanks(p, eol);
+			bool ok = true;
+			size_t remaining = size_t(eol - p);
+
+			if (remaining >= 2 && p[0] == 'v' && UIsBlank(p[1]))
+			{
+				float position[3];
+				p += 1;
+				ok = UReadFloats(p, eol, position, 3, 3);
+				chunk.positions.insert(chunk.positions.end(), position, position + 3);
+			}
+			else if (remaining >= 3 && p[0] == 'v' && p[1] == 't' && UIsBlank(p[2]))
+			{
+				float uv[2];
+				p += 2;
+				ok = UReadFloats(p, eol, uv, 2, 1);
+				chunk.uvs.insert(chunk.uvs.end(), uv, uv + 2);
+			}
+			else if (remaining >= 3 && p[0] == 'v' && p[1] == 'n' && UIsBlank(p[2]))
+			{
+				float normal[3];
+				p += 2;
+				ok = UReadFloats(p, eol, normal, 3, 3);
+				chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+			}
+			else if (remaining >= 2 && p[0] == 'f' && UIsBlank(p[1]))
+			{
+				p += 1;
+				ok = UReadFace(p, eol, chunk, polygon);
+			}
+			else if (remaining >= 1 && (p[0] == 'o' || p[0] == 'g') && (remaining == 1 || UIsBlank(p[1]) || p[1] == '\r'))
+			{
+				chunk.events.push_back({ chunk.corners.size(), false, UReadName(p + 1, eol) });
+			}
+			else if (remaining >= 7 && memcmp(p, "usemtl", 6) == 0 && UIsBlank(p[6]))
+			{
+				chunk.events.push_back({ chunk.corners.size(), true, UReadName(p + 6, eol) });
+			}
+			// comments, smoothing groups, mtllib, lines and points are ignored
+
+			if (!ok)
+			{
+				chunk.error = line;
+				return;
+			}
+			p = eol + 1;
+		}
+	}
+
+	// Open addressing hash table from a resolved corner to its vertex index
+	class CornerTable
+	{
+	public:
+		explicit CornerTable(size_t expected)
+		{
+			size_t capacity = 1024;
+			while (capacity < expected * 2)
+				capacity <<= 1;
+			Allocate(capacity);
+		}
+
+		// Index of the corner, or newIndex after inserting it
+		uint32_t FindOrInsert(int position, int uv, int normal, uint32_t newIndex, bool& inserted)
+		{
+			if ((count + 1) * 2 > slots.size())
+				Grow();
+
+			size_t i = Hash(position, uv, normal) & mask;
+			for (;; i = (i + 1) & mask)
+			{
+				Slot& slot = slots[i];
+				if (slot.position < 0)
+				{
+					slot = { position, uv, normal, newIndex };
+					++count;
+					inserted = true;
+					return newIndex;
+				}
+				if (slot.position == position && slot.uv == uv && slot.normal == normal)
+				{
+					inserted = false;
+					return slot.index;
+				}
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			int position, uv, normal;
+			uint32_t index;
+		};
+
+		std::vector<Slot> slots;
+		size_t mask = 0;
+		size_t count = 0;
+
+		static size_t Hash(int position, int uv, int normal)
+		{
+			uint64_t h = uint64_t(uint32_t(position)) * 0x9E3779B97F4A7C15ull;
+			h ^= uint64_t(uint32_t(uv)) * 0xC2B2AE3D27D4EB4Full;
+			h ^= uint64_t(uint32_t(normal)) * 0x165667B19E3779F9ull;
+			return size_t(h ^ (h >> 32));
+		}
+
+		void Allocate(size_t capacity)
+		{
+			slots.assign(capacity, Slot{ -1, -1, -1, 0 });
+			mask = capacity - 1;
+			count = 0;
+		}
+
+		void Grow()
+		{
+			std::vector<Slot> old;
+			old.swap(slots);
+			Allocate(old.size() * 2);
+			for (const Slot& slot : old)
+			{
+				if (slot.position < 0)
+					continue;
+				size_t i = Hash(slot.position, slot.uv, slot.normal) & mask;
+				while (slots[i].position >= 0)
+					i = (i + 1) & mask;
+				slots[i] = slot;
+				++count;
+			}
+		}
+	};
+
+	///////////////////////////////////////////////////
+	//	UImportObj(const char*, ImportedModel&, ImportStats&)
+	//
+	//	filename: path of the .obj file
+	//	model: receives the geometry
+	//	stats: receives the bytes read and threads used
+	//
+	//	Parse the chunks in parallel, then weld the face
+	//	corners into indexed vertices
+	///////////////////////////////////////////////////
+	bool UImportObj(const char* filename, ImportedModel& model, ImportStats& stats)
+	{
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			LOG_ERROR << "ERROR::IMPORTER::CANNOT_OPEN " << filename;
+			return false;
+		}
+
+		const char* data = reinterpret_cast<const char*>(file.Data());
+		const size_t size = file.Size();
+		stats.bytes = size;
+
+		// split the file into chunks that end on line breaks
+		unsigned threads = UWorkerCount();
+		size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, size / MIN_CHUNK_BYTES));
+		std::vector<ObjChunk> chunks(chunkCount);
+		const char* chunkBegin = data;
+		for (size_t i = 0; i < chunkCount; ++i)
+		{
+			const char* chunkEnd = data + size * (i + 1) / chunkCount;
+			if (chunkEnd < chunkBegin)
+				chunkEnd = chunkBegin;
+			while (chunkEnd < data + size && chunkEnd[-1] != '\n')
+				++chunkEnd;
+			chunks[i].begin = chunkBegin;
+			chunks[i].end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+		stats.threads = unsigned(chunkCount);
+
+		UParallelFor(chunkCount, threads, [&](size_t i) { UParseObjChunk(chunks[i]); });
+
+		size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+		for (const ObjChunk& chunk : chunks)
+		{
+			if (chunk.error)
+			{
+				size_t line = 1 + std::count(data, chunk.error, '\n');
+				LOG_ERROR << "ERROR::IMPORTER::MALFORMED_OBJ " << filename << " line " << line;
+				return false;
+			}
+			positionCount += chunk.positions.size() / 3;
+			uvCount += chunk.uvs.size() / 2;
+			normalCount += chunk.normals.size() / 3;
+			cornerCount += chunk.corners.size();
+		}
+
+		// gather the attribute lists of all chunks
+		std::vector<float> positions, uvs, normals;
+		positions.reserve(positionCount * 3);
+		uvs.reserve(uvCount * 2);
+		normals.reserve(normalCount * 3);
+		for (const ObjChunk& chunk : chunks)
+		{
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		}
+
+		// weld the corners into indexed vertices
+		CornerTable table(cornerCount / 4);
+		std::unordered_map<std::string, uint32_t> materials;
+		std::vector<uint8_t> needsNormal;
+		model.indices.reserve(cornerCount);
+		UBeginSubmesh(model, 0);
+		uint32_t materialId = 0;
+
+		int positionBase = 0, uvBase = 0, normalBase = 0;
+		for (ObjChunk& chunk : chunks)
+		{
+			size_t event = 0;
+			for (size_t k = 0; k <= chunk.corners.size(); ++k)
+			{
+				for (; event < chunk.events.size() && chunk.events[event].corner == k; ++event)
+				{
+					if (chunk.events[event].isMaterial)
+						materialId = materials.emplace(chunk.events[event].name, uint32_t(materials.size())).first->second;
+					UEndSubmesh(model);
+					UBeginSubmesh(model, materialId);
+				}
+				if (k == chunk.corners.size())
+					break;
+
+				const ObjCorner& corner = chunk.corners[k];
+				int position = corner.position + (corner.relative & RELATIVE_POSITION ? positionBase : 0);
+				int uv = corner.uv + (corner.relative & RELATIVE_UV ? uvBase : 0);
+				int normal = corner.normal + (corner.relative & RELATIVE_NORMAL ? normalBase : 0);
+				bool hasUv = corner.uv != -1 || (corner.relative & RELATIVE_UV);
+				bool hasNormal = corner.normal != -1 || (corner.relative & RELATIVE_NORMAL);
+				if (position < 0 || size_t(position) >= positionCount ||
+					(hasUv && (uv < 0 || size_t(uv) >= uvCount)) ||
+					(hasNormal && (normal < 0 || size_t(normal) >= normalCount)))
+				{
+					LOG_ERROR << "ERROR::IMPORTER::INDEX_OUT_OF_RANGE " << filename;
+					model = ImportedModel();
+					return false;
+				}
+
+				bool inserted;
+				uint32_t index = table.FindOrInsert(position, uv, normal, model.VertexCount(), inserted);
+				if (inserted)
+				{
+					const float* p = &positions[size_t(position) * 3];
+					const float* n = normal >= 0 ? &normals[size_t(normal) * 3] : nullptr;
+					const float* t = uv >= 0 ? &uvs[size_t(uv) * 2] : nullptr;
+					model.vertices.insert(model.vertices.end(), {
+						p[0], p[1], p[2],
+						n ? n[0] : 0.0f, n ? n[1] : 0.0f, n ? n[2] : 0.0f,
+						t ? t[0] : 0.0f, t ? t[1] : 0.0f });
+					needsNormal.push_back(n == nullptr);
+				}
+				model.indices.push_back(index);
+			}
+
+			positionBase += int(chunk.positions.size() / 3);
+			uvBase += int(chunk.uvs.size() / 2);
+			normalBase += int(chunk.normals.size() / 3);
+
+			// release the chunk as soon as it is merged to keep the peak footprint down
+			chunk = ObjChunk();
+		}
+
+		UEndSubmesh(model);
+		if (!model.submeshes.empty() && model.submeshes.back().indexCount == 0)
+			model.submeshes.pop_back();
+
+		if (std::find(needsNormal.begin(), needsNormal.end(), uint8_t(1)) != needsNormal.end())
+			UGenerateNormals(model, needsNormal);
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// glTF 2.0
+	///////////////////////////////////////////////////////////////////////////
+
+	const uint32_t GLB_MAGIC = 0x46546C67;		// "glTF"
+	const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+	const int GLTF_BYTE = 5120;
+	const int GLTF_UNSIGNED_BYTE = 5121;
+	const int GLTF_SHORT = 5122;
+	const int GLTF_UNSIGNED_SHORT = 5123;
+	const int GLTF_UNSIGNED_INT = 5125;
+	const int GLTF_FLOAT = 5126;
+
+	const int GLTF_TRIANGLES = 4;
+	const int GLTF_TRIANGLE_STRIP = 5;
+	const int GLTF_TRIANGLE_FAN = 6;
+
+	struct GltfBuffer
+	{
+		const unsigned char* data;
+		size_t size;
+	};
+
+	// Typed, strided view of the elements of an accessor
+	struct GltfAccessor
+	{
+		const unsigned char* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		int componentType = 0;
+		int components = 0;
+		bool normalized = false;
+
+		float Component(size_t element, int component) const
+		{
+			const unsigned char* p = data + element * stride;
+			switch (componentType)
+			{
+			case GLTF_FLOAT:
+			{
+				float value;
+				memcpy(&value, p + component * 4, 4);
+				return value;
+			}
+			case GLTF_UNSIGNED_BYTE:
+				return normalized ? p[component] / 255.0f : float(p[component]);
+			case GLTF_BYTE:
+				return normalized ? std::max(int8_t(p[component]) / 127.0f, -1.0f) : float(int8_t(p[component]));
+			case GLTF_UNSIGNED_SHORT:
+			{
+				uint16_t value;
+				memcpy(&value, p + component * 2, 2);
+				return normalized ? value / 65535.0f : float(value);
+			}
+			case GLTF_SHORT:
+			{
+				int16_t value;
+				memcpy(&value, p + component * 2, 2);
+				return normalized ? std::max(value / 32767.0f, -1.0f) : float(value);
+			}
+			default:
+				return 0.0f;
+			}
+		}
+
+		uint32_t Index(size_t element) const
+		{
+			const unsigned char* p = data + element * stride;
+			switch (componentType)
+			{
+			case GLTF_UNSIGNED_BYTE:
+				return p[0];
+			case GLTF_UNSIGNED_SHORT:
+			{
+				uint16_t value;
+				memcpy(&value, p, 2);
+				return value;
+			}
+			default:
+			{
+				uint32_t value;
+				memcpy(&value, p, 4);
+				return value;
+			}
+			}
+		}
+	};
+
+	// One primitive drawn with the world matrix of the node that references it
+	struct GltfJob
+	{
+		const JsonValue* primitive;
+		float matrix[16];
+	};
+
+	struct GltfJobResult
+	{
+		std::vector<float> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<uint8_t> needsNormal;
+		const char* error = nullptr;
+	};
+
+	int UComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE:
+			return 1;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT:
+			return 2;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	int UComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	///////////////////////////////////////////////////
+	//	UGetAccessor(const JsonValue&, const std::vector<GltfBuffer>&, int, GltfAccessor&)
+	//
+	//	document: root of the glTF document
+	//	buffers: the loaded buffers
+	//	index: accessor index
+	//	accessor: receives the view of the data
+	//
+	//	Resolve an accessor through its buffer view and
+	//	check that every element lies inside the buffer
+	///////////////////////////////////////////////////
+	bool UGetAccessor(const JsonValue& document, const std::vector<GltfBuffer>& buffers, int index, GltfAccessor& accessor)
+	{
+		const JsonValue* accessors = document.Find("accessors");
+		const JsonValue* views = document.Find("bufferViews");
+		if (!accessors || index < 0 || size_t(index) >= accessors->Size() || !views)
+			return false;
+
+		const JsonValue& json = (*accessors)[index];
+		if (json.Find("sparse"))
+			return false;
+
+		accessor.componentType = json.GetInt("componentType", 0);
+		accessor.components = UComponentCount(json.GetString("type", ""));
+		accessor.count = size_t(json.GetNumber("count", 0));
+		accessor.normalized = json.GetBool("normalized", false);
+		int componentSize = UComponentSize(accessor.componentType);
+		if (componentSize == 0 || accessor.components == 0)
+			return false;
+
+		int viewIndex = json.GetInt("bufferView", -1);
+		if (viewIndex < 0 || size_t(viewIndex) >= views->Size())
+			return false;
+		const JsonValue& view = (*views)[viewIndex];
+
+		int bufferIndex = view.GetInt("buffer", -1);
+		if (bufferIndex < 0 || size_t(bufferIndex) >= buffers.size() || !buffers[bufferIndex].data)
+			return false;
+		const GltfBuffer& buffer = buffers[bufferIndex];
+
+		size_t viewOffset = size_t(view.GetNumber("byteOffset", 0));
+		size_t viewLength = size_t(view.GetNumber("byteLength", 0));
+		size_t elementSize = size_t(componentSize) * accessor.components;
+		accessor.stride = size_t(view.GetNumber("byteStride", 0));
+		if (accessor.stride == 0)
+			accessor.stride = elementSize;
+
+		size_t accessorOffset = size_t(json.GetNumber("byteOffset", 0));
+		if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset)
+			return false;
+		if (accessor.count > 0 && (accessorOffset > viewLength ||
+			(accessor.count - 1) * accessor.stride + elementSize > viewLength - accessorOffset))
+			return false;
+
+		accessor.data = buffer.data + viewOffset + accessorOffset;
+		return true;
+	}
+
+	// out = a * b, column major
+	void UMultiply(const float* a, const float* b, float* out)
+	{
+		float result[16];
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] +
+					a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+			}
+		}
+		memcpy(out, result, sizeof(result));
+	}
+
+	// Local matrix of a node from either its matrix or its translation/rotation/scale
+	void UNodeMatrix(const JsonValue& node, float* out)
+	{
+		const JsonValue* matrix = node.Find("matrix");
+		if (matrix && matrix->Size() == 16)
+		{
+			for (int i = 0; i < 16; ++i)
+				out[i] = float((*matrix)[i].number);
+			return;
+		}
+
+		float t[3] = { 0.0f, 0.0f, 0.0f };
+		float q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float s[3] = { 1.0f, 1.0f, 1.0f };
+		if (const JsonValue* translation = node.Find("translation"))
+			for (int i = 0; i < 3; ++i)
+				t[i] = float((*translation)[i].number);
+		if (const JsonValue* rotation = node.Find("rotation"))
+			for (int i = 0; i < 4; ++i)
+				q[i] = float((*rotation)[i].number);
+		if (const JsonValue* scale = node.Find("scale"))
+			for (int i = 0; i < 3; ++i)
+				s[i] = float((*scale)[i].number);
+
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+		const float rotation[9] = {
+			1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y)
+		};
+		for (int column = 0; column < 3; ++column)
+		{
+			for (int row = 0; row < 3; ++row)
+				out[column * 4 + row] = rotation[column * 3 + row] * s[column];
+			out[column * 4 + 3] = 0.0f;
+		}
+		out[12] = t[0];
+		out[13] = t[1];
+		out[14] = t[2];
+		out[15] = 1.0f;
+	}
+
+	void UCollectJobs(const JsonValue& document, int nodeIndex, const float* parent, int depth, std::vector<GltfJob>& jobs)
+	{
+		const JsonValue* nodes = document.Find("nodes");
+		if (!nodes || nodeIndex < 0 || size_t(nodeIndex) >= nodes->Size() || depth > MAX_NODE_DEPTH)
+			return;
+		const JsonValue& node = (*nodes)[nodeIndex];
+
+		float local[16], world[16];
+		UNodeMatrix(node, local);
+		UMultiply(parent, local, world);
+
+		const JsonValue* meshes = document.Find("meshes");
+		int meshIndex = node.GetInt("mesh", -1);
+		if (meshes && meshIndex >= 0 && size_t(meshIndex) < meshes->Size())
+		{
+			if (const JsonValue* primitives = (*meshes)[meshIndex].Find("primitives"))
+			{
+				for (const JsonValue& primitive : primitives->items)
+				{
+					GltfJob job;
+					job.primitive = &primitive;
+					memcpy(job.matrix, world, sizeof(world));
+					jobs.push_back(job);
+				}
+			}
+		}
+
+		if (const JsonValue* children = node.Find("children"))
+			for (const JsonValue& child : children->items)
+				UCollectJobs(document, int(child.number), world, depth + 1, jobs);
+	}
+
+	///////////////////////////////////////////////////
+	//	URunGltfJob(const JsonValue&, const std::vector<GltfBuffer>&, const GltfJob&, GltfJobResult&)
+	//
+	//	document: root of the glTF document
+	//	buffers: the loaded buffers
+	//	job: primitive and world matrix to convert
+	//	result: receives the vertices and triangle list
+	//
+	//	Interleave the attributes of one primitive in
+	//	world space and expand it to a triangle list
+	///////////////////////////////////////////////////
+	void URunGltfJob(const JsonValue& document, const std::vector<GltfBuffer>& buffers, const GltfJob& job, GltfJobResult& result)
+	{
+		const JsonValue& primitive = *job.primitive;
+		const JsonValue* attributes = primitive.Find("attributes");
+		int mode = primitive.GetInt("mode", GLTF_TRIANGLES);
+		if (mode != GLTF_TRIANGLES && mode != GLTF_TRIANGLE_STRIP && mode != GLTF_TRIANGLE_FAN)
+			return;		// points and lines have no surface to draw
+
+		GltfAccessor positions, normals, uvs;
+		if (!attributes || !UGetAccessor(document, buffers, attributes->GetInt("POSITION", -1), positions) ||
+			positions.componentType != GLTF_FLOAT || positions.components != 3)
+		{
+			result.error = "BAD_POSITIONS";
+			return;
+		}
+		bool hasNormals = UGetAccessor(document, buffers, attributes->GetInt("NORMAL", -1), normals) &&
+			normals.componentType == GLTF_FLOAT && normals.components == 3 && normals.count == positions.count;
+		bool hasUvs = UGetAccessor(document, buffers, attributes->GetInt("TEXCOORD_0", -1), uvs) &&
+			uvs.components == 2 && uvs.count == positions.count;
+
+		// normals transform with the cofactor matrix, which is the inverse
+		// transpose scaled by the determinant; they are renormalized anyway
+		const float* m = job.matrix;
+		float normalMatrix[9] = {
+			m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+			m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+			m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]
+		};
+		float determinant = m[0] * normalMatrix[0] + m[4] * normalMatrix[3] + m[8] * normalMatrix[6];
+		bool mirrored = determinant < 0.0f;
+
+		result.vertices.resize(positions.count * IMPORT_FLOATS_PER_VERTEX);
+		result.needsNormal.assign(positions.count, hasNormals ? 0 : 1);
+		for (size_t i = 0; i < positions.count; ++i)
+		{
+			float* v = &result.vertices[i * IMPORT_FLOATS_PER_VERTEX];
+			float x = positions.Component(i, 0), y = positions.Component(i, 1), z = positions.Component(i, 2);
+			v[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+			v[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+			v[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+
+			if (hasNormals)
+			{
+				float nx = normals.Component(i, 0), ny = normals.Component(i, 1), nz = normals.Component(i, 2);
+				float n[3] = {
+					normalMatrix[0] * nx + normalMatrix[3] * ny + normalMatrix[6] * nz,
+					normalMatrix[1] * nx + normalMatrix[4] * ny + normalMatrix[7] * nz,
+					normalMatrix[2] * nx + normalMatrix[5] * ny + normalMatrix[8] * nz
+				};
+				float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				float scale = length > 0.0f ? (mirrored ? -1.0f : 1.0f) / length : 0.0f;
+				v[3] = n[0] * scale;
+				v[4] = n[1] * scale;
+				v[5] = n[2] * scale;
+			}
+			else
+				v[3] = v[4] = v[5] = 0.0f;
+
+			// glTF puts the uv origin at the top left; our textures are flipped on load
+			v[6] = hasUvs ? uvs.Component(i, 0) : 0.0f;
+			v[7] = hasUvs ? 1.0f - uvs.Component(i, 1) : 0.0f;
+		}
+
+		std::vector<uint32_t> order;
+		GltfAccessor indices;
+		if (primitive.Find("indices"))
+		{
+			if (!UGetAccessor(document, buffers, primitive.GetInt("indices", -1), indices) || indices.components != 1 ||
+				(indices.componentType != GLTF_UNSIGNED_BYTE && indices.componentType != GLTF_UNSIGNED_SHORT &&
+					indices.componentType != GLTF_UNSIGNED_INT))
+			{
+				result.error = "BAD_INDICES";
+				return;
+			}
+			order.resize(indices.count);
+			for (size_t i = 0; i < indices.count; ++i)
+			{
+				order[i] = indices.Index(i);
+				if (order[i] >= positions.count)
+				{
+					result.error = "INDEX_OUT_OF_RANGE";
+					return;
+				}
+			}
+		}
+		else
+		{
+			order.resize(positions.count);
+			for (size_t i = 0; i < order.size(); ++i)
+				order[i] = uint32_t(i);
+		}
+
+		auto addTriangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+			if (mirrored)
+				std::swap(b, c);	// a mirroring transform flips the winding
+			result.indices.insert(result.indices.end(), { a, b, c });
+		};
+
+		if (mode == GLTF_TRIANGLES)
+		{
+			result.indices.reserve(order.size());
+			for (size_t i = 0; i + 2 < order.size(); i += 3)
+				addTriangle(order[i], order[i + 1], order[i + 2]);
+		}
+		else if (mode == GLTF_TRIANGLE_STRIP)
+		{
+			for (size_t i = 0; i + 2 < order.size(); ++i)
+			{
+				if (i % 2 == 0)
+					addTriangle(order[i], order[i + 1], order[i + 2]);
+				else
+					addTriangle(order[i + 1], order[i], order[i + 2]);
+			}
+		}
+		else
+		{
+			for (size_t i = 1; i + 1 < order.size(); ++i)
+				addTriangle(order[i], order[i + 1], order[0]);
+		}
+	}
+
+	// Decode a base64 data uri payload
+	bool UDecodeBase64(const std::string& text, std::vector<unsigned char>& out)
+	{
+		auto value = [](char c) -> int {
+			if (c >= 'A' && c <= 'Z') return c - 'A';
+			if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if (c >= '0' && c <= '9') return c - '0' + 52;
+			if (c == '+') return 62;
+			if (c == '/') return 63;
+			return -1;
+		};
+
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (char c : text)
+		{
+			if (c == '=')
+				break;
+			int v = value(c);
+			if (v < 0)
+				return false;
+			bits = (bits << 6) | uint32_t(v);
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				out.push_back((unsigned char)(bits >> bitCount));
+			}
+		}
+		return true;
+	}
+
+	///////////////////////////////////////////////////
+	//	UImportGltf(const char*, bool, ImportedModel&, ImportStats&)
+	//
+	//	filename: path of the .gltf or .glb file
+	//	binary: true for .glb
+	//	model: receives the geometry
+	//	stats: receives the bytes read and threads used
+	//
+	//	Load the document and its buffers, then convert
+	//	every primitive of the default scene in parallel
+	///////////////////////////////////////////////////
+	bool UImportGltf(const char* filename, bool binary, ImportedModel& model, ImportStats& stats)
+	{
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			LOG_ERROR << "ERROR::IMPORTER::CANNOT_OPEN " << filename;
+			return false;
+		}
+		stats.bytes = file.Size();
+
+		const char* json = reinterpret_cast<const char*>(file.Data());
+		size_t jsonLength = file.Size();
+		GltfBuffer glbBuffer = { nullptr, 0 };
+
+		if (binary)
+		{
+			uint32_t header[5];
+			if (file.Size() < sizeof(header))
+			{
+				LOG_ERROR << "ERROR::IMPORTER::NOT_A_GLB " << filename;
+				return false;
+			}
+			memcpy(header, file.Data(), sizeof(header));
+			// the declared length is checked against the header before the
+			// chunk length is checked against what follows it
+			if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > file.Size() || header[2] < sizeof(header) ||
+				header[4] != GLB_CHUNK_JSON || header[3] > header[2] - sizeof(header))
+			{
+				LOG_ERROR << "ERROR::IMPORTER::NOT_A_GLB " << filename;
+				return false;
+			}
+			json = reinterpret_cast<const char*>(file.Data() + sizeof(header));
+			jsonLength = header[3];
+
+			size_t binOffset = sizeof(header) + header[3];
+			uint32_t chunk[2];
+			if (binOffset + sizeof(chunk) <= header[2])
+			{
+				memcpy(chunk, file.Data() + binOffset, sizeof(chunk));
+				if (chunk[1] == GLB_CHUNK_BIN && chunk[0] <= header[2] - binOffset - sizeof(chunk))
+					glbBuffer = { file.Data() + binOffset + sizeof(chunk), chunk[0] };
+			}
+		}
+
+		JsonValue document;
+		std::string error;
+		if (!ParseJson(json, jsonLength, document, &error))
+		{
+			LOG_ERROR << "ERROR::IMPORTER::BAD_JSON " << filename << ": " << error;
+			return false;
+		}
+
+		// load the buffers: the GLB chunk, embedded data uris or external files
+		std::vector<GltfBuffer> buffers;
+		std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+		std::vector<std::vector<unsigned char>> decoded;
+		if (const JsonValue* bufferList = document.Find("buffers"))
+		{
+			decoded.reserve(bufferList->Size());
+			for (const JsonValue& buffer : bufferList->items)
+			{
+				std::string uri = buffer.GetString("uri", "");
+				size_t length = size_t(buffer.GetNumber("byteLength", 0));
+				GltfBuffer loaded = { nullptr, 0 };
+
+				if (uri.empty())
+					loaded = glbBuffer;
+				else if (uri.compare(0, 5, "data:") == 0)
+				{
+					size_t comma = uri.find(";base64,");
+					decoded.emplace_back();
+					if (comma != std::string::npos && UDecodeBase64(uri.substr(comma + 8), decoded.back()))
+						loaded = { decoded.back().data(), decoded.back().size() };
+				}
+				else
+				{
+					bufferFiles.emplace_back(new MappedFile());
+					std::string path = UDirectory(filename) + uri;
+					if (bufferFiles.back()->Open(path.c_str()))
+					{
+						loaded = { bufferFiles.back()->Data(), bufferFiles.back()->Size() };
+						stats.bytes += loaded.size;
+					}
+				}
+
+				if (!loaded.data || loaded.size < length)
+				{
+					LOG_ERROR << "ERROR::IMPORTER::MISSING_BUFFER " << filename << " " << uri;
+					return false;
+				}
+				buffers.push_back(loaded);
+			}
+		}
+
+		// instance the primitives of the default scene, or of every root node without one
+		static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		std::vector<GltfJob> jobs;
+		const JsonValue* scenes = document.Find("scenes");
+		const JsonValue* nodes = document.Find("nodes");
+		if (scenes && scenes->Size() > 0)
+		{
+			const JsonValue& scene = (*scenes)[size_t(document.GetInt("scene", 0))];
+			if (const JsonValue* roots = scene.Find("nodes"))
+				for (const JsonValue& root : roots->items)
+					UCollectJobs(document, int(root.number), identity, 0, jobs);
+		}
+		else if (nodes)
+		{
+			std::vector<uint8_t> isChild(nodes->Size(), 0);
+			for (const JsonValue& node : nodes->items)
+				if (const JsonValue* children = node.Find("children"))
+					for (const JsonValue& child : children->items)
+						if (child.number >= 0 && size_t(child.number) < isChild.size())
+							isChild[size_t(child.number)] = 1;
+			for (size_t i = 0; i < isChild.size(); ++i)
+				if (!isChild[i])
+					UCollectJobs(document, int(i), identity, 0, jobs);
+		}
+
+		unsigned threads = UWorkerCount();
+		stats.threads = unsigned(std::min<size_t>(threads, std::max<size_t>(jobs.size(), 1)));
+		std::vector<GltfJobResult> results(jobs.size());
+		UParallelFor(jobs.size(), threads, [&](size_t i) { URunGltfJob(document, buffers, jobs[i], results[i]); });
+
+		// concatenate the primitives, one submesh each
+		size_t vertexCount = 0, indexCount = 0;
+		for (const GltfJobResult& result : results)
+		{
+			if (result.error)
+			{
+				LOG_ERROR << "ERROR::IMPORTER::" << result.error << " " << filename;
+				return false;
+			}
+			vertexCount += result.vertices.size();
+			indexCount += result.indices.size();
+		}
+
+		std::vector<uint8_t> needsNormal;
+		model.vertices.reserve(vertexCount);
+		model.indices.reserve(indexCount);
+		needsNormal.reserve(vertexCount / IMPORT_FLOATS_PER_VERTEX);
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const GltfJobResult& result = results[i];
+			if (result.indices.empty())
+				continue;
+
+			uint32_t base = model.VertexCount();
+			UBeginSubmesh(model, uint32_t(std::max(0, jobs[i].primitive->GetInt("material", 0))));
+			model.vertices.insert(model.vertices.end(), result.vertices.begin(), result.vertices.end());
+			needsNormal.insert(needsNormal.end(), result.needsNormal.begin(), result.needsNormal.end());
+			for (uint32_t index : result.indices)
+				model.indices.push_back(base + index);
+			UEndSubmesh(model);
+		}
+
+		if (std::find(needsNormal.begin(), needsNormal.end(), uint8_t(1)) != needsNormal.end())
+			UGenerateNormals(model, needsNormal);
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////
+//	ImportModel(const char*, ImportedModel&, ImportStats*)
+//
+//	filename: path of a .obj, .gltf or .glb file
+//	model: receives the geometry
+//	stats: optional, receives the parse throughput
+//
+//	Import a model file into the interleaved vertex
+//	layout of the built-in meshes
+///////////////////////////////////////////////////
+bool ImportModel(const char* filename, ImportedModel& model, ImportStats* stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	model = ImportedModel();
+	ImportStats localStats;
+
+	std::string extension = UExtension(filename);
+	bool ok;
+	if (extension == "obj")
+		ok = UImportObj(filename, model, localStats);
+	else if (extension == "gltf" || extension == "glb")
+		ok = UImportGltf(filename, extension == "glb", model, localStats);
+	else
+	{
+		LOG_ERROR << "ERROR::IMPORTER::UNKNOWN_FORMAT " << filename;
+		ok = false;
+	}
+
+	if (ok && model.indices.empty())
+	{
+		LOG_ERROR << "ERROR::IMPORTER::NO_TRIANGLES " << filename;
+		ok = false;
+	}
+
+	if (ok)
+		UComputeModelBounds(model);
+	else
+		model = ImportedModel();
+
+	localStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats)
+		*stats = localStats;
+	return ok;
+}
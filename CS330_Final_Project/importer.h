@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// importer.h
+// ========
+// streaming Wavefront OBJ and glTF 2.0 importer
+//
+// Produces the interleaved position/normal/uv vertex layout used by the
+// built-in meshes, with 32-bit indices. No GL calls are made here, so the
+// importer is shared by the renderer and the offline mesh converter.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "meshfile.h"
+
+const uint32_t IMPORT_FLOATS_PER_VERTEX = 8;	// position 3, normal 3, uv 2
+
+// Geometry of a whole imported file, flattened into one vertex and index list
+struct ImportedModel
+{
+	std::vector<float> vertices;				// interleaved position, normal, uv
+	std::vector<uint32_t> indices;				// triangle list
+	std::vector<MeshFileSubmesh> submeshes;		// one per OBJ group/material or glTF primitive
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+
+	uint32_t VertexCount() const { return uint32_t(vertices.size() / IMPORT_FLOATS_PER_VERTEX); }
+};
+
+// Timing of one import, so parse throughput regressions are easy to spot
+struct ImportStats
+{
+	uint64_t bytes = 0;			// bytes of source data read, including glTF buffers
+	double seconds = 0.0;		// wall time from opening the file to the finished model
+	unsigned threads = 1;		// worker threads used
+
+	double MegabytesPerSecond() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+};
+
+// Import a .obj, .gltf or .glb file, picked by extension. Errors are logged
+// as ERROR::IMPORTER::... and leave the model empty.
+bool ImportModel(const char* filename, ImportedModel& model, ImportStats* stats = nullptr);
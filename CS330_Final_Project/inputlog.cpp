@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputlog.cpp
+// ========
+// records keyboard and mouse events to a binary log and plays them back
+///////////////////////////////////////////////////////////////////////////////
+
+#include "inputlog.h"
+#include "logging.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	int64_t UNowMicroseconds()
+	{
+		using namespace std::chrono;
+		return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+InputRecorder::~InputRecorder()
+{
+	Close();
+}
+
+bool InputRecorder::Open(const char* filename)
+{
+	out.open(filename, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		LOG_ERROR << "ERROR::INPUTLOG::CANNOT_CREATE " << filename;
+		return false;
+	}
+
+	InputLogHeader header;
+	memcpy(header.magic, "INLG", 4);
+	header.version = INPUT_LOG_VERSION;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	lastTime = UNowMicroseconds();
+	return true;
+}
+
+void InputRecorder::Record(InputEventType type, int code, int action, double x, double y)
+{
+	if (!out.is_open())
+		return;
+
+	int64_t now = UNowMicroseconds();
+	int64_t delta = now - lastTime;
+	lastTime = now;
+
+	InputEvent event;
+	event.deltaMicroseconds = uint32_t(delta > int64_t(UINT32_MAX) ? UINT32_MAX : delta);
+	event.type = type;
+	event.action = uint8_t(action);
+	event.code = uint16_t(code);
+	event.x = float(x);
+	event.y = float(y);
+	out.write(reinterpret_cast<const char*>(&event), sizeof(event));
+}
+
+void InputRecorder::Close()
+{
+	if (!out.is_open())
+		return;
+	Record(InputEnd, 0, 0, 0.0, 0.0);
+	out.close();
+}
+
+///////////////////////////////////////////////////
+//	Open(const char*)
+//
+//	filename: log written by InputRecorder
+//
+//	Read the whole log up front so playback never
+//	touches the disk while frames are being timed
+///////////////////////////////////////////////////
+bool InputPlayer::Open(const char* filename)
+{
+	std::ifstream in(filename, std::ios::binary | std::ios::ate);
+	if (!in)
+	{
+		LOG_ERROR << "ERROR::INPUTLOG::CANNOT_OPEN " << filename;
+		return false;
+	}
+
+	std::streamoff size = in.tellg();
+	in.seekg(0);
+	InputLogHeader header;
+	if (size < std::streamoff(sizeof(header)) || !in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		memcmp(header.magic, "INLG", 4) != 0 || header.version != INPUT_LOG_VERSION)
+	{
+		LOG_ERROR << "ERROR::INPUTLOG::BAD_HEADER " << filename;
+		return false;
+	}
+
+	size_t count = size_t(size - std::streamoff(sizeof(header))) / sizeof(InputEvent);
+	events.resize(count);
+	if (count > 0 && !in.read(reinterpret_cast<char*>(events.data()), count * sizeof(InputEvent)))
+	{
+		LOG_ERROR << "ERROR::INPUTLOG::TRUNCATED " << filename;
+		events.clear();
+		return false;
+	}
+
+	next = 0;
+	eventTime = events.empty() ? 0 : events[0].deltaMicroseconds;
+	simulatedTime = 0.0;
+	open = true;
+	return true;
+}
+
+bool InputPlayer::NextFrame(double step, std::vector<InputEvent>& due)
+{
+	due.clear();
+	if (next >= events.size())
+		return false;
+
+	simulatedTime += step;
+	uint64_t now = uint64_t(simulatedTime * 1000000.0);
+	while (next < events.size() && eventTime <= now)
+	{
+		if (events[next].type != InputEnd)
+			due.push_back(events[next]);
+		if (++next < events.size())
+			eventTime += events[next].deltaMicroseconds;
+	}
+	return true;
+}
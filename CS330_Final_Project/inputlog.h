@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputlog.h
+// ========
+// records keyboard and mouse events to a binary log and plays them back
+//
+// File layout, little endian:
+//   InputLogHeader
+//   InputEvent[]		until the end of the file, the last one is InputEnd
+//
+// Each event stores the microseconds since the previous one, so a log never
+// overflows and times are exact integers. Playback advances a simulated clock
+// by a fixed step per frame, which makes the camera path of a replay identical
+// on every run and every build regardless of how long the frames take.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+const uint32_t INPUT_LOG_VERSION = 1;
+
+struct InputLogHeader
+{
+	char magic[4];				// "INLG"
+	uint32_t version;			// INPUT_LOG_VERSION
+};
+
+enum InputEventType : uint8_t
+{
+	InputKey,					// code: GLFW key, action: GLFW_PRESS/RELEASE/REPEAT
+	InputCursor,				// x, y: cursor position
+	InputScroll,				// x, y: scroll offsets
+	InputMouseButton,			// code: GLFW button, action: GLFW_PRESS/RELEASE
+	InputEnd					// when recording stopped
+};
+
+struct InputEvent
+{
+	uint32_t deltaMicroseconds;	// time since the previous event
+	uint8_t type;				// InputEventType
+	uint8_t action;
+	uint16_t code;
+	float x;
+	float y;
+};
+
+static_assert(sizeof(InputLogHeader) == 8, "input log header layout changed");
+static_assert(sizeof(InputEvent) == 16, "input event layout changed");
+
+class InputRecorder
+{
+public:
+	~InputRecorder();
+
+	bool Open(const char* filename);
+	bool IsOpen() const { return out.is_open(); }
+
+	// Append an event stamped with the time since the previous one
+	void Record(InputEventType type, int code, int action, double x, double y);
+
+	// Write the InputEnd marker and close the file
+	void Close();
+
+private:
+	std::ofstream out;
+	int64_t lastTime = 0;		// microseconds, steady clock
+};
+
+class InputPlayer
+{
+public:
+	bool Open(const char* filename);
+	bool IsOpen() const { return open; }
+
+	// Advance the simulated clock by step seconds and return the events
+	// that became due. Returns false once the whole log has been played.
+	bool NextFrame(double step, std::vector<InputEvent>& due);
+
+private:
+	std::vector<InputEvent> events;
+	size_t next = 0;
+	uint64_t eventTime = 0;		// microseconds, time of events[next]
+	double simulatedTime = 0.0;	// seconds
+	bool open = false;
+};
@@ -0,0 +1,358 @@
+///////////////////////////////////////////////////////////////////////////////
+// json.cpp
+// ========
+// small JSON document reader for glTF and other data files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "json.h"
+#include "textparse.h"
+
+#include <cstring>
+
+namespace
+{
+	const int MAX_DEPTH = 256;
+
+	// Recursive descent parser over an in-memory document
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* text, size_t length)
+			: begin(text), cursor(text), end(text + length)
+		{
+		}
+
+		bool ParseDocument(JsonValue& value)
+		{
+			if (!ParseValue(value, 0))
+				return false;
+			SkipWhitespace();
+			if (cursor != end)
+				return Fail("trailing characters after the document");
+			return true;
+		}
+
+		std::string ErrorMessage() const
+		{
+			int line = 1;
+			for (const char* p = begin; p < errorAt; ++p)
+				line += *p == '\n';
+			return std::string(error) + " at line " + std::to_string(line);
+		}
+
+	private:
+		const char* begin;
+		const char* cursor;
+		const char* end;
+		const char* error = "";
+		const char* errorAt = nullptr;
+
+		bool Fail(const char* message)
+		{
+			error = message;
+			errorAt = cursor;
+			return false;
+		}
+
+		void SkipWhitespace()
+		{
+			while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+				++cursor;
+		}
+
+		bool Expect(const char* literal)
+		{
+			size_t length = strlen(literal);
+			if (size_t(end - cursor) < length || memcmp(cursor, literal, length) != 0)
+				return Fail("unexpected token");
+			cursor += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			if (depth > MAX_DEPTH)
+				return Fail("document nested too deeply");
+
+			SkipWhitespace();
+			if (cursor == end)
+				return Fail("unexpected end of document");
+
+			switch (*cursor)
+			{
+			case '{':
+				return ParseObject(value, depth);
+			case '[':
+				return ParseArray(value, depth);
+			case '"':
+				value.type = JsonValue::String;
+				return ParseString(value.string);
+			case 't':
+				value.type = JsonValue::Bool;
+				value.boolean = true;
+				return Expect("true");
+			case 'f':
+				value.type = JsonValue::Bool;
+				value.boolean = false;
+				return Expect("false");
+			case 'n':
+				value.type = JsonValue::Null;
+				return Expect("null");
+			default:
+				value.type = JsonValue::Number;
+				if (!ParseDouble(cursor, end, value.number))
+					return Fail("unexpected character");
+				return true;
+			}
+		}
+
+		bool ParseObject(JsonValue& value, int depth)
+		{
+			value.type = JsonValue::Object;
+			++cursor;	// {
+			SkipWhitespace();
+			if (cursor < end && *cursor == '}')
+			{
+				++cursor;
+				return true;
+			}
+
+			for (;;)
+			{
+				SkipWhitespace();
+				if (cursor == end || *cursor != '"')
+					return Fail("expected a member name");
+
+				value.members.emplace_back();
+				if (!ParseString(value.members.back().first))
+					return false;
+
+				SkipWhitespace();
+				if (cursor == end || *cursor != ':')
+					return Fail("expected ':'");
+				++cursor;
+
+				if (!ParseValue(value.members.back().second, depth + 1))
+					return false;
+
+				SkipWhitespace();
+				if (cursor < end && *cursor == ',')
+				{
+					++cursor;
+					continue;
+				}
+				if (cursor < end && *cursor == '}')
+				{
+					++cursor;
+					return true;
+				}
+				return Fail("expected ',' or '}'");
+			}
+		}
+
+		bool ParseArray(JsonValue& value, int depth)
+		{
+			value.type = JsonValue::Array;
+			++cursor;	// [
+			SkipWhitespace();
+			if (cursor < end && *cursor == ']')
+			{
+				++cursor;
+				return true;
+			}
+
+			for (;;)
+			{
+				value.items.emplace_back();
+				if (!ParseValue(value.items.back(), depth + 1))
+					return false;
+
+				SkipWhitespace();
+				if (cursor < end && *cursor == ',')
+				{
+					++cursor;
+					continue;
+				}
+				if (cursor < end && *cursor == ']')
+				{
+					++cursor;
+					return true;
+				}
+				return Fail("expected ',' or ']'");
+			}
+		}
+
+		static void AppendUtf8(std::string& out, unsigned codePoint)
+		{
+			if (codePoint < 0x80)
+				out += char(codePoint);
+			else if (codePoint < 0x800)
+			{
+				out += char(0xC0 | (codePoint >> 6));
+				out += char(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				out += char(0xE0 | (codePoint >> 12));
+				out += char(0x80 | ((codePoint >> 6) & 0x3F));
+				out += char(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				out += char(0xF0 | (codePoint >> 18));
+				out += char(0x80 | ((codePoint >> 12) & 0x3F));
+				out += char(0x80 | ((codePoint >> 6) & 0x3F));
+				out += char(0x80 | (codePoint & 0x3F));
+			}
+		}
+
+		bool ParseHex4(unsigned& codePoint)
+		{
+			if (end - cursor < 4)
+				return Fail("truncated \\u escape");
+			codePoint = 0;
+			for (int i = 0; i < 4; ++i, ++cursor)
+			{
+				char c = *cursor;
+				unsigned digit;
+				if (c >= '0' && c <= '9')
+					digit = unsigned(c - '0');
+				else if (c >= 'a' && c <= 'f')
+					digit = unsigned(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F')
+					digit = unsigned(c - 'A' + 10);
+				else
+					return Fail("bad \\u escape");
+				codePoint = codePoint * 16 + digit;
+			}
+			return true;
+		}
+
+		bool ParseString(std::string& out)
+		{
+			++cursor;	// opening quote
+			for (;;)
+			{
+				// copy the run of plain characters in one go
+				const char* run = cursor;
+				while (cursor < end && *cursor != '"' && *cursor != '\\')
+					++cursor;
+				out.append(run, cursor);
+
+				if (cursor == end)
+					return Fail("unterminated string");
+				if (*cursor == '"')
+				{
+					++cursor;
+					return true;
+				}
+
+				++cursor;	// backslash
+				if (cursor == end)
+					return Fail("unterminated string");
+				char escape = *cursor++;
+				switch (escape)
+				{
+				case '"':	out += '"'; break;
+				case '\\':	out += '\\'; break;
+				case '/':	out += '/'; break;
+				case 'b':	out += '\b'; break;
+				case 'f':	out += '\f'; break;
+				case 'n':	out += '\n'; break;
+				case 'r':	out += '\r'; break;
+				case 't':	out += '\t'; break;
+				case 'u':
+				{
+					unsigned codePoint;
+					if (!ParseHex4(codePoint))
+						return false;
+					// combine a UTF-16 surrogate pair
+					if (codePoint >= 0xD800 && codePoint < 0xDC00 && end - cursor >= 6 && cursor[0] == '\\' && cursor[1] == 'u')
+					{
+						cursor += 2;
+						unsigned low;
+						if (!ParseHex4(low))
+							return false;
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(out, codePoint);
+					break;
+				}
+				default:
+					return Fail("bad escape sequence");
+				}
+			}
+		}
+	};
+}
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+	if (type != Object)
+		return nullptr;
+	for (const auto& member : members)
+	{
+		if (member.first == key)
+			return &member.second;
+	}
+	return nullptr;
+}
+
+double JsonValue::GetNumber(const char* key, double fallback) const
+{
+	const JsonValue* value = Find(key);
+	return value && value->type == Number ? value->number : fallback;
+}
+
+int JsonValue::GetInt(const char* key, int fallback) const
+{
+	const JsonValue* value = Find(key);
+	return value && value->type == Number ? int(value->number) : fallback;
+}
+
+bool JsonValue::GetBool(const char* key, bool fallback) const
+{
+	const JsonValue* value = Find(key);
+	return value && value->type == Bool ? value->boolean : fallback;
+}
+
+std::string JsonValue::GetString(const char* key, const char* fallback) const
+{
+	const JsonValue* value = Find(key);
+	return value && value->type == String ? value->string : std::string(fallback);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	static const JsonValue null;
+	return type == Array && index < items.size() ? items[index] : null;
+}
+
+///////////////////////////////////////////////////
+//	ParseJson(const char*, size_t, JsonValue&, std::string*)
+//
+//	text: the document, need not be null terminated
+//	length: size of the document in bytes
+//	value: receives the root value
+//	error: optional, receives a message on failure
+//
+//	Parse a complete JSON document into a tree
+///////////////////////////////////////////////////
+bool ParseJson(const char* text, size_t length, JsonValue& value, std::string* error)
+{
+	// skip a UTF-8 byte order mark
+	if (length >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)
+	{
+		text += 3;
+		length -= 3;
+	}
+
+	value = JsonValue();
+	JsonParser parser(text, length);
+	if (parser.ParseDocument(value))
+		return true;
+
+	if (error)
+		*error = parser.ErrorMessage();
+	return false;
+}
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// json.h
+// ========
+// small JSON document reader for glTF and other data files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+class JsonValue
+{
+public:
+	enum Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type type = Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> items;								// Array elements
+	std::vector<std::pair<std::string, JsonValue>> members;		// Object members, in file order
+
+	bool IsNull() const { return type == Null; }
+	bool IsNumber() const { return type == Number; }
+	bool IsString() const { return type == String; }
+	bool IsArray() const { return type == Array; }
+	bool IsObject() const { return type == Object; }
+
+	// Member lookup; returns nullptr when this is not an object or the key is missing
+	const JsonValue* Find(const char* key) const;
+
+	// Member lookups with a fallback for missing or mistyped members
+	double GetNumber(const char* key, double fallback) const;
+	int GetInt(const char* key, int fallback) const;
+	bool GetBool(const char* key, bool fallback) const;
+	std::string GetString(const char* key, const char* fallback) const;
+
+	// Array element, or a shared null value when out of range
+	const JsonValue& operator[](size_t index) const;
+	size_t Size() const { return type == Array ? items.size() : members.size(); }
+};
+
+// Parse a whole document. On failure error receives a message with the line number.
+bool ParseJson(const char* text, size_t length, JsonValue& value, std::string* error = nullptr);
@@ -0,0 +1,452 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapper.cpp
+// ========
+// bakes the diffuse lighting of static objects into a lightmap atlas
+///////////////////////////////////////////////////////////////////////////////
+
+#include "lightmapper.h"
+#include "bounds.h"
+#include "logging.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	const int CELL_PADDING = 1;			// texels between a chart and the edges of its cell
+	const int MIN_CELL_SIZE = 4;
+	const int MAX_ATLAS_SIZE = 4096;
+	const int ROWS_PER_JOB = 8;
+	const int LEAF_TRIANGLES = 4;
+	const float RAY_OFFSET = 0.001f;	// keeps rays from hitting the surface they leave
+	const float PI = 3.14159265358979f;
+
+	// World space triangle with its vertex normals
+	struct Triangle
+	{
+		glm::vec3 position[3];
+		glm::vec3 normal[3];
+		int instance;
+	};
+
+	struct Hit
+	{
+		float t;
+		float u, v;			// barycentric weights of corners 1 and 2
+		uint32_t triangle;
+	};
+
+	// Bounding volume hierarchy split at the median of the longest axis
+	class Bvh
+	{
+	public:
+		void Build(const std::vector<Triangle>& source)
+		{
+			triangles = source;
+			nodes.clear();
+			nodes.reserve(2 * triangles.size() / LEAF_TRIANGLES + 1);
+			nodes.emplace_back();
+			if (!triangles.empty())
+				UBuild(0, 0, uint32_t(triangles.size()));
+		}
+
+		bool Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMax, Hit& hit) const
+		{
+			hit.t = tMax;
+			return UTraverse(origin, direction, hit, false);
+		}
+
+		bool Occluded(const glm::vec3& origin, const glm::vec3& direction, float tMax) const
+		{
+			Hit hit;
+			hit.t = tMax;
+			return UTraverse(origin, direction, hit, true);
+		}
+
+		const Triangle& GetTriangle(uint32_t index) const { return triangles[index]; }
+
+	private:
+		struct Node
+		{
+			Bounds bounds;
+			uint32_t first = 0;		// leaf: first triangle; inner: left child, right is next
+			uint32_t count = 0;		// triangles in a leaf, 0 for an inner node
+		};
+
+		std::vector<Triangle> triangles;
+		std::vector<Node> nodes;
+
+		void UBuild(uint32_t node, uint32_t first, uint32_t count)
+		{
+			Bounds bounds, centroids;
+			for (uint32_t i = first; i < first + count; ++i)
+			{
+				for (const glm::vec3& position : triangles[i].position)
+					bounds.Expand(position);
+				centroids.Expand(UCentroid(triangles[i]));
+			}
+			nodes[node].bounds = bounds;
+
+			glm::vec3 extent = centroids.max - centroids.min;
+			if (count <= uint32_t(LEAF_TRIANGLES) || std::max(extent.x, std::max(extent.y, extent.z)) <= 0.0f)
+			{
+				nodes[node].first = first;
+				nodes[node].count = count;
+				return;
+			}
+
+			int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+			uint32_t half = count / 2;
+			std::nth_element(triangles.begin() + first, triangles.begin() + first + half, triangles.begin() + first + count,
+				[axis](const Triangle& a, const Triangle& b) { return UCentroid(a)[axis] < UCentroid(b)[axis]; });
+
+			uint32_t left = uint32_t(nodes.size());
+			nodes[node].first = left;
+			nodes.emplace_back();
+			nodes.emplace_back();
+			UBuild(left, first, half);
+			UBuild(left + 1, first + half, count - half);
+		}
+
+		static glm::vec3 UCentroid(const Triangle& triangle)
+		{
+			return (triangle.position[0] + triangle.position[1] + triangle.position[2]) / 3.0f;
+		}
+
+		// Slab test; true when the ray enters the box before tMax
+		static bool UHitsBox(const Bounds& bounds, const glm::vec3& origin, const glm::vec3& inverse, float tMax)
+		{
+			float tNear = 0.0f, tFar = tMax;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float t0 = (bounds.min[axis] - origin[axis]) * inverse[axis];
+				float t1 = (bounds.max[axis] - origin[axis]) * inverse[axis];
+				tNear = std::max(tNear, std::min(t0, t1));
+				tFar = std::min(tFar, std::max(t0, t1));
+			}
+			return tNear <= tFar;
+		}
+
+		// Moller-Trumbore, both sides
+		static bool UHitsTriangle(const Triangle& triangle, const glm::vec3& origin, const glm::vec3& direction, Hit& hit)
+		{
+			glm::vec3 edge1 = triangle.position[1] - triangle.position[0];
+			glm::vec3 edge2 = triangle.position[2] - triangle.position[0];
+			glm::vec3 p = glm::cross(direction, edge2);
+			float determinant = glm::dot(edge1, p);
+			if (std::fabs(determinant) < 1e-12f)
+				return false;
+			float inverse = 1.0f / determinant;
+			glm::vec3 s = origin - triangle.position[0];
+			float u = glm::dot(s, p) * inverse;
+			if (u < 0.0f || u > 1.0f)
+				return false;
+			glm::vec3 q = glm::cross(s, edge1);
+			float v = glm::dot(direction, q) * inverse;
+			if (v < 0.0f || u + v > 1.0f)
+				return false;
+			float t = glm::dot(edge2, q) * inverse;
+			if (t <= 0.0f || t >= hit.t)
+				return false;
+			hit.t = t;
+			hit.u = u;
+			hit.v = v;
+			return true;
+		}
+
+		bool UTraverse(const glm::vec3& origin, const glm::vec3& direction, Hit& hit, bool anyHit) const
+		{
+			if (triangles.empty())
+				return false;
+
+			glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+			uint32_t stack[64];
+			int depth = 0;
+			stack[depth++] = 0;
+			bool found = false;
+			while (depth > 0)
+			{
+				const Node& node = nodes[stack[--depth]];
+				if (!UHitsBox(node.bounds, origin, inverse, hit.t))
+					continue;
+				if (node.count == 0)
+				{
+					stack[depth++] = node.first;
+					stack[depth++] = node.first + 1;
+					continue;
+				}
+				for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				{
+					if (UHitsTriangle(triangles[i], origin, direction, hit))
+					{
+						hit.triangle = i;
+						found = true;
+						if (anyHit)
+							return true;
+					}
+				}
+			}
+			return found;
+		}
+	};
+
+	// xorshift generator, one per texel so the bake is the same on any thread count
+	struct URandom
+	{
+		uint32_t state;
+
+		explicit URandom(uint32_t seed) : state(seed * 2654435761u + 0x9E3779B9u) { Next(); }
+
+		float Next()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return float(state >> 8) / 16777216.0f;
+		}
+	};
+
+	// Cosine weighted direction about normal
+	glm::vec3 UCosineSample(const glm::vec3& normal, URandom& random)
+	{
+		// orthonormal basis of Duff et al.
+		float sign = normal.z >= 0.0f ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+
+		float r = std::sqrt(random.Next());
+		float phi = 2.0f * PI * random.Next();
+		float height = std::sqrt(std::max(0.0f, 1.0f - r * r));
+		return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + normal * height;
+	}
+
+	float ULuminance(const glm::vec3& color)
+	{
+		return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+	}
+
+	struct UBaker
+	{
+		const Bvh& bvh;
+		const std::vector<LightmapInstance>& instances;
+		const LightmapLight* lights;
+		size_t lightCount;
+		const LightmapSettings& settings;
+
+		// Diffuse light from the point lights at point; visibility receives the
+		// unshadowed fraction of the light
+		glm::vec3 Direct(const glm::vec3& point, const glm::vec3& normal, float* visibility) const
+		{
+			glm::vec3 light(0.0f);
+			float visible = 0.0f, total = 0.0f;
+			glm::vec3 origin = point + normal * RAY_OFFSET;
+			for (size_t i = 0; i < lightCount; ++i)
+			{
+				glm::vec3 toLight = lights[i].position - origin;
+				float distance = glm::length(toLight);
+				float weight = ULuminance(lights[i].color);
+				total += weight;
+				if (distance <= 0.0f)
+					continue;
+				glm::vec3 direction = toLight / distance;
+				float impact = glm::dot(normal, direction);
+				if (impact <= 0.0f || bvh.Occluded(origin, direction, distance))
+					continue;
+				light += impact * lights[i].color;
+				visible += weight;
+			}
+			if (visibility)
+				*visibility = total > 0.0f ? visible / total : 1.0f;
+			return light;
+		}
+
+		// Light bounced towards point from the rest of the scene
+		glm::vec3 Indirect(const glm::vec3& point, const glm::vec3& normal, URandom& random) const
+		{
+			glm::vec3 sum(0.0f);
+			for (int sample = 0; sample < settings.samples; ++sample)
+			{
+				glm::vec3 origin = point + normal * RAY_OFFSET;
+				glm::vec3 direction = UCosineSample(normal, random);
+				glm::vec3 throughput(1.0f);
+				for (int bounce = 0; bounce < settings.bounces; ++bounce)
+				{
+					Hit hit;
+					if (!bvh.Intersect(origin, direction, FLT_MAX, hit))
+						break;
+
+					const Triangle& triangle = bvh.GetTriangle(hit.triangle);
+					float w = 1.0f - hit.u - hit.v;
+					glm::vec3 hitPoint = origin + direction * hit.t;
+					glm::vec3 hitNormal = glm::normalize(triangle.normal[0] * w + triangle.normal[1] * hit.u +
+						triangle.normal[2] * hit.v);
+					if (glm::dot(hitNormal, direction) > 0.0f)
+						hitNormal = -hitNormal;		// the back of a two sided surface
+
+					// a cosine weighted estimate of a Lambertian surface is albedo * irradiance
+					throughput *= instances[triangle.instance].albedo;
+					sum += throughput * Direct(hitPoint, hitNormal, nullptr);
+
+					origin = hitPoint + hitNormal * RAY_OFFSET;
+					direction = UCosineSample(hitNormal, random);
+				}
+			}
+			return settings.samples > 0 ? sum / float(settings.samples) : sum;
+		}
+	};
+
+	// World space copies of an instance's triangles
+	void UAppendTriangles(const LightmapInstance& instance, int index, std::vector<Triangle>& triangles)
+	{
+		const MeshData& mesh = *instance.triangles;
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.model)));
+		const float* vertex = mesh.vertices.data();
+		for (uint32_t i = 0; i + 2 < mesh.VertexCount(); i += 3)
+		{
+			Triangle triangle;
+			triangle.instance = index;
+			for (int j = 0; j < 3; ++j, vertex += mesh.floatsPerEntry)
+			{
+				triangle.position[j] = glm::vec3(instance.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+				triangle.normal[j] = glm::normalize(normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]));
+			}
+			triangles.push_back(triangle);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	BakeLightmap(const std::vector<LightmapInstance>&, const LightmapLight*, size_t,
+//		const LightmapSettings&, ThreadPool&, Lightmap&)
+//
+//	instances: static objects; the baked ones get charts
+//	lights, lightCount: point lights of the scene
+//	settings: atlas size and sample counts
+//	pool: runs the atlas rows in parallel
+//	lightmap: receives the atlas and the baked meshes
+//
+//	Lay out the charts, trace every texel and build
+//	copies of the baked meshes with lightmap coords
+///////////////////////////////////////////////////
+bool BakeLightmap(const std::vector<LightmapInstance>& instances, const LightmapLight* lights, size_t lightCount,
+	const LightmapSettings& settings, ThreadPool& pool, Lightmap& lightmap)
+{
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> charts;		// triangles that get a cell, in cell order
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		size_t first = triangles.size();
+		UAppendTriangles(instances[i], int(i), triangles);
+		if (instances[i].baked)
+		{
+			for (size_t j = first; j < triangles.size(); ++j)
+				charts.push_back(uint32_t(j));
+		}
+	}
+
+	// square grid of cells, grown past the requested size if the cells would
+	// be too small to hold a padded chart
+	int cellsPerRow = std::max(1, int(std::ceil(std::sqrt(double(charts.size())))));
+	int size = std::max(settings.atlasSize, 1);
+	if (size / cellsPerRow < MIN_CELL_SIZE)
+		size = cellsPerRow * MIN_CELL_SIZE;
+	if (size > MAX_ATLAS_SIZE)
+	{
+		LOG_ERROR << "ERROR::LIGHTMAP::TOO_MANY_TRIANGLES " << charts.size();
+		return false;
+	}
+	const int cellSize = size / cellsPerRow;
+	const float chartSize = float(cellSize - 2 * CELL_PADDING);
+
+	Bvh bvh;
+	bvh.Build(triangles);
+	UBaker baker = { bvh, instances, lights, lightCount, settings };
+
+	lightmap.size = size;
+	lightmap.texels.assign(size_t(size) * size * 4, 0.0f);
+	for (int firstRow = 0; firstRow < size; firstRow += ROWS_PER_JOB)
+	{
+		pool.Submit([&, firstRow] {
+			int lastRow = std::min(firstRow + ROWS_PER_JOB, size);
+			for (int y = firstRow; y < lastRow; ++y)
+			{
+				int cellY = y / cellSize;
+				for (int x = 0; x < cellsPerRow * cellSize; ++x)
+				{
+					int cellX = x / cellSize;
+					size_t cell = size_t(cellY) * cellsPerRow + cellX;
+					if (cell >= charts.size())
+						break;
+					const Triangle& triangle = triangles[charts[cell]];
+
+					// position of the texel center on the chart, moved onto the
+					// triangle when it lies in the padding
+					float s = (float(x - cellX * cellSize - CELL_PADDING) + 0.5f) / chartSize;
+					float t = (float(y - cellY * cellSize - CELL_PADDING) + 0.5f) / chartSize;
+					if (s + t > 1.0f)
+					{
+						float shift = (s + t - 1.0f) * 0.5f;
+						s -= shift;
+						t -= shift;
+					}
+					s = std::min(std::max(s, 0.0f), 1.0f);
+					t = std::min(std::max(t, 0.0f), 1.0f - s);
+
+					float w = 1.0f - s - t;
+					glm::vec3 point = triangle.position[0] * w + triangle.position[1] * s + triangle.position[2] * t;
+					glm::vec3 normal = glm::normalize(triangle.normal[0] * w + triangle.normal[1] * s + triangle.normal[2] * t);
+
+					URandom random(uint32_t(y) * uint32_t(size) + uint32_t(x));
+					float visibility = 1.0f;
+					glm::vec3 light = baker.Direct(point, normal, &visibility) + baker.Indirect(point, normal, random);
+
+					float* texel = &lightmap.texels[(size_t(y) * size + x) * 4];
+					texel[0] = light.x;
+					texel[1] = light.y;
+					texel[2] = light.z;
+					texel[3] = visibility;
+				}
+			}
+		});
+	}
+	pool.Wait();
+
+	// meshes with the corners of each chart as lightmap coords
+	lightmap.meshes.assign(instances.size(), MeshData());
+	size_t cell = 0;
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		if (!instances[i].baked)
+			continue;
+
+		const MeshData& source = *instances[i].triangles;
+		MeshData& baked = lightmap.meshes[i];
+		SetStandardLayout(baked);
+		baked.attributes.push_back({ LIGHTMAP_COORD_LOCATION, 2, 8 });
+		baked.floatsPerEntry = 10;
+		baked.bounds = source.bounds;
+		baked.vertices.reserve(size_t(source.VertexCount()) * baked.floatsPerEntry);
+
+		for (uint32_t v = 0; v + 2 < source.VertexCount(); v += 3, ++cell)
+		{
+			float left = float(int(cell % cellsPerRow) * cellSize + CELL_PADDING);
+			float bottom = float(int(cell / cellsPerRow) * cellSize + CELL_PADDING);
+			const float corners[3][2] = {
+				{ left, bottom }, { left + chartSize, bottom }, { left, bottom + chartSize }
+			};
+			for (int j = 0; j < 3; ++j)
+			{
+				const float* vertex = &source.vertices[size_t(v + j) * source.floatsPerEntry];
+				baked.vertices.insert(baked.vertices.end(), vertex, vertex + 8);
+				baked.vertices.push_back(corners[j][0] / float(size));
+				baked.vertices.push_back(corners[j][1] / float(size));
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapper.h
+// ========
+// bakes the diffuse lighting of static objects into a lightmap atlas
+//
+// Every triangle gets its own right triangle chart in a grid of square
+// cells, so the lightmap coords need no unwrapping and no two triangles
+// share a texel. Texels of a cell outside its triangle take the value of
+// the nearest point on the triangle, so filtering never reads unlit texels.
+//
+// Each texel is lit by a path tracer over a BVH of every static triangle:
+// direct light from the point lights with shadow rays, plus indirect light
+// from cosine weighted hemisphere samples that bounce off the other
+// surfaces. Lighting follows the Phong terms of surface.frag (no distance
+// falloff), so baked and live lighting match. Rows of the atlas are traced
+// in parallel on a thread pool.
+//
+// No GL calls are made; the result is uploaded by the caller.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "meshdata.h"
+
+class ThreadPool;
+
+// One object to bake, or only to cast shadows and bounce light
+struct LightmapInstance
+{
+	const MeshData* triangles;	// unindexed triangle list in the standard layout
+	glm::mat4 model;
+	glm::vec3 albedo;			// average surface color, for the light it bounces
+	bool baked;					// false: an occluder only, gets no lightmap
+};
+
+struct LightmapLight
+{
+	glm::vec3 position;
+	glm::vec3 color;
+};
+
+struct LightmapSettings
+{
+	int atlasSize = 1024;		// texels on a side; grown when the cells get too small
+	int samples = 32;			// indirect rays per texel
+	int bounces = 2;			// surfaces an indirect ray bounces off
+};
+
+struct Lightmap
+{
+	int size = 0;
+	// RGBA per texel: rgb is the diffuse light arriving at the surface, the
+	// light color weighted by the cosine and shadows, plus the indirect light;
+	// a is the fraction of the direct light that is not shadowed, used to
+	// shadow specular highlights
+	std::vector<float> texels;
+	// per instance: its triangles with lightmap coords at location 7, empty
+	// for instances that are not baked
+	std::vector<MeshData> meshes;
+};
+
+// Lightmap coords attribute of the baked meshes
+const unsigned LIGHTMAP_COORD_LOCATION = 7;
+
+// Bake instances under lights; false when the atlas cannot hold the charts
+bool BakeLightmap(const std::vector<LightmapInstance>& instances, const LightmapLight* lights, size_t lightCount,
+	const LightmapSettings& settings, ThreadPool& pool, Lightmap& lightmap);
@@ -0,0 +1,661 @@
+///////////////////////////////////////////////////////////////////////////////
+// logging.cpp
+// ========
+// asynchronous logging with severity levels and pluggable sinks
+///////////////////////////////////////////////////////////////////////////////
+
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+LogLevel logdetail::gMinimumLevel = LogLevel::Info;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const size_t RECORD_SIZE = 256;
+	const size_t RING_RECORDS = 1024;		// 256 KB per logging thread
+	// the logging thread sleeps this long when every ring is empty
+	const std::chrono::milliseconds IDLE_WAIT(2);
+
+	// Fixed part of every record; the payload follows it
+	struct RecordHeader
+	{
+		int64_t ticks;			// Clock ticks since logging started
+		uint16_t payloadSize;
+		uint16_t thread;
+		uint8_t level;
+		uint8_t more;			// the message continues in the next record
+	};
+	const size_t PAYLOAD_SIZE = RECORD_SIZE - sizeof(RecordHeader);
+
+	// Type tags of the payload values
+	enum ValueTag : uint8_t
+	{
+		TagText,				// uint16 length, then the bytes
+		TagChar,
+		TagBool,
+		TagSigned,				// int64
+		TagUnsigned,			// uint64
+		TagDouble,
+	};
+
+	const char* const LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+	Clock::time_point UStartTime()
+	{
+		static const Clock::time_point start = Clock::now();
+		return start;
+	}
+
+	// Small id of the calling thread, in order of first use
+	unsigned UThreadId()
+	{
+		static std::atomic<unsigned> nextId(0);
+		thread_local unsigned id = nextId.fetch_add(1);
+		return id;
+	}
+
+	// Append the text of one value; text as ostream's default formatting
+	// would give it
+	void UFormatValue(uint8_t tag, const unsigned char* value, size_t size, std::string& out)
+	{
+		char buffer[32];
+		switch (tag)
+		{
+		case TagText:
+			out.append(reinterpret_cast<const char*>(value), size);
+			return;
+		case TagChar:
+			out.push_back(char(value[0]));
+			return;
+		case TagBool:
+			out.push_back(value[0] ? '1' : '0');
+			return;
+		case TagSigned:
+		{
+			long long number;
+			memcpy(&number, value, sizeof(number));
+			snprintf(buffer, sizeof(buffer), "%lld", number);
+			break;
+		}
+		case TagUnsigned:
+		{
+			unsigned long long number;
+			memcpy(&number, value, sizeof(number));
+			snprintf(buffer, sizeof(buffer), "%llu", number);
+			break;
+		}
+		default:
+		{
+			double number;
+			memcpy(&number, value, sizeof(number));
+			snprintf(buffer, sizeof(buffer), "%g", number);
+			break;
+		}
+		}
+		out.append(buffer);
+	}
+
+	//*************************************
+	// Sinks
+	//*************************************
+
+	// Lines as they were always printed, flushed once per batch
+	class ConsoleSink : public LogSink
+	{
+	public:
+		void Write(LogLevel, double, unsigned, const char* text, size_t length) override
+		{
+			fwrite(text, 1, length, stdout);
+			if (length == 0 || text[length - 1] != '\n')
+				fputc('\n', stdout);
+		}
+
+		void Flush() override { fflush(stdout); }
+	};
+
+	// Lines with the time since start, the thread and the level
+	class FileSink : public LogSink
+	{
+	public:
+		explicit FileSink(const char* filename) : out(filename, std::ios::binary | std::ios::trunc) {}
+
+		bool IsOpen() const { return bool(out); }
+
+		void Write(LogLevel level, double seconds, unsigned thread, const char* text, size_t length) override
+		{
+			char prefix[48];
+			snprintf(prefix, sizeof(prefix), "[%11.6f] [T%u] %-5s ", seconds, thread, LEVEL_NAMES[int(level)]);
+			out << prefix;
+			out.write(text, std::streamsize(length));
+			if (length == 0 || text[length - 1] != '\n')
+				out << '\n';
+		}
+
+		void Flush() override { out.flush(); }
+
+	private:
+		std::ofstream out;
+	};
+}
+
+//*************************************
+// Rings and the logging thread
+//*************************************
+
+// Single producer, single consumer ring of records. head and tail count
+// records from the start; the producer publishes a whole message at once.
+struct logdetail::Ring
+{
+	std::unique_ptr<unsigned char[]> records{ new unsigned char[RING_RECORDS * RECORD_SIZE] };
+	std::atomic<uint64_t> head{ 0 };		// written by the producer
+	std::atomic<uint64_t> tail{ 0 };		// written by the logging thread
+	std::atomic<uint64_t> dropped{ 0 };
+	uint64_t reportedDropped = 0;			// logging thread only
+	std::atomic<bool> owned{ true };		// a live thread writes to it
+
+	unsigned char* Record(uint64_t index) { return records.get() + (index % RING_RECORDS) * RECORD_SIZE; }
+};
+
+namespace
+{
+	using logdetail::Ring;
+
+	class Backend
+	{
+	public:
+		Backend()
+		{
+			sinks.emplace_back(new ConsoleSink());
+			worker = std::thread([this] { UWorkerLoop(); });
+		}
+
+		// Ring of a thread that logs for the first time; rings of finished
+		// threads are reused once the logging thread has emptied them
+		Ring* AcquireRing()
+		{
+			std::lock_guard<std::mutex> lock(ringsMutex);
+			for (auto& ring : rings)
+			{
+				bool expected = false;
+				if (!ring->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+					continue;
+				// claimed first, so head is final; messages still queued keep
+				// the ring until the logging thread has written them
+				if (ring->tail.load(std::memory_order_acquire) == ring->head.load(std::memory_order_relaxed))
+					return ring.get();
+				ring->owned.store(false, std::memory_order_release);
+			}
+			rings.emplace_back(new Ring());
+			return rings.back().get();
+		}
+
+		void AddSink(std::unique_ptr<LogSink> sink)
+		{
+			std::lock_guard<std::mutex> lock(sinksMutex);
+			sinks.push_back(std::move(sink));
+		}
+
+		// Hand one line to every sink
+		void WriteLine(LogLevel level, int64_t ticks, unsigned thread, const std::string& text)
+		{
+			double seconds = std::chrono::duration<double>(Clock::duration(ticks)).count();
+			std::lock_guard<std::mutex> lock(sinksMutex);
+			for (auto& sink : sinks)
+				sink->Write(level, seconds, thread, text.data(), text.size());
+			++messages;
+		}
+
+		void FlushSinks()
+		{
+			std::lock_guard<std::mutex> lock(sinksMutex);
+			for (auto& sink : sinks)
+				sink->Flush();
+		}
+
+		void Flush()
+		{
+			std::unique_lock<std::mutex> lock(flushMutex);
+			if (!running)
+				return;
+			uint64_t wanted = ++flushRequested;
+			wake.notify_one();
+			flushDone.wait(lock, [&] { return flushCompleted >= wanted || !running; });
+		}
+
+		void Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(flushMutex);
+				if (!running || stopping)
+					return;
+				stopping = true;
+			}
+			wake.notify_one();
+			worker.join();
+		}
+
+		LogStats GetStats()
+		{
+			LogStats stats;
+			{
+				std::lock_guard<std::mutex> lock(sinksMutex);
+				stats.messages = messages;
+			}
+			std::lock_guard<std::mutex> lock(ringsMutex);
+			for (auto& ring : rings)
+				stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+		bool IsRunning()
+		{
+			std::lock_guard<std::mutex> lock(flushMutex);
+			return running;
+		}
+
+	private:
+		// A complete message waiting in a ring
+		struct Pending
+		{
+			int64_t ticks;
+			Ring* ring;
+			uint64_t first;
+			uint64_t count;
+		};
+
+		std::vector<std::unique_ptr<Ring>> rings;
+		std::mutex ringsMutex;
+		std::vector<std::unique_ptr<LogSink>> sinks;
+		std::mutex sinksMutex;
+		uint64_t messages = 0;
+
+		std::thread worker;
+		std::mutex flushMutex;
+		std::condition_variable flushDone;
+		std::condition_variable wake;			// flush or stop requested
+		uint64_t flushRequested = 0;
+		uint64_t flushCompleted = 0;
+		bool stopping = false;
+		bool running = true;
+
+		void UWorkerLoop()
+		{
+			std::vector<Pending> pending;
+			std::string text;
+			for (;;)
+			{
+				uint64_t flushTarget;
+				bool stop;
+				{
+					std::lock_guard<std::mutex> lock(flushMutex);
+					flushTarget = flushRequested;
+					stop = stopping;
+				}
+
+				// the pass sees every message published before the flush or
+				// stop request was read
+				bool wrote = UDrain(pending, text);
+
+				std::unique_lock<std::mutex> lock(flushMutex);
+				flushCompleted = flushTarget;
+				if (stop)
+					running = false;
+				flushDone.notify_all();
+				if (stop)
+					return;
+				if (!wrote)
+					wake.wait_for(lock, IDLE_WAIT, [&] { return flushRequested != flushTarget || stopping; });
+			}
+		}
+
+		// Write every complete message of every ring, oldest first; false
+		// when there was none
+		bool UDrain(std::vector<Pending>& pending, std::string& text)
+		{
+			pending.clear();
+			uint64_t newlyDropped = 0;
+			{
+				std::lock_guard<std::mutex> lock(ringsMutex);
+				for (auto& ring : rings)
+				{
+					uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+					newlyDropped += dropped - ring->reportedDropped;
+					ring->reportedDropped = dropped;
+
+					uint64_t head = ring->head.load(std::memory_order_acquire);
+					for (uint64_t index = ring->tail.load(std::memory_order_relaxed); index < head; )
+					{
+						Pending message = { 0, ring.get(), index, 0 };
+						RecordHeader header;
+						do
+						{
+							memcpy(&header, ring->Record(index + message.count), sizeof(header));
+							if (message.count == 0)
+								message.ticks = header.ticks;
+							++message.count;
+						} while (header.more);
+						pending.push_back(message);
+						index += message.count;
+					}
+				}
+			}
+			if (pending.empty() && newlyDropped == 0)
+				return false;
+
+			std::stable_sort(pending.begin(), pending.end(),
+				[](const Pending& a, const Pending& b) { return a.ticks < b.ticks; });
+
+			for (const Pending& message : pending)
+			{
+				text.clear();
+				RecordHeader header;
+				for (uint64_t i = 0; i < message.count; ++i)
+				{
+					const unsigned char* record = message.ring->Record(message.first + i);
+					memcpy(&header, record, sizeof(header));
+					UDecodePayload(record + sizeof(RecordHeader), header.payloadSize, text);
+				}
+				WriteLine(LogLevel(header.level), message.ticks, header.thread, text);
+				message.ring->tail.store(message.first + message.count, std::memory_order_release);
+			}
+
+			if (newlyDropped > 0)
+			{
+				text = "WARNING::LOG::DROPPED " + std::to_string(newlyDropped) + " messages, a thread logged faster than they were written";
+				WriteLine(LogLevel::Warning, (Clock::now() - UStartTime()).count(), UThreadId(), text);
+			}
+			FlushSinks();
+			return true;
+		}
+
+		void UDecodePayload(const unsigned char* payload, size_t size, std::string& out)
+		{
+			for (size_t offset = 0; offset < size; )
+			{
+				uint8_t tag = payload[offset++];
+				size_t valueSize;
+				switch (tag)
+				{
+				case TagText:
+				{
+					uint16_t length;
+					memcpy(&length, payload + offset, sizeof(length));
+					offset += sizeof(length);
+					valueSize = length;
+					break;
+				}
+				case TagChar:
+				case TagBool:
+					valueSize = 1;
+					break;
+				default:
+					valueSize = 8;
+					break;
+				}
+				UFormatValue(tag, payload + offset, valueSize, out);
+				offset += valueSize;
+			}
+		}
+	};
+
+	std::atomic<bool> gSynchronous(false);
+
+	// Created on first use and never destroyed, so messages logged from
+	// static destructors still find it; StopLog runs at exit
+	Backend& UBackend()
+	{
+		static Backend* backend = [] {
+			UStartTime();
+			Backend* created = new Backend();
+			atexit(StopLog);
+			return created;
+		}();
+		return *backend;
+	}
+
+	// Releases the calling thread's ring when the thread ends
+	struct RingOwner
+	{
+		Ring* ring = nullptr;
+		~RingOwner()
+		{
+			if (ring)
+				ring->owned.store(false, std::memory_order_release);
+		}
+	};
+	thread_local RingOwner tRingOwner;
+}
+
+//*************************************
+// Public functions
+//*************************************
+
+void SetLogLevel(LogLevel level)
+{
+	logdetail::gMinimumLevel = level;
+}
+
+bool ParseLogLevel(const char* name, LogLevel& level)
+{
+	const char* const NAMES[] = { "debug", "info", "warning", "error" };
+	for (int i = 0; i < 4; ++i)
+	{
+		if (strcmp(name, NAMES[i]) == 0)
+		{
+			level = LogLevel(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void AddLogSink(std::unique_ptr<LogSink> sink)
+{
+	UBackend().AddSink(std::move(sink));
+}
+
+bool AddLogFile(const char* filename)
+{
+	std::unique_ptr<FileSink> sink(new FileSink(filename));
+	if (!sink->IsOpen())
+	{
+		LOG_ERROR << "ERROR::LOG::CANNOT_CREATE " << filename;
+		return false;
+	}
+	AddLogSink(std::move(sink));
+	return true;
+}
+
+void SetLogSynchronous(bool synchronous)
+{
+	FlushLog();
+	gSynchronous = synchronous;
+}
+
+void FlushLog()
+{
+	UBackend().Flush();
+}
+
+void StopLog()
+{
+	gSynchronous = true;
+	UBackend().Stop();
+}
+
+LogStats GetLogStats()
+{
+	return UBackend().GetStats();
+}
+
+//*************************************
+// Message encoding
+//*************************************
+
+logdetail::MessageWriter::MessageWriter(LogLevel level)
+	: level(level), ring(nullptr), record(nullptr), used(0), records(0), dropped(false)
+{
+	Backend& backend = UBackend();
+	if (gSynchronous.load(std::memory_order_relaxed))
+		return;
+	if (!tRingOwner.ring)
+		tRingOwner.ring = backend.AcquireRing();
+	ring = tRingOwner.ring;
+	UOpenRecord();
+}
+
+logdetail::MessageWriter::~MessageWriter()
+{
+	if (!ring)
+	{
+		// synchronous: straight to the sinks, flushed with the line
+		Backend& backend = UBackend();
+		backend.WriteLine(level, (Clock::now() - UStartTime()).count(), UThreadId(), text);
+		backend.FlushSinks();
+		return;
+	}
+	if (dropped)
+	{
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	UCommitRecord(true);
+}
+
+logdetail::MessageWriter& logdetail::MessageWriter::operator<<(const char* text)
+{
+	return UPutText(text, text ? strlen(text) : 0);
+}
+
+logdetail::MessageWriter& logdetail::MessageWriter::operator<<(char value)
+{
+	UPut(TagChar, &value, 1);
+	return *this;
+}
+
+logdetail::MessageWriter& logdetail::MessageWriter::operator<<(bool value)
+{
+	unsigned char byte = value ? 1 : 0;
+	UPut(TagBool, &byte, 1);
+	return *this;
+}
+
+// Text is split over as many records as it needs
+logdetail::MessageWriter& logdetail::MessageWriter::UPutText(const char* text, size_t length)
+{
+	if (!ring)
+	{
+		this->text.append(text, length);
+		return *this;
+	}
+	while (length > 0 && !dropped)
+	{
+		// a tag and a length must fit with at least one byte
+		const size_t overhead = 1 + sizeof(uint16_t);
+		if (PAYLOAD_SIZE - used <= overhead)
+		{
+			UCommitRecord(false);
+			UOpenRecord();
+			continue;
+		}
+		uint16_t chunk = uint16_t(std::min(length, PAYLOAD_SIZE - used - overhead));
+		unsigned char* payload = record + sizeof(RecordHeader) + used;
+		payload[0] = TagText;
+		memcpy(payload + 1, &chunk, sizeof(chunk));
+		memcpy(payload + overhead, text, chunk);
+		used += overhead + chunk;
+		text += chunk;
+		length -= chunk;
+	}
+	return *this;
+}
+
+logdetail::MessageWriter& logdetail::MessageWriter::UPutSigned(long long value)
+{
+	int64_t number = value;
+	UPut(TagSigned, &number, sizeof(number));
+	return *this;
+}
+
+logdetail::MessageWriter& logdetail::MessageWriter::UPutUnsigned(unsigned long long value)
+{
+	uint64_t number = value;
+	UPut(TagUnsigned, &number, sizeof(number));
+	return *this;
+}
+
+logdetail::MessageWriter& logdetail::MessageWriter::UPutDouble(double value)
+{
+	UPut(TagDouble, &value, sizeof(value));
+	return *this;
+}
+
+// Append a tagged value, starting a new record when it does not fit
+void logdetail::MessageWriter::UPut(uint8_t tag, const void* value, size_t size)
+{
+	if (!ring)
+	{
+		UFormatValue(tag, static_cast<const unsigned char*>(value), size, text);
+		return;
+	}
+	if (dropped)
+		return;
+	if (PAYLOAD_SIZE - used < 1 + size)
+	{
+		UCommitRecord(false);
+		UOpenRecord();
+		if (dropped)
+			return;
+	}
+	unsigned char* payload = record + sizeof(RecordHeader) + used;
+	payload[0] = tag;
+	memcpy(payload + 1, value, size);
+	used += 1 + size;
+}
+
+// Claim the next record of the message; the whole message is dropped when
+// the ring has no room for it
+void logdetail::MessageWriter::UOpenRecord()
+{
+	// the earlier records of the message are written but not yet published
+	uint64_t index = ring->head.load(std::memory_order_relaxed) + records;
+	if (index - ring->tail.load(std::memory_order_acquire) >= RING_RECORDS)
+	{
+		dropped = true;
+		record = nullptr;
+		return;
+	}
+	record = ring->Record(index);
+	used = 0;
+}
+
+// Finish the current record; the last one publishes the whole message
+void logdetail::MessageWriter::UCommitRecord(bool last)
+{
+	RecordHeader header;
+	header.ticks = (Clock::now() - UStartTime()).count();
+	header.payloadSize = uint16_t(used);
+	header.thread = uint16_t(UThreadId());
+	header.level = uint8_t(level);
+	header.more = last ? 0 : 1;
+	memcpy(record, &header, sizeof(header));
+	++records;
+	if (last)
+	{
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		ring->head.store(head + records, std::memory_order_release);
+	}
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// logging.h
+// ========
+// asynchronous logging with severity levels and pluggable sinks
+//
+//   LOG_INFO << "INFO: Reloaded " << path << " in " << milliseconds << " ms";
+//   LOG_ERROR << "ERROR::SCENE::CANNOT_OPEN " << filename;
+//
+// A message is encoded on the calling thread as a fixed-size binary record:
+// a timestamp and level, then each argument as a type tag and its raw value
+// (strings are copied, numbers are not formatted). Records go into a ring
+// owned by the calling thread, which only that thread writes and only the
+// logging thread reads, so writing takes no lock and never waits. The
+// logging thread turns records into text and hands every line to the sinks.
+// Text longer than one record continues in the next ones.
+//
+// When a thread's ring is full its messages are dropped and counted rather
+// than blocking the thread. A disabled level costs one comparison: the
+// arguments of a filtered out message are not even evaluated.
+//
+// Messages keep their text as written, so the console shows what it always
+// did; the file sink adds the time since start and the thread.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+enum class LogLevel : uint8_t
+{
+	Debug,
+	Info,
+	Warning,
+	Error,
+};
+
+// Receives formatted lines on the logging thread
+class LogSink
+{
+public:
+	virtual ~LogSink() {}
+
+	// seconds: time since logging started; thread: small id of the producer
+	virtual void Write(LogLevel level, double seconds, unsigned thread, const char* text, size_t length) = 0;
+
+	// Called after every batch of lines
+	virtual void Flush() {}
+};
+
+struct LogStats
+{
+	uint64_t messages = 0;		// written to the sinks
+	uint64_t dropped = 0;		// lost to a full ring
+};
+
+// Messages below level are discarded where they are logged; Info by default
+void SetLogLevel(LogLevel level);
+bool ParseLogLevel(const char* name, LogLevel& level);
+
+// The console sink is installed at start; AddLogFile adds a file sink
+void AddLogSink(std::unique_ptr<LogSink> sink);
+bool AddLogFile(const char* filename);
+
+// Format and write messages on the calling thread instead, in order with
+// other output; for command line tools
+void SetLogSynchronous(bool synchronous);
+
+// Block until every message logged so far is written
+void FlushLog();
+
+// Write what is left and stop the logging thread; later messages are
+// written synchronously
+void StopLog();
+
+LogStats GetLogStats();
+
+namespace logdetail
+{
+	extern LogLevel gMinimumLevel;
+
+	struct Ring;
+
+	// Builds one message in the calling thread's ring
+	class MessageWriter
+	{
+	public:
+		explicit MessageWriter(LogLevel level);
+		~MessageWriter();
+		MessageWriter(const MessageWriter&) = delete;
+		MessageWriter& operator=(const MessageWriter&) = delete;
+
+		MessageWriter& operator<<(const char* text);
+		MessageWriter& operator<<(const unsigned char* text) { return *this << reinterpret_cast<const char*>(text); }
+		MessageWriter& operator<<(const std::string& text) { return UPutText(text.data(), text.size()); }
+		MessageWriter& operator<<(char value);
+		MessageWriter& operator<<(bool value);
+		MessageWriter& operator<<(int value) { return UPutSigned(value); }
+		MessageWriter& operator<<(long value) { return UPutSigned(value); }
+		MessageWriter& operator<<(long long value) { return UPutSigned(value); }
+		MessageWriter& operator<<(unsigned value) { return UPutUnsigned(value); }
+		MessageWriter& operator<<(unsigned long value) { return UPutUnsigned(value); }
+		MessageWriter& operator<<(unsigned long long value) { return UPutUnsigned(value); }
+		MessageWriter& operator<<(float value) { return UPutDouble(value); }
+		MessageWriter& operator<<(double value) { return UPutDouble(value); }
+
+	private:
+		LogLevel level;
+		Ring* ring;
+		unsigned char* record;		// record being filled, null when the ring was full
+		size_t used;				// payload bytes of record
+		size_t records;				// records of the message before record
+		bool dropped;
+		std::string text;			// synchronous mode: the formatted message
+
+		MessageWriter& UPutText(const char* text, size_t length);
+		MessageWriter& UPutSigned(long long value);
+		MessageWriter& UPutUnsigned(unsigned long long value);
+		MessageWriter& UPutDouble(double value);
+		void UPut(uint8_t tag, const void* value, size_t size);
+		void UOpenRecord();
+		void UCommitRecord(bool last);
+	};
+
+	// Lets the whole << chain be the operand of ?:; & binds looser than <<
+	struct Discard
+	{
+		void operator&(const MessageWriter&) {}
+	};
+}
+
+// The stream operands are only evaluated when the level is enabled; an
+// expression rather than an if, so it nests safely in an unbraced if/else
+#define LOG_AT(level) (level < logdetail::gMinimumLevel) ? (void)0 : logdetail::Discard() & logdetail::MessageWriter(level)
+#define LOG_DEBUG LOG_AT(LogLevel::Debug)
+#define LOG_INFO LOG_AT(LogLevel::Info)
+#define LOG_WARNING LOG_AT(LogLevel::Warning)
+#define LOG_ERROR LOG_AT(LogLevel::Error)
@@ -0,0 +1,474 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshdata.cpp
+// ========
+// CPU side vertex data of the built-in primitives
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 7th, 2022
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshdata.h"
+#include "allocators.h"
+#include "primitives.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+	// built at compile time; see primitives.h
+	constexpr auto CUBE = primitives::MakeCube();
+	constexpr auto CYLINDER = primitives::MakeCylinder<CYLINDER_SEGMENTS>(1.0, 1.0);
+	constexpr auto TAPERED_CYLINDER = primitives::MakeCylinder<CYLINDER_SEGMENTS>(1.0, 0.5);
+	constexpr auto SPHERE = primitives::MakeSphere<SPHERE_RINGS, SPHERE_SEGMENTS>();
+
+	const uint32_t NO_VERTEX = ~uint32_t(0);
+
+	bool UWithin(const float* a, const float* b, uint32_t count, float epsilon)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (std::fabs(a[i] - b[i]) > epsilon)
+				return false;
+		}
+		return true;
+	}
+}
+
+void SetStandardLayout(MeshData& mesh)
+{
+	mesh.floatsPerEntry = 8;
+	mesh.attributes = { { 0, 3, 0 }, { 1, 3, 3 }, { 2, 2, 6 } };
+}
+
+void SetPositionLayout(MeshData& mesh)
+{
+	mesh.floatsPerEntry = 3;
+	mesh.attributes = { { 0, 3, 0 } };
+}
+
+Bounds ComputeBounds(const MeshData& mesh)
+{
+	Bounds bounds;
+	if (mesh.floatsPerEntry < 3)
+		return bounds;
+	for (size_t i = 0; i + 2 < mesh.vertices.size(); i += mesh.floatsPerEntry)
+		bounds.Expand(glm::vec3(mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]));
+	return bounds;
+}
+
+///////////////////////////////////////////////////
+//	IndexTriangleStrip(MeshData&, uint32_t, uint32_t)
+//
+//	mesh: vertex data holding the strip
+//	first: first vertex of the strip
+//	count: vertices in the strip
+///////////////////////////////////////////////////
+void IndexTriangleStrip(MeshData& mesh, uint32_t first, uint32_t count)
+{
+	mesh.indices.clear();
+	mesh.indices.reserve(count > 2 ? size_t(count - 2) * 3 : 0);
+	for (uint32_t i = 0; i + 2 < count; ++i)
+	{
+		uint32_t a = first + i;
+		uint32_t b = (i & 1) ? a + 2 : a + 1;
+		uint32_t c = (i & 1) ? a + 1 : a + 2;
+		if (a == b || b == c || a == c)
+			continue;
+		mesh.indices.push_back(a);
+		mesh.indices.push_back(b);
+		mesh.indices.push_back(c);
+	}
+}
+
+///////////////////////////////////////////////////
+//	WeldVertices(MeshData&, float)
+//
+//	mesh: vertex data, rewritten in place
+//	epsilon: largest difference of a merged attribute
+//
+//	Vertices are sorted by x, so the candidates for a
+//	merge are the few just before each one. A vertex
+//	only merges into one that was kept, which keeps
+//	chains of near values from drifting further than
+//	epsilon
+///////////////////////////////////////////////////
+void WeldVertices(MeshData& mesh, float epsilon)
+{
+	const uint32_t stride = mesh.floatsPerEntry;
+	const uint32_t vertexCount = mesh.VertexCount();
+	if (vertexCount == 0)
+		return;
+
+	std::vector<uint32_t> triangles = mesh.indices;
+	if (triangles.empty())
+	{
+		triangles.resize(vertexCount - vertexCount % 3);
+		std::iota(triangles.begin(), triangles.end(), 0u);
+	}
+
+	const float* vertices = mesh.vertices.data();
+	std::vector<uint32_t> sorted(vertexCount);
+	std::iota(sorted.begin(), sorted.end(), 0u);
+	std::stable_sort(sorted.begin(), sorted.end(),
+		[&](uint32_t a, uint32_t b) { return vertices[size_t(a) * stride] < vertices[size_t(b) * stride]; });
+
+	// the vertex each one merges into, itself when it is kept
+	std::vector<uint32_t> kept(vertexCount);
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		uint32_t vertex = sorted[i];
+		const float* data = vertices + size_t(vertex) * stride;
+		kept[vertex] = vertex;
+		for (size_t j = i; j-- > 0;)
+		{
+			uint32_t other = sorted[j];
+			const float* otherData = vertices + size_t(other) * stride;
+			if (data[0] - otherData[0] > epsilon)
+				break;
+			if (kept[other] == other && UWithin(data, otherData, stride, epsilon))
+			{
+				kept[vertex] = other;
+				break;
+			}
+		}
+	}
+
+	// renumber the kept vertices as the triangles reach them
+	std::vector<uint32_t> remap(vertexCount, NO_VERTEX);
+	std::vector<float> welded;
+	std::vector<uint32_t> indices;
+	welded.reserve(mesh.vertices.size());
+	indices.reserve(triangles.size());
+	for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+	{
+		uint32_t corners[3];
+		for (int j = 0; j < 3; ++j)
+			corners[j] = kept[triangles[i + j]];
+		if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2])
+			continue;
+
+		for (uint32_t corner : corners)
+		{
+			if (remap[corner] == NO_VERTEX)
+			{
+				remap[corner] = uint32_t(welded.size() / stride);
+				welded.insert(welded.end(), vertices + size_t(corner) * stride, vertices + size_t(corner + 1) * stride);
+			}
+			indices.push_back(remap[corner]);
+		}
+	}
+
+	mesh.vertices = std::move(welded);
+	mesh.indices = std::move(indices);
+}
+
+///////////////////////////////////////////////////
+//	GeneratePlaneMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a plane mesh
+///////////////////////////////////////////////////
+void GeneratePlaneMesh(MeshData& mesh)
+{
+	// Vertex data
+	static const float verts[] = {
+		// Vertex Positions		// Normals			// Texture coords	// Index
+		-1.0f, 0.0f, 1.0f,		0.0f, 1.0f, 0.0f,	0.0f, 1.0f,			//0
+		1.0f, 0.0f, 1.0f,		0.0f, 1.0f, 0.0f,	0.0f, 0.0f,			//1
+		1.0f,  0.0f, -1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 0.0f,			//2
+		-1.0f, 0.0f, -1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 1.0f,			//3
+	};
+
+	// Index data
+	static const uint32_t indices[] = {
+		0,1,2,
+		0,3,2
+	};
+
+	mesh.vertices.assign(verts, verts + sizeof(verts) / sizeof(verts[0]));
+	mesh.indices.assign(indices, indices + sizeof(indices) / sizeof(indices[0]));
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GeneratePyramidMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a pyramid mesh
+///////////////////////////////////////////////////
+void GeneratePyramidMesh(MeshData& mesh)
+{
+	// Vertex data
+	static const float verts[] = {
+		// Vertex Positions		// Normals			// Texture coords	// Index
+		0.0f, 0.5f, 0.0f,		0.0f, 0.0f, 0.0f,	0.5f, 1.0f,			//0
+		-0.5f, -0.5f, -0.5f,	0.0f, 0.0f, 0.0f,	0.0f, 0.0f,			//1
+		0.5f, -0.5f, -0.5f,		0.0f, 0.0f, 0.0f,	1.0f, 0.0f,			//2
+		0.5f,  -0.5f, 0.5f,		0.0f, 0.0f, 0.0f,	1.0f, 1.0f,			//3
+		-0.5f,  -0.5f, 0.5f,	0.0f, 0.0f, 0.0f,	0.0f, 1.0f			//4
+	};
+
+	// Index data
+	static const uint32_t indices[] = {
+		0,1,2,
+		0,2,3,
+		0,3,4,
+		0,4,1
+	};
+
+	mesh.vertices.assign(verts, verts + sizeof(verts) / sizeof(verts[0]));
+	mesh.indices.assign(indices, indices + sizeof(indices) / sizeof(indices[0]));
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GeneratePrismMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a prism mesh
+///////////////////////////////////////////////////
+void GeneratePrismMesh(MeshData& mesh)
+{
+	// Vertex data
+	static const float verts[] = {
+		//Positions				//Normals
+		// ------------------------------------------------------
+		//Top Face				//Positive Y Normal
+		-0.5f,  0.5f, -0.5f,	0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+		0.5f,  0.5f, -0.5f,		0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+		0.0f,  0.5f,  0.5f,		0.0f,  1.0f,  0.0f,  0.5f, 0.0f,
+		-0.5f,  0.5f, -0.5f,	0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+
+		//Right Face			//Positive X Normal
+		0.0f, 0.5f, 0.5f,		1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+		0.5f, 0.5f, -0.5f,		1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+		0.5f, -0.5f, -0.5f,		1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+		0.0f, 0.5f, 0.5f,		1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+		0.0f, -0.5f, 0.5f,		1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+		0.5f, -0.5f, -0.5f,		1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+		0.5f, 0.5f, -0.5f,		1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+
+		//Back Face				//Negative Z Normal  Texture Coords.
+		-0.5f, -0.5f, -0.5f,	0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+		0.5f, -0.5f, -0.5f,		0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+		0.5f,  0.5f, -0.5f,		0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+		0.5f,  0.5f, -0.5f,		0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+		-0.5f,  0.5f, -0.5f,	0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,	0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+		//Left Face				//Negative X Normal
+		-0.5f, -0.5f, -0.5f,	-1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+		-0.5f, 0.5f,  -0.5f,	-1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+		0.0f, 0.5f,  0.5f,		-1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,	-1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+		0.0f, -0.5f,  0.5f,		-1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+		0.0f, 0.5f,  0.5f,		-1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,	-1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+
+		//Bottom Face			//Negative Y Normal
+		0.5f, -0.5f, -0.5f,	0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,		0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+		0.0f, -0.5f,  0.5f,		0.0f, -1.0f,  0.0f,  0.5f, 1.0f,
+		-0.5f, -0.5f,  -0.5f,	0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+	};
+
+	mesh.vertices.assign(verts, verts + sizeof(verts) / sizeof(verts[0]));
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GenerateCubeMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a cube mesh
+///////////////////////////////////////////////////
+void GenerateCubeMesh(MeshData& mesh)
+{
+	mesh.vertices.assign(CUBE.vertices.begin(), CUBE.vertices.end());
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GenerateCylinderMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a cylinder mesh
+///////////////////////////////////////////////////
+void GenerateCylinderMesh(MeshData& mesh)
+{
+	mesh.vertices.assign(CYLINDER.vertices.begin(), CYLINDER.vertices.end());
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GenerateTaperedCylinderMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a tapered cylinder mesh
+///////////////////////////////////////////////////
+void GenerateTaperedCylinderMesh(MeshData& mesh)
+{
+	mesh.vertices.assign(TAPERED_CYLINDER.vertices.begin(), TAPERED_CYLINDER.vertices.end());
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GenerateTorusMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of the scene's torus mesh
+///////////////////////////////////////////////////
+void GenerateTorusMesh(MeshData& mesh)
+{
+	GenerateTorusMesh(mesh, 30, 30);
+}
+
+///////////////////////////////////////////////////
+//	GenerateTorusMesh(MeshData&, int, int)
+//
+//	mesh: receives the vertex data
+//	mainSegments: segments around the main ring
+//	tubeSegments: segments around the tube
+//
+//	Create the vertex data of a torus mesh
+///////////////////////////////////////////////////
+void GenerateTorusMesh(MeshData& mesh, int mainSegments, int tubeSegments)
+{
+	int _mainSegments = mainSegments;
+	int _tubeSegments = tubeSegments;
+	float _mainRadius = 1.0f;
+	float _tubeRadius = .1f;
+
+	auto mainSegmentAngleStep = glm::radians(360.0f / float(_mainSegments));
+	auto tubeSegmentAngleStep = glm::radians(360.0f / float(_tubeSegments));
+
+	// the points of every ring, ring after ring, live in the scratch arena
+	ArenaScope scratch(ScratchArena());
+	glm::vec3* ringPoints = ScratchArena().AllocateArray<glm::vec3>(size_t(_mainSegments) * _tubeSegments);
+	auto point = [&](int ring, int segment) -> const glm::vec3& { return ringPoints[ring * _tubeSegments + segment]; };
+
+	// 7 vertices for each quad of the strip
+	mesh.vertices.clear();
+	mesh.vertices.reserve(size_t(_mainSegments) * _tubeSegments * 7 * 3);
+	auto addVertex = [&](const glm::vec3& position)
+	{
+		mesh.vertices.push_back(position.x);
+		mesh.vertices.push_back(position.y);
+		mesh.vertices.push_back(position.z);
+	};
+
+	// generate the torus vertices
+	auto currentMainSegmentAngle = 0.0f;
+	for (auto i = 0; i < _mainSegments; i++)
+	{
+		// Calculate sine and cosine of main segment angle
+		auto sinMainSegment = sin(currentMainSegmentAngle);
+		auto cosMainSegment = cos(currentMainSegmentAngle);
+		auto currentTubeSegmentAngle = 0.0f;
+		for (auto j = 0; j < _tubeSegments; j++)
+		{
+			// Calculate sine and cosine of tube segment angle
+			auto sinTubeSegment = sin(currentTubeSegmentAngle);
+			auto cosTubeSegment = cos(currentTubeSegmentAngle);
+
+			// Calculate vertex position on the surface of torus
+			auto surfacePosition = glm::vec3(
+				(_mainRadius + _tubeRadius * cosTubeSegment) * cosMainSegment,
+				(_mainRadius + _tubeRadius * cosTubeSegment) * sinMainSegment,
+				_tubeRadius * sinTubeSegment);
+
+			ringPoints[i * _tubeSegments + j] = surfacePosition;
+
+			// Update current tube angle
+			currentTubeSegmentAngle += tubeSegmentAngleStep;
+		}
+		// Update main segment angle
+		currentMainSegmentAngle += mainSegmentAngleStep;
+	}
+
+	// connect the various segments together, forming triangles
+	for (int i = 0; i < _mainSegments; i++)
+	{
+		for (int j = 0; j < _tubeSegments; j++)
+		{
+			if (((i + 1) < _mainSegments) && ((j + 1) < _tubeSegments))
+			{
+				addVertex(point(i, j));
+				addVertex(point(i, j + 1));
+				addVertex(point(i + 1, j + 1));
+				addVertex(point(i, j));
+				addVertex(point(i + 1, j));
+				addVertex(point(i + 1, j + 1));
+				addVertex(point(i, j));
+			}
+			else
+			{
+				if (((i + 1) == _mainSegments) && ((j + 1) == _tubeSegments))
+				{
+					addVertex(point(i, j));
+					addVertex(point(i, 0));
+					addVertex(point(0, 0));
+					addVertex(point(i, j));
+					addVertex(point(0, j));
+					addVertex(point(0, 0));
+					addVertex(point(i, j));
+				}
+				else if ((i + 1) == _mainSegments)
+				{
+					addVertex(point(i, j));
+					addVertex(point(i, j + 1));
+					addVertex(point(0, j + 1));
+					addVertex(point(i, j));
+					addVertex(point(0, j));
+					addVertex(point(0, j + 1));
+					addVertex(point(i, j));
+				}
+				else if ((j + 1) == _tubeSegments)
+				{
+					addVertex(point(i, j));
+					addVertex(point(i, 0));
+					addVertex(point(i + 1, 0));
+					addVertex(point(i, j));
+					addVertex(point(i + 1, j));
+					addVertex(point(i + 1, 0));
+					addVertex(point(i, j));
+				}
+			}
+		}
+	}
+
+	SetPositionLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
+
+///////////////////////////////////////////////////
+//	GenerateSphereMesh(MeshData&)
+//
+//	mesh: receives the vertex data
+//
+//	Create the vertex data of a sphere mesh
+///////////////////////////////////////////////////
+void GenerateSphereMesh(MeshData& mesh)
+{
+	mesh.vertices.assign(SPHERE.vertices.begin(), SPHERE.vertices.end());
+	mesh.indices.assign(SPHERE.indices.begin(), SPHERE.indices.end());
+	SetStandardLayout(mesh);
+	mesh.bounds = ComputeBounds(mesh);
+}
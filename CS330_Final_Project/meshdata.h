@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshdata.h
+// ========
+// CPU side vertex data of the built-in primitives
+//
+// The generators only fill arrays and make no GL calls, so they can run on
+// any thread, in parallel with each other, and in tools and benchmarks that
+// have no GL context. Meshes uploads the results.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+
+// One float vertex attribute inside an interleaved vertex
+struct MeshAttribute
+{
+	uint32_t location;			// shader attribute location
+	uint32_t componentCount;
+	uint32_t offset;			// in floats from the start of the vertex
+};
+
+// Vertex data of one mesh, ready to be uploaded
+struct MeshData
+{
+	std::vector<float> vertices;			// interleaved attributes
+	std::vector<uint32_t> indices;			// triangle list; empty when drawn as arrays
+	std::vector<MeshAttribute> attributes;
+	uint32_t floatsPerEntry = 0;			// floats per vertex
+	Bounds bounds;							// object space bounds of the positions
+
+	uint32_t VertexCount() const { return floatsPerEntry ? uint32_t(vertices.size() / floatsPerEntry) : 0; }
+};
+
+// Position 3, normal 3, uv 2 at locations 0, 1, 2: the layout of most
+// built-in meshes and of imported models
+void SetStandardLayout(MeshData& mesh);
+
+// Position only, at location 0
+void SetPositionLayout(MeshData& mesh);
+
+// Bounds of the positions at the start of each vertex
+Bounds ComputeBounds(const MeshData& mesh);
+
+// Mesh conditioning, so that every mesh can be drawn as an indexed list and
+// the post-transform cache reuses the vertices triangles share.
+// Index vertices [first, first + count) as the triangle strip they are
+// drawn as; every other triangle swaps two corners to keep its winding,
+// and degenerate triangles are dropped
+void IndexTriangleStrip(MeshData& mesh, uint32_t first, uint32_t count);
+
+// Merge vertices whose attributes all lie within epsilon of each other and
+// index the merged ones, in the order the triangles first use them; data
+// without indices is read as a triangle list. Unused vertices are dropped,
+// as are triangles left with a repeated corner.
+void WeldVertices(MeshData& mesh, float epsilon);
+
+// Density of the built-in primitives whose tables are generated at compile
+// time (primitives.h); changing one regenerates the mesh
+const int CYLINDER_SEGMENTS = 36;
+const int SPHERE_RINGS = 15;			// rings between the poles
+const int SPHERE_SEGMENTS = 16;
+
+void GeneratePlaneMesh(MeshData& mesh);
+void GeneratePrismMesh(MeshData& mesh);
+void GenerateCubeMesh(MeshData& mesh);
+void GenerateCylinderMesh(MeshData& mesh);
+void GenerateTaperedCylinderMesh(MeshData& mesh);
+void GeneratePyramidMesh(MeshData& mesh);
+void GenerateSphereMesh(MeshData& mesh);
+void GenerateTorusMesh(MeshData& mesh);
+void GenerateTorusMesh(MeshData& mesh, int mainSegments, int tubeSegments);
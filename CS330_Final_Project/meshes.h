@@ -11,18 +11,44 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "gpuresources.h"
+#include "meshdata.h"
+
 class Meshes
 {
-	// Stores the GL data relative to a given mesh
+public:
+	// Stores the GL data relative to a given mesh; owns its GL objects
 	struct GLMesh
 	{
-		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
-		GLuint nVertices;	// Number of vertices for the mesh
-		GLuint nIndices;    // Number of indices for the mesh
+		GpuVertexArray vao;         // Handle for the vertex array object
+		GpuBuffer vertexBuffer;     // Interleaved vertex data
+		GpuBuffer indexBuffer;      // Indices; empty for meshes drawn as arrays
+		GLuint nVertices = 0;       // Number of vertices for the mesh
+		GLuint nIndices = 0;        // Number of indices for the mesh
+		GLenum mode = GL_TRIANGLES; // Primitive type of the draw
+		GLuint firstVertex = 0;     // First vertex drawn as arrays: generated cylinders skip their caps
+		Bounds bounds;              // Object space bounds of the vertex positions
+	};
+
+	// Identifies one of the built-in meshes. Ids at or above MeshTypeCount
+	// refer to meshes loaded from .mesh files, in load order.
+	enum MeshType : int
+	{
+		Plane,
+		Prism,
+		Cube,
+		Cylinder,
+		TaperedCylinder,
+		Pyramid,
+		Sphere,
+		Torus,
+		MeshTypeCount
 	};
 
-public:
 	GLMesh gCubeMesh;
 	GLMesh gCylinderMesh;
 	GLMesh gTaperedCylinderMesh;
@@ -32,20 +58,49 @@ public:
 	GLMesh gPyramidMesh;
 	GLMesh gTorusMesh;
 
+	// Meshes loaded with LoadMeshFile
+	std::vector<GLMesh> gLoadedMeshes;
+
 public:
 	void CreateMeshes();
 	void DestroyMeshes();
 
+	GLMesh& GetMesh(MeshType type);
+	// instances: copies drawn with one call, numbered by gl_InstanceID
+	void DrawMesh(MeshType type, GLsizei instances = 1);
+
+	// Load a binary .mesh file; returns its id or -1 on failure
+	int LoadMeshFile(const char* filename);
+
+	// Import an .obj, .gltf or .glb model; returns its id or -1 on failure
+	int ImportMesh(const char* filename);
+
+	// Upload vertex data built on the CPU; returns its id. label names it
+	// in the GPU memory reports.
+	int AddMesh(const MeshData& data, const char* label);
+
+	// Build a cylinder, tapered cylinder, sphere or torus at any density with
+	// a compute shader, in the layout of the built-in mesh, so nothing is
+	// computed or uploaded by the CPU. segments go around the shape; rings are
+	// the sphere rings between the poles or the torus tube segments, unused
+	// by cylinders. Returns its id or -1 on failure.
+	int GenerateMesh(MeshType type, int segments, int rings);
+
+	// Vertex data of a built-in mesh as CreateMeshes uploads it: generated,
+	// indexed and welded. Returns the vertex count before welding.
+	static uint32_t GenerateBuiltInMesh(MeshType type, MeshData& data);
+
+	// CPU copy of the triangles DrawMesh draws for a built-in mesh, as an
+	// unindexed list in the standard layout. Position only meshes get flat
+	// normals and zero texture coords. False for loaded meshes, which keep
+	// no CPU data.
+	static bool GenerateTriangles(MeshType type, MeshData& triangles);
+
 private:
-	void UCreatePlaneMesh(GLMesh& mesh);
-	void UCreatePrismMesh(GLMesh& mesh);
-	void UCreateCubeMesh(GLMesh& mesh);
-	void UCreateCylinderMesh(GLMesh& mesh);
-	void UCreateTaperedCylinderMesh(GLMesh& mesh);
-	void UCreateTorusMesh(GLMesh& mesh);
-	void UCreatePyramidMesh(GLMesh& mesh);
-	void UCreateSphereMesh(GLMesh& mesh);
-
-	void UDestroyMesh(GLMesh& mesh);
+	// Upload several meshes at once; must run on the GL thread
+	void UUploadMeshes(const MeshData* data, const char* const* labels, GLMesh* const* targets, size_t count);
+
+	// resources/shaders/primitives.comp, compiled by the first GenerateMesh
+	GpuProgram gGeneratorProgram;
 }; 
 
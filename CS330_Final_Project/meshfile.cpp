@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshfile.cpp
+// ========
+// versioned binary mesh format, memory mapped for loading
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshfile.h"
+#include "logging.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	uint64_t UAlignUp(uint64_t value)
+	{
+		return (value + MESH_FILE_ALIGNMENT - 1) & ~uint64_t(MESH_FILE_ALIGNMENT - 1);
+	}
+
+	// true when [offset, offset + length) lies inside a file of fileSize bytes
+	bool UInRange(uint64_t offset, uint64_t length, uint64_t fileSize)
+	{
+		return offset <= fileSize && length <= fileSize - offset;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+///////////////////////////////////////////////////
+//	MappedFile::Open(const char*)
+//
+//	filename: file to map read only
+//
+//	Map the whole file into memory. Pages are read
+//	from disk on first touch, so nothing is copied
+///////////////////////////////////////////////////
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	this->fileHandle = fileHandle;
+	this->mappingHandle = mappingHandle;
+	data = static_cast<const unsigned char*>(view);
+	size = size_t(fileSize.QuadPart);
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference to the file
+	if (view == MAP_FAILED)
+		return false;
+
+	// the blobs are read front to back exactly once, so ask for read-ahead;
+	// advice values are not flags, each takes its own call
+	madvise(view, size_t(info.st_size), MADV_SEQUENTIAL);
+	madvise(view, size_t(info.st_size), MADV_WILLNEED);
+
+	data = static_cast<const unsigned char*>(view);
+	size = size_t(info.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+///////////////////////////////////////////////////
+//	MeshFile::Open(const char*)
+//
+//	filename: path of the .mesh file
+//
+//	Map the file and check that the header, tables and
+//	blobs are consistent before anything reads them
+///////////////////////////////////////////////////
+bool MeshFile::Open(const char* filename)
+{
+	if (!file.Open(filename))
+	{
+		LOG_ERROR << "ERROR::MESHFILE::CANNOT_OPEN " << filename;
+		return false;
+	}
+
+	uint64_t fileSize = file.Size();
+	const MeshFileHeader& header = Header();
+
+	const char* error = nullptr;
+	if (fileSize < sizeof(MeshFileHeader) || header.magic != MESH_FILE_MAGIC)
+		error = "NOT_A_MESH_FILE";
+	else if (header.version != MESH_FILE_VERSION)
+		error = "UNSUPPORTED_VERSION";
+	else if (header.attributeCount == 0 || header.attributeCount > MESH_FILE_MAX_ATTRIBUTES)
+		error = "BAD_ATTRIBUTE_COUNT";
+	else if (!UInRange(sizeof(MeshFileHeader), uint64_t(header.attributeCount) * sizeof(MeshFileAttribute) +
+		uint64_t(header.submeshCount) * sizeof(MeshFileSubmesh), fileSize))
+		error = "TRUNCATED_TABLES";
+	else if (header.vertexOffset % MESH_FILE_ALIGNMENT != 0 || header.indexOffset % MESH_FILE_ALIGNMENT != 0)
+		error = "MISALIGNED_BLOB";
+	else if (header.vertexSize != uint64_t(header.vertexCount) * header.vertexStride ||
+		!UInRange(header.vertexOffset, header.vertexSize, fileSize))
+		error = "BAD_VERTEX_BLOB";
+	else if (header.indexCount > 0 && (header.indexType != MESH_FILE_UNSIGNED_INT ||
+		header.indexSize != uint64_t(header.indexCount) * sizeof(uint32_t) ||
+		!UInRange(header.indexOffset, header.indexSize, fileSize)))
+		error = "BAD_INDEX_BLOB";
+
+	for (uint32_t i = 0; !error && i < header.attributeCount; ++i)
+	{
+		const MeshFileAttribute& attribute = Attributes()[i];
+		if (attribute.componentType != MESH_FILE_FLOAT || attribute.componentCount < 1 || attribute.componentCount > 4 ||
+			attribute.offset + attribute.componentCount * sizeof(float) > header.vertexStride)
+			error = "BAD_ATTRIBUTE";
+	}
+
+	for (uint32_t i = 0; !error && i < header.submeshCount; ++i)
+	{
+		const MeshFileSubmesh& submesh = Submeshes()[i];
+		if (uint64_t(submesh.firstIndex) + submesh.indexCount > header.indexCount)
+			error = "BAD_SUBMESH";
+	}
+
+	if (error)
+	{
+		LOG_ERROR << "ERROR::MESHFILE::" << error << " " << filename;
+		file.Close();
+		return false;
+	}
+
+	return true;
+}
+
+const MeshFileAttribute* MeshFile::Attributes() const
+{
+	return reinterpret_cast<const MeshFileAttribute*>(file.Data() + sizeof(MeshFileHeader));
+}
+
+const MeshFileSubmesh* MeshFile::Submeshes() const
+{
+	return reinterpret_cast<const MeshFileSubmesh*>(Attributes() + Header().attributeCount);
+}
+
+///////////////////////////////////////////////////
+//	WriteMeshFile(const char*, const MeshFileContents&)
+//
+//	filename: path of the .mesh file to create
+//	contents: layout, tables and blobs to store
+//
+//	Write the header, tables and aligned blobs
+///////////////////////////////////////////////////
+bool WriteMeshFile(const char* filename, const MeshFileContents& contents)
+{
+	MeshFileHeader header = {};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.attributeCount = uint32_t(contents.attributes.size());
+	header.submeshCount = uint32_t(contents.submeshes.size());
+	header.vertexStride = contents.vertexStride;
+	header.vertexCount = contents.vertexCount;
+	header.indexCount = contents.indexCount;
+	header.indexType = MESH_FILE_UNSIGNED_INT;
+	for (int i = 0; i < 3; ++i)
+	{
+		header.boundsMin[i] = contents.boundsMin[i];
+		header.boundsMax[i] = contents.boundsMax[i];
+	}
+
+	uint64_t tablesEnd = sizeof(MeshFileHeader) + contents.attributes.size() * sizeof(MeshFileAttribute) +
+		contents.submeshes.size() * sizeof(MeshFileSubmesh);
+	header.vertexOffset = UAlignUp(tablesEnd);
+	header.vertexSize = uint64_t(contents.vertexCount) * contents.vertexStride;
+	if (contents.indexCount > 0)
+	{
+		header.indexOffset = UAlignUp(header.vertexOffset + header.vertexSize);
+		header.indexSize = uint64_t(contents.indexCount) * sizeof(uint32_t);
+	}
+
+	std::ofstream out(filename, std::ios::binary);
+	if (!out)
+		return false;
+
+	static const char zeros[MESH_FILE_ALIGNMENT] = {};
+	uint64_t written = 0;
+	auto write = [&](const void* bytes, uint64_t count) {
+		out.write(static_cast<const char*>(bytes), std::streamsize(count));
+		written += count;
+		return bool(out);
+	};
+	auto pad = [&](uint64_t offset) {
+		return write(zeros, offset - written);
+	};
+
+	bool ok = write(&header, sizeof(header)) &&
+		write(contents.attributes.data(), contents.attributes.size() * sizeof(MeshFileAttribute)) &&
+		write(contents.submeshes.data(), contents.submeshes.size() * sizeof(MeshFileSubmesh)) &&
+		pad(header.vertexOffset) &&
+		write(contents.vertices, header.vertexSize);
+	if (ok && contents.indexCount > 0)
+		ok = pad(header.indexOffset) && write(contents.indices, header.indexSize);
+
+	out.close();
+	ok = ok && !out.fail();
+	return ok;
+}
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshfile.h
+// ========
+// versioned binary mesh format, memory mapped for loading
+//
+// File layout (little endian, every blob aligned to MESH_FILE_ALIGNMENT):
+//		MeshFileHeader
+//		MeshFileAttribute[attributeCount]	vertex layout descriptor
+//		MeshFileSubmesh[submeshCount]		ranges of the index blob
+//		vertex blob							vertexCount * vertexStride bytes
+//		index blob							indexCount * 4 bytes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const uint32_t MESH_FILE_MAGIC = 0x4853454D;	// "MESH"
+const uint32_t MESH_FILE_VERSION = 1;
+const uint32_t MESH_FILE_ALIGNMENT = 64;
+const uint32_t MESH_FILE_MAX_ATTRIBUTES = 16;
+
+// GL enums stored in the file, repeated here so the format has no GL dependency
+const uint32_t MESH_FILE_FLOAT = 0x1406;			// GL_FLOAT
+const uint32_t MESH_FILE_UNSIGNED_INT = 0x1405;		// GL_UNSIGNED_INT
+const uint32_t MESH_FILE_TRIANGLES = 0x0004;		// GL_TRIANGLES
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t attributeCount;
+	uint32_t submeshCount;
+	uint32_t vertexStride;		// bytes per interleaved vertex
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexType;			// MESH_FILE_UNSIGNED_INT
+	uint64_t vertexOffset;		// byte offset of the vertex blob from the start of the file
+	uint64_t vertexSize;
+	uint64_t indexOffset;		// byte offset of the index blob, 0 when not indexed
+	uint64_t indexSize;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+// One vertex attribute of the interleaved vertex
+struct MeshFileAttribute
+{
+	uint32_t location;			// shader attribute location
+	uint32_t componentCount;
+	uint32_t componentType;		// MESH_FILE_FLOAT
+	uint32_t offset;			// byte offset inside the vertex
+};
+
+// A range of the index blob drawn with one material
+struct MeshFileSubmesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t primitive;			// MESH_FILE_TRIANGLES
+	uint32_t materialId;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+static_assert(sizeof(MeshFileHeader) == 88, "MeshFileHeader layout changed");
+static_assert(sizeof(MeshFileAttribute) == 16, "MeshFileAttribute layout changed");
+static_assert(sizeof(MeshFileSubmesh) == 40, "MeshFileSubmesh layout changed");
+
+// Read only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* filename);
+	void Close();
+
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+// A validated, memory mapped .mesh file. The blob pointers point into the
+// mapped pages and stay valid until Close().
+class MeshFile
+{
+public:
+	bool Open(const char* filename);
+	void Close() { file.Close(); }
+
+	const MeshFileHeader& Header() const { return *reinterpret_cast<const MeshFileHeader*>(file.Data()); }
+	const MeshFileAttribute* Attributes() const;
+	const MeshFileSubmesh* Submeshes() const;
+	const void* VertexData() const { return file.Data() + Header().vertexOffset; }
+	const void* IndexData() const { return Header().indexCount ? file.Data() + Header().indexOffset : nullptr; }
+
+private:
+	MappedFile file;
+};
+
+// Everything needed to write a .mesh file
+struct MeshFileContents
+{
+	std::vector<MeshFileAttribute> attributes;
+	std::vector<MeshFileSubmesh> submeshes;
+	uint32_t vertexStride = 0;
+	uint32_t vertexCount = 0;
+	const void* vertices = nullptr;
+	uint32_t indexCount = 0;
+	const uint32_t* indices = nullptr;
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+bool WriteMeshFile(const char* filename, const MeshFileContents& contents);
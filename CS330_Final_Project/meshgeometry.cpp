@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.cpp
+// ========
+// CPU side of the built-in meshes: their vertex data and mesh lookup, with no
+// GL calls, so the software renderer links it without a GL context
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshes.h"
+#include "primitives.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	typedef void (*Generator)(MeshData& mesh);
+	const Generator GENERATORS[Meshes::MeshTypeCount] = {
+		GeneratePlaneMesh,				// in MeshType order
+		GeneratePrismMesh,
+		GenerateCubeMesh,
+		GenerateCylinderMesh,
+		GenerateTaperedCylinderMesh,
+		GeneratePyramidMesh,
+		GenerateSphereMesh,
+		GenerateTorusMesh,
+	};
+
+	// largest difference of a position, normal or uv in vertices that are merged
+	const float WELD_EPSILON = 1e-5f;
+
+	// Index a built-in mesh and weld its shared vertices; only the side strip
+	// of the cylinders is drawn, their caps are dropped
+	void UConditionMesh(Meshes::MeshType type, MeshData& data)
+	{
+		if (type == Meshes::Cylinder || type == Meshes::TaperedCylinder)
+		{
+			typedef primitives::CylinderLayout<CYLINDER_SEGMENTS> Layout;
+			IndexTriangleStrip(data, Layout::SIDE_FIRST, Layout::SIDE_VERTICES);
+		}
+		WeldVertices(data, WELD_EPSILON);
+	}
+}
+
+///////////////////////////////////////////////////
+//	GenerateBuiltInMesh(MeshType, MeshData&)
+//
+//	type: which of the built-in meshes to generate
+//	data: receives the vertex data
+//
+//	Generate, index and weld a built-in mesh the way
+//	it is uploaded. Returns the vertex count before
+//	welding, for the mesh reports
+///////////////////////////////////////////////////
+uint32_t Meshes::GenerateBuiltInMesh(MeshType type, MeshData& data)
+{
+	GENERATORS[type](data);
+	uint32_t generated = data.VertexCount();
+	UConditionMesh(type, data);
+	return generated;
+}
+
+///////////////////////////////////////////////////
+//	GetMesh(MeshType)
+//
+//	type: which of the built-in meshes to return
+///////////////////////////////////////////////////
+Meshes::GLMesh& Meshes::GetMesh(MeshType type)
+{
+	switch (type)
+	{
+	case Plane:				return gPlaneMesh;
+	case Prism:				return gPrismMesh;
+	case Cube:				return gCubeMesh;
+	case Cylinder:			return gCylinderMesh;
+	case TaperedCylinder:	return gTaperedCylinderMesh;
+	case Pyramid:			return gPyramidMesh;
+	case Sphere:			return gSphereMesh;
+	case Torus:				return gTorusMesh;
+	default:				return gLoadedMeshes[type - MeshTypeCount];
+	}
+}
+
+///////////////////////////////////////////////////
+//	GenerateTriangles(MeshType, MeshData&)
+//
+//	type: which of the built-in meshes to generate
+//	triangles: receives the triangle list
+//
+//	Regenerate the vertex data and expand it the way
+//	DrawMesh draws it, so tools that work on world
+//	space triangles see exactly what is rendered
+///////////////////////////////////////////////////
+bool Meshes::GenerateTriangles(MeshType type, MeshData& triangles)
+{
+	if (type < 0 || type >= MeshTypeCount)
+		return false;
+
+	MeshData data;
+	GenerateBuiltInMesh(type, data);
+
+	// vertex order of the triangles, as drawn
+	const std::vector<uint32_t>& order = data.indices;
+
+	triangles = MeshData();
+	SetStandardLayout(triangles);
+	triangles.vertices.reserve(order.size() * triangles.floatsPerEntry);
+	for (size_t i = 0; i < order.size(); i += 3)
+	{
+		const float* corners[3];
+		for (int j = 0; j < 3; ++j)
+			corners[j] = &data.vertices[size_t(order[i + j]) * data.floatsPerEntry];
+
+		glm::vec3 flatNormal(0.0f);
+		if (data.floatsPerEntry < 8)
+		{
+			glm::vec3 a(corners[0][0], corners[0][1], corners[0][2]);
+			glm::vec3 b(corners[1][0], corners[1][1], corners[1][2]);
+			glm::vec3 c(corners[2][0], corners[2][1], corners[2][2]);
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			flatNormal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+
+		for (int j = 0; j < 3; ++j)
+		{
+			const float* vertex = corners[j];
+			if (data.floatsPerEntry >= 8)
+				triangles.vertices.insert(triangles.vertices.end(), vertex, vertex + 8);
+			else
+			{
+				const float extra[5] = { flatNormal.x, flatNormal.y, flatNormal.z, 0.0f, 0.0f };
+				triangles.vertices.insert(triangles.vertices.end(), vertex, vertex + 3);
+				triangles.vertices.insert(triangles.vertices.end(), extra, extra + 5);
+			}
+		}
+	}
+	triangles.bounds = data.bounds;
+	return true;
+}
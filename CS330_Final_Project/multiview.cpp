@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiview.cpp
+// ========
+// several cameras drawn in one pass over the scene, each into its own viewport
+///////////////////////////////////////////////////////////////////////////////
+
+#include "multiview.h"
+#include "logging.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+namespace
+{
+	// between the stereo eyes, in scene units (about meters)
+	const float EYE_SEPARATION = 0.064f;
+	// the quad views circle the point this far in front of the camera
+	const float QUAD_FOCUS_DISTANCE = 2.0f;
+}
+
+bool MultiView::SetLayout(ViewLayout layout)
+{
+	this->layout = ViewLayout::Single;
+	count = 1;
+	if (layout == ViewLayout::Single)
+		return true;
+
+	if (!GLEW_ARB_viewport_array || !GLEW_ARB_shader_viewport_layer_array)
+	{
+		LOG_WARNING << "WARNING::MULTIVIEW::UNSUPPORTED GL_ARB_shader_viewport_layer_array is missing, drawing one view";
+		return false;
+	}
+	this->layout = layout;
+	count = layout == ViewLayout::Stereo ? 2 : 4;
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Update(const glm::vec3&, const glm::vec3&, const glm::vec3&, float, const glm::ivec4&, float, float)
+//
+//	position, front, up: the camera
+//	fov: vertical field of view in degrees
+//	target: x, y, width, height the views share
+//	nearPlane, farPlane: clip distances of every view
+//
+//	Each view keeps the aspect of its own viewport,
+//	so the quad views see what the camera would in
+//	a window of that shape
+///////////////////////////////////////////////////
+void MultiView::Update(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up, float fov,
+	const glm::ivec4& target, float nearPlane, float farPlane)
+{
+	float x = float(target.x), y = float(target.y), width = float(target.z), height = float(target.w);
+	switch (layout)
+	{
+	case ViewLayout::Single:
+		views[0].position = position;
+		views[0].view = glm::lookAt(position, position + front, up);
+		views[0].viewport = glm::vec4(x, y, width, height);
+		break;
+
+	case ViewLayout::Stereo:
+	{
+		// parallel eyes; the left one draws on the left half
+		glm::vec3 right = glm::normalize(glm::cross(front, up));
+		for (int eye = 0; eye < 2; ++eye)
+		{
+			glm::vec3 eyePosition = position + right * (eye == 0 ? -0.5f : 0.5f) * EYE_SEPARATION;
+			views[eye].position = eyePosition;
+			views[eye].view = glm::lookAt(eyePosition, eyePosition + front, up);
+			views[eye].viewport = glm::vec4(x + eye * width * 0.5f, y, width * 0.5f, height);
+		}
+		break;
+	}
+
+	case ViewLayout::Quad:
+	{
+		glm::vec3 focus = position + glm::normalize(front) * QUAD_FOCUS_DISTANCE;
+		const glm::vec3 worldUp(0.0f, 1.0f, 0.0f);
+		for (int i = 0; i < 4; ++i)
+		{
+			// a quarter turn about the vertical through the focus per view
+			glm::vec3 offset = glm::vec3(glm::rotate(glm::radians(90.0f * i), worldUp) * glm::vec4(position - focus, 0.0f));
+			views[i].position = focus + offset;
+			views[i].view = i == 0 ? glm::lookAt(position, position + front, up) : glm::lookAt(focus + offset, focus, worldUp);
+			// left to right, top row first; viewports count from the bottom
+			views[i].viewport = glm::vec4(x + (i % 2) * width * 0.5f, y + (i < 2 ? height * 0.5f : 0.0f),
+				width * 0.5f, height * 0.5f);
+		}
+		break;
+	}
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		float aspect = views[i].viewport.w > 0.0f ? views[i].viewport.z / views[i].viewport.w : 1.0f;
+		views[i].projection = glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
+		frustums[i] = Frustum::FromMatrix(views[i].projection * views[i].view);
+	}
+}
+
+bool MultiView::IsVisible(const Bounds& box) const
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (frustums[i].Intersects(box))
+			return true;
+	}
+	return false;
+}
+
+void MultiView::ApplyViewports() const
+{
+	float viewports[MAX_VIEWS * 4];
+	for (int i = 0; i < count; ++i)
+		memcpy(&viewports[i * 4], glm::value_ptr(views[i].viewport), sizeof(float) * 4);
+	glViewportArrayv(0, count, viewports);
+}
+
+void MultiView::SetUniforms(GLuint program) const
+{
+	glm::mat4 viewMatrices[MAX_VIEWS], projections[MAX_VIEWS];
+	glm::vec3 positions[MAX_VIEWS];
+	for (int i = 0; i < count; ++i)
+	{
+		viewMatrices[i] = views[i].view;
+		projections[i] = views[i].projection;
+		positions[i] = views[i].position;
+	}
+	glUniformMatrix4fv(glGetUniformLocation(program, "views"), count, GL_FALSE, glm::value_ptr(viewMatrices[0]));
+	glUniformMatrix4fv(glGetUniformLocation(program, "projections"), count, GL_FALSE, glm::value_ptr(projections[0]));
+	glUniform3fv(glGetUniformLocation(program, "viewPositions"), count, glm::value_ptr(positions[0]));
+}
+
+bool MultiView::ParseLayout(const char* text, ViewLayout& layout)
+{
+	if (strcmp(text, "single") == 0)
+		layout = ViewLayout::Single;
+	else if (strcmp(text, "stereo") == 0)
+		layout = ViewLayout::Stereo;
+	else if (strcmp(text, "quad") == 0)
+		layout = ViewLayout::Quad;
+	else
+		return false;
+	return true;
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiview.h
+// ========
+// several cameras drawn in one pass over the scene, each into its own viewport
+//
+// The draw list is built and culled once for all the views: an object is
+// kept when any view sees it. Every draw is then instanced once per view;
+// the vertex shaders, compiled with VIEW_COUNT, take the matrices of view
+// gl_InstanceID and send the instance to viewport gl_InstanceID of the
+// viewport array (GL_ARB_shader_viewport_layer_array). A view adds vertex
+// work but no traversal, state changes or draw calls.
+//
+// Layouts:
+//   Stereo  two eyes side by side, EYE_SEPARATION apart along the camera's right
+//   Quad    2x2: the camera top left, then three views circling the point
+//           it looks at, a quarter turn apart
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+enum class ViewLayout
+{
+	Single,
+	Stereo,
+	Quad,
+};
+
+struct ViewSetup
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 position;
+	glm::vec4 viewport;		// x, y, width, height in pixels, from the lower left
+};
+
+class MultiView
+{
+public:
+	static const int MAX_VIEWS = 4;
+
+	// False, with a warning, when the GL cannot pick viewports in the vertex
+	// shader; the layout stays Single then
+	bool SetLayout(ViewLayout layout);
+	ViewLayout GetLayout() const { return layout; }
+	int Count() const { return count; }
+
+	// Place the views of a camera over the target rectangle, which one view
+	// would fill; fov is vertical, in degrees
+	void Update(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up, float fov,
+		const glm::ivec4& target, float nearPlane, float farPlane);
+
+	const ViewSetup& GetView(int index) const { return views[index]; }
+
+	// Whether any of the views sees the box
+	bool IsVisible(const Bounds& box) const;
+
+	// Viewport i of the array shows view i
+	void ApplyViewports() const;
+
+	// views[], projections[] and viewPositions[] of a VIEW_COUNT program
+	void SetUniforms(GLuint program) const;
+
+	// "single", "stereo" or "quad"
+	static bool ParseLayout(const char* text, ViewLayout& layout);
+
+private:
+	ViewLayout layout = ViewLayout::Single;
+	int count = 1;
+	ViewSetup views[MAX_VIEWS];
+	Frustum frustums[MAX_VIEWS];
+};
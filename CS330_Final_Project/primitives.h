@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitives.h
+// ========
+// compile time vertex and index tables of the built-in primitives
+//
+// The generators are constexpr templates on their segment counts, so the
+// tables are computed by the compiler with exact values and a denser mesh
+// is a change of one template argument. Vertices are interleaved position,
+// normal and texture coords, the standard layout of MeshData.
+//
+// The trigonometry below is constexpr because the <cmath> functions are
+// not; it is accurate to double precision for the angles used here.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace primitives
+{
+	constexpr double PI = 3.14159265358979323846;
+	constexpr size_t FLOATS_PER_VERTEX = 8;
+
+	// Taylor series after reducing the angle to [-pi, pi]
+	constexpr double Sin(double x)
+	{
+		while (x > PI)
+			x -= 2.0 * PI;
+		while (x < -PI)
+			x += 2.0 * PI;
+
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 20; ++n)
+		{
+			term *= -x * x / double((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr double Cos(double x)
+	{
+		return Sin(x + PI / 2.0);
+	}
+
+	// Newton iterations; x >= 0
+	constexpr double Sqrt(double x)
+	{
+		if (x <= 0.0)
+			return 0.0;
+		double root = x > 1.0 ? x : 1.0;
+		for (int i = 0; i < 64; ++i)
+		{
+			double next = 0.5 * (root + x / root);
+			if (next == root)
+				break;
+			root = next;
+		}
+		return root;
+	}
+
+	template <size_t VertexCount, size_t IndexCount>
+	struct Tables
+	{
+		std::array<float, VertexCount * FLOATS_PER_VERTEX> vertices{};
+		std::array<uint32_t, IndexCount> indices{};
+
+		constexpr void SetVertex(size_t index, double x, double y, double z, double nx, double ny, double nz, double u, double v)
+		{
+			const double values[FLOATS_PER_VERTEX] = { x, y, z, nx, ny, nz, u, v };
+			for (size_t i = 0; i < FLOATS_PER_VERTEX; ++i)
+				vertices[index * FLOATS_PER_VERTEX + i] = float(values[i]);
+		}
+	};
+
+	//*************************************
+	// Cube
+	//*************************************
+
+	// Unit cube centered on the origin, two triangles per face, drawn as arrays
+	constexpr Tables<36, 0> MakeCube()
+	{
+		// corners of each face in texture order from its (0, 0) corner; on the
+		// top, right, back and bottom faces that order runs clockwise seen
+		// from outside, so their triangles are emitted reversed
+		constexpr double FACES[6][4][3] = {
+			{ { -0.5, 0.5, -0.5 }, { 0.5, 0.5, -0.5 }, { 0.5, 0.5, 0.5 }, { -0.5, 0.5, 0.5 } },			// top
+			{ { -0.5, -0.5, 0.5 }, { 0.5, -0.5, 0.5 }, { 0.5, 0.5, 0.5 }, { -0.5, 0.5, 0.5 } },			// front
+			{ { -0.5, -0.5, -0.5 }, { -0.5, -0.5, 0.5 }, { -0.5, 0.5, 0.5 }, { -0.5, 0.5, -0.5 } },		// left
+			{ { 0.5, -0.5, 0.5 }, { 0.5, 0.5, 0.5 }, { 0.5, 0.5, -0.5 }, { 0.5, -0.5, -0.5 } },			// right
+			{ { -0.5, -0.5, -0.5 }, { 0.5, -0.5, -0.5 }, { 0.5, 0.5, -0.5 }, { -0.5, 0.5, -0.5 } },		// back
+			{ { -0.5, -0.5, 0.5 }, { 0.5, -0.5, 0.5 }, { 0.5, -0.5, -0.5 }, { -0.5, -0.5, -0.5 } },		// bottom
+		};
+		constexpr double NORMALS[6][3] = { { 0, 1, 0 }, { 0, 0, 1 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } };
+		constexpr double UVS[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+		constexpr int CORNERS[2][6] = {
+			{ 0, 1, 2, 2, 3, 0 },	// corners counter clockwise
+			{ 0, 2, 1, 2, 0, 3 },	// corners clockwise: same triangles, reversed
+		};
+
+		Tables<36, 0> cube;
+		for (size_t face = 0; face < 6; ++face)
+		{
+			// winding of the corners against the face normal
+			const double (*c)[3] = FACES[face];
+			double e1[3] = { c[1][0] - c[0][0], c[1][1] - c[0][1], c[1][2] - c[0][2] };
+			double e2[3] = { c[2][0] - c[0][0], c[2][1] - c[0][1], c[2][2] - c[0][2] };
+			double facing = (e1[1] * e2[2] - e1[2] * e2[1]) * NORMALS[face][0] +
+				(e1[2] * e2[0] - e1[0] * e2[2]) * NORMALS[face][1] + (e1[0] * e2[1] - e1[1] * e2[0]) * NORMALS[face][2];
+			const int* corners = CORNERS[facing < 0.0 ? 1 : 0];
+
+			for (size_t i = 0; i < 6; ++i)
+			{
+				const double* position = FACES[face][corners[i]];
+				const double* uv = UVS[corners[i]];
+				cube.SetVertex(face * 6 + i, position[0], position[1], position[2],
+					NORMALS[face][0], NORMALS[face][1], NORMALS[face][2], uv[0], uv[1]);
+			}
+		}
+		return cube;
+	}
+
+	//*************************************
+	// Cylinders
+	//*************************************
+
+	// Vertex ranges of a cylinder with Segments sides:
+	//   bottom cap: center and Segments + 1 rim vertices, a triangle fan
+	//   top cap: the same
+	//   side: Segments + 1 top/bottom pairs, a triangle strip
+	template <int Segments>
+	struct CylinderLayout
+	{
+		static constexpr uint32_t CAP_VERTICES = Segments + 2;
+		static constexpr uint32_t SIDE_FIRST = 2 * CAP_VERTICES;
+		static constexpr uint32_t SIDE_VERTICES = 2 * (Segments + 1);
+		static constexpr size_t VERTEX_COUNT = SIDE_FIRST + SIDE_VERTICES;
+	};
+
+	// Height 1 from y = 0, with the given radii at the bottom and the top, so
+	// a top radius below the bottom one makes a truncated cone. The side
+	// texture wraps once around; the caps are mapped from above.
+	template <int Segments>
+	constexpr Tables<CylinderLayout<Segments>::VERTEX_COUNT, 0> MakeCylinder(double bottomRadius, double topRadius)
+	{
+		typedef CylinderLayout<Segments> Layout;
+		Tables<Layout::VERTEX_COUNT, 0> cylinder;
+
+		// the side normal leans up by the slope of the side
+		double slope = bottomRadius - topRadius;
+		double normalLength = Sqrt(1.0 + slope * slope);
+
+		cylinder.SetVertex(0, 0.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.5, 0.5);
+		cylinder.SetVertex(Layout::CAP_VERTICES, 0.0, 1.0, 0.0, 0.0, 1.0, 0.0, 0.5, 0.5);
+		for (int i = 0; i <= Segments; ++i)
+		{
+			// clockwise seen from above, starting at +x, as the hand made tables did
+			double angle = 2.0 * PI * double(i % Segments) / double(Segments);
+			double c = Cos(angle);
+			double s = -Sin(angle);
+
+			// bottom fan is seen from below, so its rim runs the other way
+			cylinder.SetVertex(1 + (Segments - i), bottomRadius * c, 0.0, bottomRadius * s,
+				0.0, -1.0, 0.0, 0.5 + 0.5 * c, 0.5 - 0.5 * s);
+			cylinder.SetVertex(Layout::CAP_VERTICES + 1 + i, topRadius * c, 1.0, topRadius * s,
+				0.0, 1.0, 0.0, 0.5 + 0.5 * c, 0.5 + 0.5 * s);
+
+			double u = double(i) / double(Segments);
+			double nx = c / normalLength, ny = slope / normalLength, nz = s / normalLength;
+			cylinder.SetVertex(Layout::SIDE_FIRST + 2 * i, topRadius * c, 1.0, topRadius * s, nx, ny, nz, u, 1.0);
+			cylinder.SetVertex(Layout::SIDE_FIRST + 2 * i + 1, bottomRadius * c, 0.0, bottomRadius * s, nx, ny, nz, u, 0.0);
+		}
+		return cylinder;
+	}
+
+	//*************************************
+	// Sphere
+	//*************************************
+
+	// UV sphere of radius 1: a vertex at each pole and Rings rings of
+	// Segments + 1 vertices between them, drawn as an indexed triangle list.
+	// The first and last vertex of a ring share a position at the texture
+	// seam, with u 0 and 1, so no triangle spans the seam.
+	template <int Rings, int Segments>
+	struct SphereLayout
+	{
+		static constexpr size_t RING_VERTICES = Segments + 1;
+		static constexpr size_t VERTEX_COUNT = 2 + Rings * RING_VERTICES;
+		static constexpr size_t INDEX_COUNT = 3 * Segments * 2 + 6 * Segments * (Rings - 1);
+	};
+
+	template <int Rings, int Segments>
+	constexpr Tables<SphereLayout<Rings, Segments>::VERTEX_COUNT, SphereLayout<Rings, Segments>::INDEX_COUNT> MakeSphere()
+	{
+		typedef SphereLayout<Rings, Segments> Layout;
+		Tables<Layout::VERTEX_COUNT, Layout::INDEX_COUNT> sphere;
+		const uint32_t columns = uint32_t(Layout::RING_VERTICES);
+		const uint32_t bottom = uint32_t(Layout::VERTEX_COUNT - 1);
+
+		// on a unit sphere the normal is the position; u follows the longitude
+		// from -pi to pi, with the seam at pi, and v the height
+		sphere.SetVertex(0, 0.0, 1.0, 0.0, 0.0, 1.0, 0.0, 0.5, 1.0);
+		sphere.SetVertex(bottom, 0.0, -1.0, 0.0, 0.0, -1.0, 0.0, 0.5, 0.0);
+		// every ring has the same longitudes, so their sines and cosines are
+		// computed once, which also keeps the compile time evaluation short
+		std::array<double, Segments + 1> sines{}, cosines{};
+		for (int column = 0; column <= Segments; ++column)
+		{
+			double longitude = PI + 2.0 * PI * double(column % Segments) / double(Segments);
+			sines[column] = Sin(longitude);
+			cosines[column] = Cos(longitude);
+		}
+
+		for (int ring = 0; ring < Rings; ++ring)
+		{
+			double polar = PI * double(ring + 1) / double(Rings + 1);
+			double y = Cos(polar);
+			double radius = Sin(polar);
+			for (int column = 0; column <= Segments; ++column)
+			{
+				double x = radius * sines[column];
+				double z = radius * cosines[column];
+				double u = double(column) / double(Segments);
+				sphere.SetVertex(1 + ring * columns + column, x, y, z, x, y, z, u, y * 0.5 + 0.5);
+			}
+		}
+
+		size_t index = 0;
+		for (int segment = 0; segment < Segments; ++segment)
+		{
+			sphere.indices[index++] = 0;
+			sphere.indices[index++] = 1 + segment;
+			sphere.indices[index++] = 1 + segment + 1;
+		}
+		for (int ring = 0; ring + 1 < Rings; ++ring)
+		{
+			uint32_t upper = 1 + ring * columns;
+			uint32_t lower = upper + columns;
+			for (int segment = 0; segment < Segments; ++segment)
+			{
+				uint32_t next = segment + 1;
+				sphere.indices[index++] = upper + segment;
+				sphere.indices[index++] = lower + segment;
+				sphere.indices[index++] = lower + next;
+				sphere.indices[index++] = upper + segment;
+				sphere.indices[index++] = upper + next;
+				sphere.indices[index++] = lower + next;
+			}
+		}
+		uint32_t last = 1 + (Rings - 1) * columns;
+		for (int segment = 0; segment < Segments; ++segment)
+		{
+			sphere.indices[index++] = last + segment;
+			sphere.indices[index++] = last + segment + 1;
+			sphere.indices[index++] = bottom;
+		}
+		return sphere;
+	}
+}
@@ -0,0 +1,492 @@
+///////////////////////////////////////////////////////////////////////////////
+// rasterizer.cpp
+// ========
+// tile based software rasterizer for hosts without a GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "rasterizer.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	const int TILE_SIZE = 64;
+	const float NEAR_EPSILON = 1e-5f;
+	// glPolygonOffset(2, 4) of the shadow pass on a 24 bit depth buffer
+	const float OFFSET_FACTOR = 2.0f;
+	const float OFFSET_UNITS = 4.0f / 16777216.0f;
+
+	struct ClipVertex
+	{
+		glm::vec4 clip;
+		glm::vec3 world;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// Screen space triangle; attributes are divided by w for perspective
+	// correct interpolation
+	struct RasterTriangle
+	{
+		float x[3], y[3], z[3], invW[3];
+		glm::vec3 world[3];
+		glm::vec3 normal[3];
+		glm::vec2 uv[3];
+		uint32_t draw;
+	};
+
+	ClipVertex ULerp(const ClipVertex& a, const ClipVertex& b, float t)
+	{
+		ClipVertex v;
+		v.clip = a.clip + (b.clip - a.clip) * t;
+		v.world = a.world + (b.world - a.world) * t;
+		v.normal = a.normal + (b.normal - a.normal) * t;
+		v.uv = a.uv + (b.uv - a.uv) * t;
+		return v;
+	}
+
+	///////////////////////////////////////////////////
+	//	UTransformDraw(const RasterDraw&, uint32_t, const glm::mat4&, int, int, std::vector<RasterTriangle>&)
+	//
+	//	Transform a draw to clip space, clip its triangles
+	//	against the near plane (z >= -w) and map them to
+	//	pixels, rows top to bottom. Other planes need no
+	//	clipping: tiles bound x and y, the depth test z
+	///////////////////////////////////////////////////
+	void UTransformDraw(const RasterDraw& draw, uint32_t index, const glm::mat4& viewProjection, int width, int height,
+		std::vector<RasterTriangle>& out)
+	{
+		const MeshData& mesh = *draw.triangles;
+		glm::mat4 clipFromModel = viewProjection * draw.model;
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+
+		for (uint32_t v = 0; v + 2 < mesh.VertexCount(); v += 3)
+		{
+			ClipVertex corners[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				const float* vertex = &mesh.vertices[size_t(v + j) * mesh.floatsPerEntry];
+				glm::vec4 position(vertex[0], vertex[1], vertex[2], 1.0f);
+				corners[j].clip = clipFromModel * position;
+				corners[j].world = glm::vec3(draw.model * position);
+				corners[j].normal = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+				corners[j].uv = glm::vec2(vertex[6], vertex[7]);
+			}
+
+			// Sutherland-Hodgman against the near plane; at most four corners remain
+			ClipVertex polygon[4];
+			int count = 0;
+			for (int j = 0; j < 3; ++j)
+			{
+				const ClipVertex& a = corners[j];
+				const ClipVertex& b = corners[(j + 1) % 3];
+				float da = a.clip.z + a.clip.w;
+				float db = b.clip.z + b.clip.w;
+				if (da >= 0.0f)
+					polygon[count++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f))
+					polygon[count++] = ULerp(a, b, da / (da - db));
+			}
+
+			for (int j = 1; j + 1 < count; ++j)
+			{
+				const ClipVertex* fan[3] = { &polygon[0], &polygon[j], &polygon[j + 1] };
+				RasterTriangle triangle;
+				bool behind = false;
+				for (int k = 0; k < 3; ++k)
+				{
+					const ClipVertex& c = *fan[k];
+					if (c.clip.w < NEAR_EPSILON)
+					{
+						behind = true;
+						break;
+					}
+					float invW = 1.0f / c.clip.w;
+					triangle.x[k] = (c.clip.x * invW * 0.5f + 0.5f) * float(width);
+					triangle.y[k] = (0.5f - c.clip.y * invW * 0.5f) * float(height);
+					triangle.z[k] = c.clip.z * invW * 0.5f + 0.5f;
+					triangle.invW[k] = invW;
+					triangle.world[k] = c.world * invW;
+					triangle.normal[k] = c.normal * invW;
+					triangle.uv[k] = c.uv * invW;
+				}
+				if (behind)
+					continue;
+				triangle.draw = index;
+				out.push_back(triangle);
+			}
+		}
+	}
+
+	// Bilinear, repeating texture lookup; rows bottom to top like a GL texture
+	glm::vec3 USampleTexture(const Image& texture, const glm::vec2& uv)
+	{
+		float x = uv.x * float(texture.width) - 0.5f;
+		float y = uv.y * float(texture.height) - 0.5f;
+		float fx = std::floor(x), fy = std::floor(y);
+		float tx = x - fx, ty = y - fy;
+		int x0 = int(fx), y0 = int(fy);
+
+		auto texel = [&texture](int x, int y) {
+			x %= texture.width;
+			y %= texture.height;
+			x += x < 0 ? texture.width : 0;
+			y += y < 0 ? texture.height : 0;
+			const unsigned char* p = texture.Row(y) + size_t(x) * texture.channels;
+			return glm::vec3(p[0], p[1], p[2]) * (1.0f / 255.0f);
+		};
+		glm::vec3 top = texel(x0, y0) * (1.0f - tx) + texel(x0 + 1, y0) * tx;
+		glm::vec3 bottom = texel(x0, y0 + 1) * (1.0f - tx) + texel(x0 + 1, y0 + 1) * tx;
+		return top * (1.0f - ty) + bottom * ty;
+	}
+
+	// sampler2DShadow with linear filtering: four compares, bilinearly weighted.
+	// Texels outside the map read the ShadowCompare sampler's border depth of
+	// 1, which every reference passes: beyond the light frustum is lit
+	float UCompareShadow(const RasterDepthMap& map, float u, float v, float reference)
+	{
+		float x = u * float(map.size) - 0.5f;
+		float y = (1.0f - v) * float(map.size) - 0.5f;		// the map's rows run top to bottom
+		float fx = std::floor(x), fy = std::floor(y);
+		float tx = x - fx, ty = y - fy;
+		int x0 = int(fx), y0 = int(fy);
+
+		auto lit = [&map, reference](int x, int y) {
+			if (x < 0 || y < 0 || x >= map.size || y >= map.size)
+				return 1.0f;
+			return reference <= map.depth[size_t(y) * map.size + x] ? 1.0f : 0.0f;
+		};
+		float top = lit(x0, y0) * (1.0f - tx) + lit(x0 + 1, y0) * tx;
+		float bottom = lit(x0, y0 + 1) * (1.0f - tx) + lit(x0 + 1, y0 + 1) * tx;
+		return top * (1.0f - ty) + bottom * ty;
+	}
+
+	// ShadowFactor of surface.frag
+	float UShadowFactor(const RasterDepthMap& map, const glm::vec3& world, float bias)
+	{
+		glm::vec4 lightSpacePos = map.lightSpace * glm::vec4(world, 1.0f);
+		glm::vec3 projected = glm::vec3(lightSpacePos) / lightSpacePos.w * 0.5f + glm::vec3(0.5f);
+		if (projected.z > 1.0f)
+			return 1.0f;
+
+		float texelSize = 1.0f / float(map.size);
+		float visibility = 0.0f;
+		for (int x = -1; x <= 1; ++x)
+		{
+			for (int y = -1; y <= 1; ++y)
+			{
+				visibility += UCompareShadow(map, projected.x + float(x) * texelSize, projected.y + float(y) * texelSize,
+					std::min(projected.z - bias, 1.0f));
+			}
+		}
+		return visibility / 9.0f;
+	}
+
+	// main() of surface.frag, or of light.frag for unlit draws
+	glm::vec3 UShade(const RasterDraw& draw, const RasterShading& shading, const glm::vec3& world,
+		const glm::vec3& normal, const glm::vec2& uv)
+	{
+		glm::vec3 baseColor = draw.texture ? USampleTexture(*draw.texture, uv * draw.uvScale) : draw.color;
+		if (draw.unlit || shading.lightCount == 0)
+			return baseColor;
+
+		glm::vec3 norm = glm::normalize(normal);
+		glm::vec3 viewDir = glm::normalize(shading.viewPosition - world);
+		glm::vec3 ambient = shading.ambientStrength * shading.ambientColor;
+		glm::vec3 result(0.0f);
+		for (int i = 0; i < shading.lightCount; ++i)
+		{
+			const RasterLight& light = shading.lights[i];
+			glm::vec3 lightDirection = glm::normalize(light.position - world);
+			float impact = std::max(glm::dot(norm, lightDirection), 0.0f);
+			glm::vec3 lighting = impact * light.color;
+			if (draw.specular)
+			{
+				glm::vec3 reflectDir = glm::reflect(-lightDirection, norm);
+				float specularComponent = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), shading.highlightSize);
+				lighting += shading.specularIntensity * specularComponent * light.color;
+			}
+			float shadow = light.shadowMap ? UShadowFactor(*light.shadowMap, world, shading.shadowBias) : 1.0f;
+			result += (ambient + shadow * lighting) * baseColor;
+		}
+		return result;
+	}
+
+	// Everything a tile job needs to know about the frame
+	struct FrameState
+	{
+		const std::vector<RasterTriangle>* triangles;
+		const std::vector<std::vector<uint32_t>>* bins;
+		const std::vector<RasterDraw>* draws;
+		const RasterShading* shading;	// null for a depth only pass
+		int width, height, tilesPerRow;
+		float* depth;
+		float* color;					// RGB, null for a depth only pass
+		std::atomic<size_t>* pixels;
+	};
+
+	// Depth test and shade one triangle's pixels in [minX, maxX] x [minY, maxY]
+	void URasterizeTriangle(const FrameState& frame, const RasterTriangle& t, int minX, int minY, int maxX, int maxY,
+		size_t& shaded)
+	{
+		// edge k is opposite corner k: E = A * x + B * y + C, positive inside
+		float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.y[1] - t.y[0]) * (t.x[2] - t.x[0]);
+		if (area == 0.0f)
+			return;
+		float sign = area > 0.0f ? 1.0f : -1.0f;	// two sided: flip clockwise triangles
+		float invArea = 1.0f / (area * sign);
+		float A[3], B[3], C[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			int i = (k + 1) % 3, j = (k + 2) % 3;
+			A[k] = (t.y[i] - t.y[j]) * sign;
+			B[k] = (t.x[j] - t.x[i]) * sign;
+			C[k] = (t.x[i] * t.y[j] - t.x[j] * t.y[i]) * sign;
+		}
+
+		// depth is linear in screen space: z = zA * x + zB * y + zC
+		float zA = (t.z[0] * A[0] + t.z[1] * A[1] + t.z[2] * A[2]) * invArea;
+		float zB = (t.z[0] * B[0] + t.z[1] * B[1] + t.z[2] * B[2]) * invArea;
+		float zC = (t.z[0] * C[0] + t.z[1] * C[1] + t.z[2] * C[2]) * invArea;
+		if (!frame.color)
+			zC += OFFSET_FACTOR * std::max(std::fabs(zA), std::fabs(zB)) + OFFSET_UNITS;
+
+		const RasterDraw& draw = (*frame.draws)[t.draw];
+		auto shade = [&](int x, int y, float e0, float e1, float e2) {
+			if (!frame.color)
+				return;
+			// perspective correct barycentrics
+			float w0 = e0 * t.invW[0], w1 = e1 * t.invW[1], w2 = e2 * t.invW[2];
+			float inverse = 1.0f / (w0 + w1 + w2);
+			w0 = e0 * inverse;
+			w1 = e1 * inverse;
+			w2 = e2 * inverse;
+			glm::vec3 world = t.world[0] * w0 + t.world[1] * w1 + t.world[2] * w2;
+			glm::vec3 normal = t.normal[0] * w0 + t.normal[1] * w1 + t.normal[2] * w2;
+			glm::vec2 uv = t.uv[0] * w0 + t.uv[1] * w1 + t.uv[2] * w2;
+			glm::vec3 result = UShade(draw, *frame.shading, world, normal, uv);
+			float* out = frame.color + (size_t(y) * frame.width + x) * 3;
+			out[0] = result.x;
+			out[1] = result.y;
+			out[2] = result.z;
+		};
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float py = float(y) + 0.5f;
+			float* depthRow = frame.depth + size_t(y) * frame.width;
+			int x = minX;
+#if defined(__AVX2__)
+			const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+			const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 one = _mm256_set1_ps(1.0f);
+			__m256 rowE[3];
+			__m256 stepA[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				rowE[k] = _mm256_set1_ps(B[k] * py + C[k]);
+				stepA[k] = _mm256_set1_ps(A[k]);
+			}
+			__m256 rowZ = _mm256_set1_ps(zB * py + zC);
+			__m256 stepZ = _mm256_set1_ps(zA);
+			for (; x <= maxX; x += 8)
+			{
+				__m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), lanes);
+				__m256 e0 = _mm256_fmadd_ps(stepA[0], px, rowE[0]);
+				__m256 e1 = _mm256_fmadd_ps(stepA[1], px, rowE[1]);
+				__m256 e2 = _mm256_fmadd_ps(stepA[2], px, rowE[2]);
+				__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+					_mm256_cmp_ps(e1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+				__m256i inRange = _mm256_cmpgt_epi32(_mm256_set1_epi32(maxX - x + 1), laneIndex);
+				inside = _mm256_and_ps(inside, _mm256_castsi256_ps(inRange));
+				if (_mm256_testz_ps(inside, inside))
+					continue;
+
+				__m256 z = _mm256_fmadd_ps(stepZ, px, rowZ);
+				__m256 stored = _mm256_maskload_ps(depthRow + x, _mm256_castps_si256(inside));
+				__m256 pass = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(z, stored, _CMP_LT_OQ),
+					_mm256_and_ps(_mm256_cmp_ps(z, zero, _CMP_GE_OQ), _mm256_cmp_ps(z, one, _CMP_LE_OQ))));
+				int mask = _mm256_movemask_ps(pass);
+				if (!mask)
+					continue;
+				_mm256_maskstore_ps(depthRow + x, _mm256_castps_si256(pass), z);
+
+				alignas(32) float b0[8], b1[8], b2[8];
+				_mm256_store_ps(b0, e0);
+				_mm256_store_ps(b1, e1);
+				_mm256_store_ps(b2, e2);
+				for (int lane = 0; lane < 8; ++lane)
+				{
+					if (mask & (1 << lane))
+					{
+						shade(x + lane, y, b0[lane], b1[lane], b2[lane]);
+						++shaded;
+					}
+				}
+			}
+#else
+			for (; x <= maxX; ++x)
+			{
+				float px = float(x) + 0.5f;
+				float e0 = A[0] * px + B[0] * py + C[0];
+				float e1 = A[1] * px + B[1] * py + C[1];
+				float e2 = A[2] * px + B[2] * py + C[2];
+				if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+					continue;
+				float z = zA * px + zB * py + zC;
+				if (!(z < depthRow[x]) || z < 0.0f || z > 1.0f)
+					continue;
+				depthRow[x] = z;
+				shade(x, y, e0, e1, e2);
+				++shaded;
+			}
+#endif
+		}
+	}
+
+	void URasterizeTile(const FrameState& frame, int tile)
+	{
+		int tileX = (tile % frame.tilesPerRow) * TILE_SIZE;
+		int tileY = (tile / frame.tilesPerRow) * TILE_SIZE;
+		int tileMaxX = std::min(tileX + TILE_SIZE, frame.width) - 1;
+		int tileMaxY = std::min(tileY + TILE_SIZE, frame.height) - 1;
+
+		size_t shaded = 0;
+		for (uint32_t index : (*frame.bins)[tile])
+		{
+			const RasterTriangle& t = (*frame.triangles)[index];
+			float minX = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+			float maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+			float minY = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+			float maxY = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+			// pixels whose centers can be inside
+			int x0 = std::max(tileX, int(std::ceil(minX - 0.5f)));
+			int x1 = std::min(tileMaxX, int(std::floor(maxX - 0.5f)));
+			int y0 = std::max(tileY, int(std::ceil(minY - 0.5f)));
+			int y1 = std::min(tileMaxY, int(std::floor(maxY - 0.5f)));
+			if (x0 <= x1 && y0 <= y1)
+				URasterizeTriangle(frame, t, x0, y0, x1, y1, shaded);
+		}
+		frame.pixels->fetch_add(shaded, std::memory_order_relaxed);
+	}
+
+	///////////////////////////////////////////////////
+	//	URenderFrame(ThreadPool&, const std::vector<RasterDraw>&, const glm::mat4&, FrameState&, RasterStats&)
+	//
+	//	Transform, bin and rasterize the draws into the
+	//	buffers of frame
+	///////////////////////////////////////////////////
+	void URenderFrame(ThreadPool& pool, const std::vector<RasterDraw>& draws, const glm::mat4& viewProjection,
+		FrameState& frame, RasterStats& stats)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// transform every draw on its own thread, then join them in draw order
+		std::vector<std::vector<RasterTriangle>> transformed(draws.size());
+		for (size_t i = 0; i < draws.size(); ++i)
+		{
+			pool.Submit([&, i] {
+				UTransformDraw(draws[i], uint32_t(i), viewProjection, frame.width, frame.height, transformed[i]);
+			});
+		}
+		pool.Wait();
+
+		std::vector<RasterTriangle> triangles;
+		size_t total = 0;
+		for (const auto& list : transformed)
+			total += list.size();
+		triangles.reserve(total);
+		for (const auto& list : transformed)
+			triangles.insert(triangles.end(), list.begin(), list.end());
+
+		// bin by bounding box; triangle order within a bin is draw order
+		frame.tilesPerRow = (frame.width + TILE_SIZE - 1) / TILE_SIZE;
+		int tileRows = (frame.height + TILE_SIZE - 1) / TILE_SIZE;
+		std::vector<std::vector<uint32_t>> bins(size_t(frame.tilesPerRow) * tileRows);
+		for (uint32_t i = 0; i < triangles.size(); ++i)
+		{
+			const RasterTriangle& t = triangles[i];
+			float minX = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+			float maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+			float minY = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+			float maxY = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+			if (maxX < 0.0f || maxY < 0.0f || minX >= float(frame.width) || minY >= float(frame.height))
+				continue;
+			int tx0 = std::max(0, int(minX) / TILE_SIZE);
+			int tx1 = std::min(frame.tilesPerRow - 1, int(maxX) / TILE_SIZE);
+			int ty0 = std::max(0, int(minY) / TILE_SIZE);
+			int ty1 = std::min(tileRows - 1, int(maxY) / TILE_SIZE);
+			for (int ty = ty0; ty <= ty1; ++ty)
+			{
+				for (int tx = tx0; tx <= tx1; ++tx)
+					bins[size_t(ty) * frame.tilesPerRow + tx].push_back(i);
+			}
+		}
+
+		std::atomic<size_t> pixels(0);
+		frame.triangles = &triangles;
+		frame.bins = &bins;
+		frame.draws = &draws;
+		frame.pixels = &pixels;
+		for (int tile = 0; tile < int(bins.size()); ++tile)
+		{
+			if (!bins[tile].empty())
+				pool.Submit([&frame, tile] { URasterizeTile(frame, tile); });
+		}
+		pool.Wait();
+
+		stats.triangles = triangles.size();
+		stats.pixels = pixels.load();
+		stats.threads = pool.ThreadCount();
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+void Rasterizer::RenderDepth(const std::vector<RasterDraw>& draws, RasterDepthMap& map)
+{
+	map.depth.assign(size_t(map.size) * map.size, 1.0f);
+
+	FrameState frame = {};
+	frame.width = map.size;
+	frame.height = map.size;
+	frame.depth = map.depth.data();
+	URenderFrame(pool, draws, map.lightSpace, frame, stats);
+}
+
+void Rasterizer::RenderColor(const std::vector<RasterDraw>& draws, const glm::mat4& viewProjection,
+	const RasterShading& shading, const glm::vec3& clearColor, Image& image)
+{
+	size_t pixelCount = size_t(image.width) * image.height;
+	std::vector<float> depth(pixelCount, 1.0f);
+	std::vector<float> color(pixelCount * 3);
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		color[i * 3] = clearColor.x;
+		color[i * 3 + 1] = clearColor.y;
+		color[i * 3 + 2] = clearColor.z;
+	}
+
+	FrameState frame = {};
+	frame.shading = &shading;
+	frame.width = image.width;
+	frame.height = image.height;
+	frame.depth = depth.data();
+	frame.color = color.data();
+	URenderFrame(pool, draws, viewProjection, frame, stats);
+
+	// to 8 bits as a GL_RGBA8 framebuffer rounds
+	image.channels = 3;
+	image.pixels.resize(pixelCount * 3);
+	for (size_t i = 0; i < pixelCount * 3; ++i)
+		image.pixels[i] = (unsigned char)(std::min(std::max(color[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+}
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// rasterizer.h
+// ========
+// tile based software rasterizer for hosts without a GPU
+//
+// Draws the same triangle data as the GL path (Meshes::GenerateTriangles)
+// and ports its shading: surface.frag's two light Phong with texture and
+// 3x3 PCF shadows, and light.frag's flat white for light objects.
+//
+// A frame runs in three steps on a thread pool: the draws are transformed
+// and clipped against the near plane in parallel, the triangles are binned
+// into 64x64 pixel tiles in draw order, then every tile is rasterized,
+// depth tested and shaded by one thread, so tiles need no locks and the
+// result is the same on any thread count. Edge functions and the depth
+// test run on eight pixels at a time with AVX2 when the compiler targets
+// it (/arch:AVX2), otherwise one at a time.
+//
+// Triangles are two sided and the depth test is GL_LESS, as in the GL path.
+// Shadow maps are rendered by the same rasterizer with glPolygonOffset's
+// bias, so both paths agree within the regression suite's tolerance.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "imageio.h"
+#include "meshdata.h"
+
+class ThreadPool;
+
+// One object to draw
+struct RasterDraw
+{
+	const MeshData* triangles;	// unindexed triangle list in the standard layout
+	glm::mat4 model;
+	const Image* texture;		// RGB, rows bottom to top as GL stores them; null for color
+	glm::vec2 uvScale;
+	glm::vec3 color;			// base color without a texture
+	bool unlit;					// base color only, as light objects and unlit variants
+	bool specular;
+};
+
+// Depth seen from a light, for shadow lookups
+struct RasterDepthMap
+{
+	int size = 0;
+	glm::mat4 lightSpace;		// projection * view of the light
+	std::vector<float> depth;	// window depth in [0, 1], rows top to bottom
+};
+
+struct RasterLight
+{
+	glm::vec3 position;
+	glm::vec3 color;
+	const RasterDepthMap* shadowMap;	// null: never shadowed
+};
+
+// The uniforms of surface.frag
+struct RasterShading
+{
+	glm::vec3 viewPosition;
+	glm::vec3 ambientColor;
+	float ambientStrength;
+	float specularIntensity;
+	float highlightSize;
+	float shadowBias = 0.0005f;
+	RasterLight lights[2];
+	int lightCount;
+};
+
+struct RasterStats
+{
+	size_t triangles = 0;		// after clipping, in the last frame
+	size_t pixels = 0;			// fragments that passed the depth test and were shaded
+	double milliseconds = 0.0;
+	unsigned threads = 0;
+};
+
+class Rasterizer
+{
+public:
+	explicit Rasterizer(ThreadPool& pool) : pool(pool) {}
+
+	// Depth of the draws seen through map.lightSpace into map.depth, at
+	// map.size on a side
+	void RenderDepth(const std::vector<RasterDraw>& draws, RasterDepthMap& map);
+
+	// Shade the draws into image, cleared to clearColor; image keeps its size
+	// and gets three channels
+	void RenderColor(const std::vector<RasterDraw>& draws, const glm::mat4& viewProjection,
+		const RasterShading& shading, const glm::vec3& clearColor, Image& image);
+
+	const RasterStats& GetStats() const { return stats; }
+
+private:
+	ThreadPool& pool;
+	RasterStats stats;
+};
@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// regression.cpp
+// ========
+// golden image and performance regression suite over fixed camera poses:
+// the comparisons and the suite file, with no GL calls. regressionrun.cpp
+// renders the poses.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "regression.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+#include "json.h"
+
+namespace
+{
+	// sRGB to CIE L*a*b* under D65
+	void ULab(const unsigned char* rgb, double lab[3])
+	{
+		struct LinearTable
+		{
+			double values[256];
+			LinearTable()
+			{
+				for (int i = 0; i < 256; ++i)
+				{
+					double c = i / 255.0;
+					values[i] = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+				}
+			}
+		};
+		static const LinearTable linear;
+
+		double r = linear.values[rgb[0]], g = linear.values[rgb[1]], b = linear.values[rgb[2]];
+		double xyz[3] = {
+			(0.4124 * r + 0.3576 * g + 0.1805 * b) / 0.95047,
+			(0.2126 * r + 0.7152 * g + 0.0722 * b),
+			(0.0193 * r + 0.1192 * g + 0.9505 * b) / 1.08883
+		};
+		for (double& t : xyz)
+			t = t > 0.008856 ? std::cbrt(t) : 7.787 * t + 16.0 / 116.0;
+
+		lab[0] = 116.0 * xyz[1] - 16.0;
+		lab[1] = 500.0 * (xyz[0] - xyz[1]);
+		lab[2] = 200.0 * (xyz[1] - xyz[2]);
+	}
+
+	bool UReadVec3(const JsonValue& json, const char* key, glm::vec3& value)
+	{
+		const JsonValue* member = json.Find(key);
+		if (!member || !member->IsArray() || member->Size() != 3)
+			return false;
+		for (int i = 0; i < 3; ++i)
+			value[i] = float((*member)[i].number);
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////
+//	CompareImages(const Image&, const Image&, double, double)
+//
+//	reference, actual: RGB images of the same size
+//	deltaE: largest CIE76 difference a pixel may have
+//	maxFailingFraction: share of pixels allowed above it
+//
+//	A difference of about 2.3 is just noticeable, so a
+//	few pixels of changed rasterization along edges
+//	pass while a visible change in shading does not
+///////////////////////////////////////////////////
+ImageComparison CompareImages(const Image& reference, const Image& actual, double deltaE, double maxFailingFraction)
+{
+	ImageComparison result;
+	if (reference.width != actual.width || reference.height != actual.height ||
+		reference.channels != 3 || actual.channels != 3)
+		return result;
+
+	result.diff.width = actual.width;
+	result.diff.height = actual.height;
+	result.diff.channels = 3;
+	result.diff.pixels.resize(actual.pixels.size());
+
+	size_t failing = 0;
+	size_t pixelCount = size_t(actual.width) * actual.height;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		const unsigned char* expected = &reference.pixels[i * 3];
+		const unsigned char* got = &actual.pixels[i * 3];
+		unsigned char* out = &result.diff.pixels[i * 3];
+
+		double labExpected[3], labGot[3];
+		ULab(expected, labExpected);
+		ULab(got, labGot);
+		double difference = std::sqrt((labExpected[0] - labGot[0]) * (labExpected[0] - labGot[0]) +
+			(labExpected[1] - labGot[1]) * (labExpected[1] - labGot[1]) +
+			(labExpected[2] - labGot[2]) * (labExpected[2] - labGot[2]));
+		result.maxDeltaE = std::max(result.maxDeltaE, difference);
+
+		// dimmed reference underneath, so the differences are easy to place
+		unsigned char gray = uint8_t(labExpected[0] * 0.8);
+		out[0] = out[1] = out[2] = gray;
+		if (difference > deltaE)
+		{
+			++failing;
+			out[0] = uint8_t(std::min(255.0, 128.0 + difference * 8.0));
+			out[1] = out[2] = 0;
+		}
+		else if (difference > 0.0)
+			out[2] = uint8_t(std::min(255.0, gray + 64.0 + difference * 32.0));
+	}
+
+	result.failingFraction = pixelCount ? double(failing) / double(pixelCount) : 0.0;
+	result.passed = result.failingFraction <= maxFailingFraction;
+	return result;
+}
+
+///////////////////////////////////////////////////
+//	Median(std::vector<double>)
+//
+//	values: samples, in any order; 0 when empty
+///////////////////////////////////////////////////
+double Median(std::vector<double> values)
+{
+	if (values.empty())
+		return 0.0;
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	return values.size() % 2 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+///////////////////////////////////////////////////
+//	CompareTimings(const std::vector<double>&, const std::vector<double>&, double, double)
+//
+//	baseline, current: frame time samples
+//	alpha: significance level of the test
+//	minChange: smallest relative change of the median
+//		worth reporting, so tiny but consistent
+//		differences do not fail a run
+//
+//	Frame times are skewed and have outliers, so a rank
+//	test is used instead of comparing means. The normal
+//	approximation with tie correction is accurate for
+//	the sample sizes a suite uses.
+///////////////////////////////////////////////////
+TimingComparison CompareTimings(const std::vector<double>& baseline, const std::vector<double>& current,
+	double alpha, double minChange)
+{
+	TimingComparison result;
+	result.baselineMedian = Median(baseline);
+	result.currentMedian = Median(current);
+	if (baseline.empty() || current.empty())
+		return result;
+	if (result.baselineMedian > 0.0)
+		result.change = result.currentMedian / result.baselineMedian - 1.0;
+
+	// rank all samples together, ties get the average of their ranks
+	std::vector<std::pair<double, int>> samples;
+	samples.reserve(baseline.size() + current.size());
+	for (double value : baseline)
+		samples.push_back(std::make_pair(value, 0));
+	for (double value : current)
+		samples.push_back(std::make_pair(value, 1));
+	std::sort(samples.begin(), samples.end());
+
+	double n1 = double(baseline.size()), n2 = double(current.size()), n = n1 + n2;
+	double baselineRanks = 0.0, tieTerm = 0.0;
+	for (size_t i = 0; i < samples.size(); )
+	{
+		size_t j = i;
+		while (j < samples.size() && samples[j].first == samples[i].first)
+			++j;
+		double rank = 0.5 * double(i + 1 + j);	// average of ranks i+1 .. j
+		double ties = double(j - i);
+		tieTerm += ties * ties * ties - ties;
+		for (size_t k = i; k < j; ++k)
+		{
+			if (samples[k].second == 0)
+				baselineRanks += rank;
+		}
+		i = j;
+	}
+
+	double u = baselineRanks - n1 * (n1 + 1.0) / 2.0;
+	double mean = n1 * n2 / 2.0;
+	double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+	if (variance <= 0.0)
+		return result;	// every sample is equal
+
+	double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+	result.pValue = std::erfc(std::max(z, 0.0) / std::sqrt(2.0));
+
+	bool significant = result.pValue < alpha;
+	result.slower = significant && result.change > minChange;
+	result.faster = significant && result.change < -minChange;
+	return result;
+}
+
+bool RegressionSuite::Load(const char* filename)
+{
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+	{
+		LOG_ERROR << "ERROR::REGRESSION::CANNOT_OPEN " << filename;
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	std::string text = buffer.str();
+
+	JsonValue document;
+	std::string error;
+	if (!ParseJson(text.data(), text.size(), document, &error))
+	{
+		LOG_ERROR << "ERROR::REGRESSION::BAD_JSON " << filename << ": " << error;
+		return false;
+	}
+
+	referenceDirectory = document.GetString("references", "resources/regression");
+	warmupFrames = document.GetInt("warmupFrames", warmupFrames);
+	frames = document.GetInt("frames", frames);
+	if (const JsonValue* image = document.Find("image"))
+	{
+		deltaE = image->GetNumber("deltaE", deltaE);
+		maxFailingPixels = image->GetNumber("maxFailingPixels", maxFailingPixels);
+	}
+	if (const JsonValue* timing = document.Find("timing"))
+	{
+		alpha = timing->GetNumber("alpha", alpha);
+		minChange = timing->GetNumber("minChange", minChange);
+	}
+	if (frames < 2 || warmupFrames < 0)
+	{
+		LOG_ERROR << "ERROR::REGRESSION::BAD_FRAME_COUNT";
+		return false;
+	}
+
+	const JsonValue* list = document.Find("poses");
+	if (!list || !list->IsArray() || list->Size() == 0)
+	{
+		LOG_ERROR << "ERROR::REGRESSION::NO_POSES";
+		return false;
+	}
+
+	poses.clear();
+	for (const JsonValue& json : list->items)
+	{
+		RegressionPose pose;
+		pose.name = json.GetString("name", "");
+		pose.fov = float(json.GetNumber("fov", 45.0));
+		if (pose.name.empty() || !UReadVec3(json, "position", pose.position) || !UReadVec3(json, "target", pose.target))
+		{
+			LOG_ERROR << "ERROR::REGRESSION::BAD_POSE " << pose.name;
+			return false;
+		}
+		poses.push_back(pose);
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// regression.h
+// ========
+// golden image and performance regression suite over fixed camera poses
+//
+// Every pose of the suite is rendered offscreen. The last frame is compared
+// with a reference image by per pixel CIE76 colour difference, and the frame
+// times are compared with stored baseline samples by a Mann-Whitney U test,
+// so noise does not fail a run but a real slowdown does. References and
+// baselines depend on the GPU and driver; create them on the machine that
+// runs the suite with --regress-update from a known good build.
+//
+// Suite file:
+// {
+//   "references": "resources/regression",
+//   "warmupFrames": 20, "frames": 100,
+//   "image": { "deltaE": 2.3, "maxFailingPixels": 0.001 },
+//   "timing": { "alpha": 0.01, "minChange": 0.05 },
+//   "poses": [ { "name": "front", "position": [0, 2, 2], "target": [0, 1, 0], "fov": 45 } ]
+// }
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "imageio.h"
+
+struct RegressionPose
+{
+	std::string name;
+	glm::vec3 position;
+	glm::vec3 target;
+	float fov;				// vertical field of view in degrees
+};
+
+// Result of comparing a rendered image with its reference
+struct ImageComparison
+{
+	bool passed = false;
+	double maxDeltaE = 0.0;
+	double failingFraction = 0.0;	// pixels whose difference exceeds the threshold
+	Image diff;						// gray reference, failing pixels red, small differences blue
+};
+
+// Compare two RGB images of the same size
+ImageComparison CompareImages(const Image& reference, const Image& actual, double deltaE, double maxFailingFraction);
+
+// Middle value of frame time samples
+double Median(std::vector<double> values);
+
+// Two sided Mann-Whitney U test of current against baseline samples
+struct TimingComparison
+{
+	double baselineMedian = 0.0;	// milliseconds
+	double currentMedian = 0.0;
+	double change = 0.0;			// relative change of the median, +0.1 is 10% slower
+	double pValue = 1.0;
+	bool slower = false;			// significant and larger than the minimum change
+	bool faster = false;
+};
+
+TimingComparison CompareTimings(const std::vector<double>& baseline, const std::vector<double>& current,
+	double alpha, double minChange);
+
+class RegressionSuite
+{
+public:
+	// Draws the scene from a pose into the bound framebuffer
+	typedef void (*PoseRenderer)(const RegressionPose& pose);
+
+	bool Load(const char* filename);
+
+	// Render every pose into a width x height target and check it. With
+	// update the results become the new references and baselines instead.
+	// Actual and diff images go to outputDirectory. Returns true when all
+	// checks passed.
+	bool Run(PoseRenderer render, int width, int height, const std::string& outputDirectory, bool update);
+
+	const std::vector<RegressionPose>& GetPoses() const { return poses; }
+	const std::string& GetReferenceDirectory() const { return referenceDirectory; }
+
+private:
+	std::string referenceDirectory;
+	int warmupFrames = 20;
+	int frames = 100;
+	double deltaE = 2.3;				// one just noticeable difference
+	double maxFailingPixels = 0.001;
+	double alpha = 0.01;
+	double minChange = 0.05;
+	std::vector<RegressionPose> poses;
+};
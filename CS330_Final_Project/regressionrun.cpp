@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+// regressionrun.cpp
+// ========
+// renders the regression poses offscreen and checks them; the GL half of
+// regression.cpp, which the software renderer links alone
+///////////////////////////////////////////////////////////////////////////////
+
+#include "regression.h"
+#include "fileutils.h"
+#include "gpuresources.h"
+#include "json.h"
+#include "logging.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	bool UWriteTimings(const std::string& filename, const std::vector<double>& cpu, const std::vector<double>& gpu)
+	{
+		std::ofstream out(filename, std::ios::trunc);
+		if (!out)
+		{
+			LOG_ERROR << "ERROR::REGRESSION::CANNOT_CREATE " << filename;
+			return false;
+		}
+
+		out << std::setprecision(9);
+		const std::vector<double>* lists[2] = { &cpu, &gpu };
+		const char* names[2] = { "cpu", "gpu" };
+		out << "{\n";
+		for (int list = 0; list < 2; ++list)
+		{
+			out << "  \"" << names[list] << "\": [";
+			for (size_t i = 0; i < lists[list]->size(); ++i)
+				out << (i ? ", " : "") << (*lists[list])[i];
+			out << (list == 0 ? "],\n" : "]\n");
+		}
+		out << "}\n";
+		return bool(out);
+	}
+
+	bool UReadTimings(const std::string& filename, std::vector<double>& cpu, std::vector<double>& gpu)
+	{
+		std::ifstream in(filename, std::ios::binary);
+		if (!in)
+			return false;
+		std::stringstream buffer;
+		buffer << in.rdbuf();
+		std::string text = buffer.str();
+
+		JsonValue document;
+		std::string error;
+		if (!ParseJson(text.data(), text.size(), document, &error))
+		{
+			LOG_ERROR << "ERROR::REGRESSION::BAD_JSON " << filename << ": " << error;
+			return false;
+		}
+
+		std::vector<double>* lists[2] = { &cpu, &gpu };
+		const char* names[2] = { "cpu", "gpu" };
+		for (int list = 0; list < 2; ++list)
+		{
+			const JsonValue* samples = document.Find(names[list]);
+			if (!samples || !samples->IsArray())
+				return false;
+			lists[list]->clear();
+			for (const JsonValue& sample : samples->items)
+				lists[list]->push_back(sample.number);
+		}
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Run(PoseRenderer, int, int, const std::string&, bool)
+//
+//	render: draws one frame of a pose
+//	width, height: size of the offscreen target
+//	outputDirectory: receives <pose>.png, <pose>.diff.png
+//		and report.txt
+//	update: store the results as references instead
+//
+//	Every frame is finished before the next starts, so
+//	the CPU time covers the whole frame and the GPU
+//	time query result is ready without waiting
+///////////////////////////////////////////////////
+bool RegressionSuite::Run(PoseRenderer render, int width, int height, const std::string& outputDirectory, bool update)
+{
+	if (!MakeDirectories(outputDirectory) || (update && !MakeDirectories(referenceDirectory)))
+	{
+		LOG_ERROR << "ERROR::REGRESSION::CANNOT_CREATE_DIRECTORY";
+		return false;
+	}
+
+	GLuint fbo, names[2];
+	glCreateRenderbuffers(2, names);
+	GpuRenderbuffer colorBuffer(names[0], GpuCategory::RenderTarget, TextureBytes(GL_RGBA8, width, height, 1),
+		"regression color");
+	GpuRenderbuffer depthBuffer(names[1], GpuCategory::RenderTarget,
+		TextureBytes(GL_DEPTH_COMPONENT24, width, height, 1), "regression depth");
+	glNamedRenderbufferStorage(colorBuffer.Get(), GL_RGBA8, width, height);
+	glNamedRenderbufferStorage(depthBuffer.Get(), GL_DEPTH_COMPONENT24, width, height);
+
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer.Get());
+	glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer.Get());
+	bool complete = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	GLuint query;
+	glGenQueries(1, &query);
+
+	std::stringstream report;
+	int passed = 0, failed = 0;
+	for (const RegressionPose& pose : poses)
+	{
+		if (!complete)
+		{
+			LOG_ERROR << "ERROR::REGRESSION::FRAMEBUFFER_INCOMPLETE";
+			failed = int(poses.size());
+			break;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, width, height);
+
+		std::vector<double> cpu, gpu;
+		for (int frame = 0; frame < warmupFrames + frames; ++frame)
+		{
+			double start = SecondsNow();
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			render(pose);
+			glEndQuery(GL_TIME_ELAPSED);
+			glFinish();
+			double end = SecondsNow();
+
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			if (frame >= warmupFrames)
+			{
+				cpu.push_back((end - start) * 1000.0);
+				gpu.push_back(double(elapsed) / 1000000.0);
+			}
+		}
+
+		Image actual;
+		actual.width = width;
+		actual.height = height;
+		actual.channels = 3;
+		actual.pixels.resize(size_t(width) * height * 3);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, actual.pixels.data());
+		flipImageVertically(actual.pixels.data(), width, height, 3);
+		WritePng(JoinPath(outputDirectory, pose.name + ".png").c_str(), actual);
+
+		std::string referenceImage = JoinPath(referenceDirectory, pose.name + ".png");
+		std::string referenceTimings = JoinPath(referenceDirectory, pose.name + ".timing.json");
+		if (update)
+		{
+			bool written = WritePng(referenceImage.c_str(), actual) && UWriteTimings(referenceTimings, cpu, gpu);
+			report << (written ? "UPDATED " : "FAIL    ") << pose.name << ": gpu median " << Median(gpu)
+				<< " ms, cpu median " << Median(cpu) << " ms\n";
+			written ? ++passed : ++failed;
+			continue;
+		}
+
+		// image check
+		Image reference;
+		bool imagePassed = false;
+		if (!ReadImage(referenceImage.c_str(), reference, 3))
+			report << "FAIL    " << pose.name << " image: no reference, run with --regress-update\n";
+		else if (reference.width != width || reference.height != height)
+			report << "FAIL    " << pose.name << " image: reference is " << reference.width << "x" << reference.height << "\n";
+		else
+		{
+			ImageComparison comparison = CompareImages(reference, actual, deltaE, maxFailingPixels);
+			WritePng(JoinPath(outputDirectory, pose.name + ".diff.png").c_str(), comparison.diff);
+			imagePassed = comparison.passed;
+			report << (imagePassed ? "PASS    " : "FAIL    ") << pose.name << " image: " << comparison.failingFraction * 100.0
+				<< "% of pixels over deltaE " << deltaE << ", max deltaE " << comparison.maxDeltaE << "\n";
+		}
+
+		// timing check, on the GPU time and on the whole frame
+		std::vector<double> baselineCpu, baselineGpu;
+		bool timingPassed = false;
+		if (!UReadTimings(referenceTimings, baselineCpu, baselineGpu))
+			report << "FAIL    " << pose.name << " timing: no baseline, run with --regress-update\n";
+		else
+		{
+			timingPassed = true;
+			const char* labels[2] = { "gpu", "cpu" };
+			const std::vector<double>* baselines[2] = { &baselineGpu, &baselineCpu };
+			const std::vector<double>* currents[2] = { &gpu, &cpu };
+			for (int i = 0; i < 2; ++i)
+			{
+				TimingComparison comparison = CompareTimings(*baselines[i], *currents[i], alpha, minChange);
+				timingPassed = timingPassed && !comparison.slower;
+				report << (comparison.slower ? "FAIL    " : comparison.faster ? "FASTER  " : "PASS    ") << pose.name
+					<< " " << labels[i] << " time: median " << comparison.baselineMedian << " -> " << comparison.currentMedian
+					<< " ms (" << std::showpos << comparison.change * 100.0 << std::noshowpos << "%), p = " << comparison.pValue << "\n";
+			}
+		}
+
+		imagePassed && timingPassed ? ++passed : ++failed;
+	}
+
+	glDeleteQueries(1, &query);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+
+	report << "Regression suite: " << passed << " poses passed, " << failed << " failed\n";
+	LOG_INFO << report.str();
+	std::ofstream reportFile(JoinPath(outputDirectory, "report.txt"), std::ios::trunc);
+	reportFile << report.str();
+
+	return failed == 0;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = vec4(1.0); // set all 4 vector values to 1.0
+}
@@ -0,0 +1,27 @@
+#version 440 core
+
+// with VIEW_COUNT defined, instance i draws into viewport i with the matrices of view i
+#ifdef VIEW_COUNT
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
+layout(location = 0) in vec3 aPos;
+
+uniform mat4 model;
+#ifdef VIEW_COUNT
+uniform mat4 views[VIEW_COUNT];
+uniform mat4 projections[VIEW_COUNT];
+#else
+uniform mat4 view;
+uniform mat4 projection;
+#endif
+
+void main()
+{
+#ifdef VIEW_COUNT
+	mat4 view = views[gl_InstanceID];
+	mat4 projection = projections[gl_InstanceID];
+	gl_ViewportIndex = gl_InstanceID;
+#endif
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
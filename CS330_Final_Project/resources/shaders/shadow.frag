@@ -0,0 +1,6 @@
+#version 440 core
+
+void main()
+{
+	// only depth is written
+}
@@ -0,0 +1,11 @@
+#version 440 core
+
+layout(location = 0) in vec3 vertexPosition;
+
+uniform mat4 model;
+uniform mat4 lightSpace; // projection * view of the light
+
+void main()
+{
+	gl_Position = lightSpace * model * vec4(vertexPosition, 1.0f);
+}
@@ -0,0 +1,127 @@
+#version 440 core
+
+// Variants are compiled with a preamble from ShaderFeatures::Defines; without
+// one this is the full lit, textured, specular shader
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 2
+#define TEXTURED
+#define SPECULAR
+#endif
+
+in vec3 vertexFragmentNormal; // For incoming normals
+in vec3 vertexFragmentPos; // For incoming fragment position
+in vec2 vertexTextureCoordinate;
+in vec4 vertexLight1Pos;
+in vec4 vertexLight2Pos;
+in vec2 vertexLightmapCoordinate;
+
+out vec4 fragmentColor; // For outgoing cube color to the GPU
+
+// Uniform / Global variables for object color, light color, light position, and camera/view position
+uniform vec3 objectColor; // Base color of untextured variants
+uniform vec3 ambientColor;
+uniform vec3 light1Color;
+uniform vec3 light1Position;
+uniform vec3 light2Color;
+uniform vec3 light2Position;
+#ifdef VIEW_COUNT
+flat in vec3 vertexViewPosition; // each view has its own camera
+#define viewPosition vertexViewPosition
+#else
+uniform vec3 viewPosition;
+#endif
+layout(binding = 0) uniform sampler2D uTexture; // Texture units are fixed here so a reloaded program needs no setup
+uniform vec2 uvScale;
+uniform float ambientStrength = 0.1f; // Set ambient or global lighting strength
+uniform float specularIntensity = 0.8f;
+uniform float highlightSize = 16.0f;
+layout(binding = 1) uniform sampler2DShadow shadowMap1; // Depth of the scene as seen from each light
+layout(binding = 2) uniform sampler2DShadow shadowMap2;
+uniform float shadowBias = 0.0005f;
+layout(binding = 3) uniform sampler2D lightmap; // Baked diffuse light in rgb, unshadowed fraction of the direct light in a
+
+// Fraction of a 3x3 texel neighbourhood that sees the light (percentage closer filtering)
+float ShadowFactor(sampler2DShadow shadowMap, vec4 lightSpacePos)
+{
+	vec3 projected = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+	if (projected.z > 1.0)
+		return 1.0;
+
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+	float visibility = 0.0;
+	for (int x = -1; x <= 1; ++x)
+	{
+		for (int y = -1; y <= 1; ++y)
+			visibility += texture(shadowMap, vec3(projected.xy + vec2(x, y) * texelSize, projected.z - shadowBias));
+	}
+	return visibility / 9.0;
+}
+
+// Specular highlight of one light
+vec3 Specular(vec3 norm, vec3 viewDir, vec3 lightPosition, vec3 lightColor)
+{
+	vec3 lightDirection = normalize(lightPosition - vertexFragmentPos);
+	vec3 reflectDir = reflect(-lightDirection, norm);// Calculate reflection vector
+	float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
+	return specularIntensity * specularComponent * lightColor;
+}
+
+// Phong lighting of one light: ambient plus the shadowed diffuse and specular components
+vec3 Phong(vec3 norm, vec3 viewDir, vec3 lightPosition, vec3 lightColor, float shadow)
+{
+	//Calculate Ambient lighting
+	vec3 ambient = ambientStrength * ambientColor; // Generate ambient light color
+
+	//**Calculate Diffuse lighting**
+	vec3 lightDirection = normalize(lightPosition - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
+	float impact = max(dot(norm, lightDirection), 0.0);// Calculate diffuse impact by generating dot product of normal and light
+	vec3 diffuse = impact * lightColor; // Generate diffuse light color
+
+#ifdef SPECULAR
+	//**Calculate Specular lighting**
+	vec3 specular = Specular(norm, viewDir, lightPosition, lightColor);
+	return ambient + shadow * (diffuse + specular);
+#else
+	return ambient + shadow * diffuse;
+#endif
+}
+
+void main()
+{
+	//Texture or the object color is used for all three components
+#ifdef TEXTURED
+	vec3 baseColor = texture(uTexture, vertexTextureCoordinate * uvScale).xyz;
+#else
+	vec3 baseColor = objectColor;
+#endif
+
+#if LIGHT_COUNT == 0
+	fragmentColor = vec4(baseColor, 1.0);
+#elif defined(LIGHTMAPPED)
+	// diffuse light and shadows come from the bake; only the view dependent
+	// highlights are computed, shadowed by the baked visibility
+	vec4 baked = texture(lightmap, vertexLightmapCoordinate);
+	vec3 result = (LIGHT_COUNT * ambientStrength * ambientColor + baked.rgb) * baseColor;
+#ifdef SPECULAR
+	vec3 norm = normalize(vertexFragmentNormal);
+	vec3 viewDir = normalize(viewPosition - vertexFragmentPos);
+	vec3 specular = Specular(norm, viewDir, light1Position, light1Color);
+#if LIGHT_COUNT > 1
+	specular += Specular(norm, viewDir, light2Position, light2Color);
+#endif
+	result += baked.a * specular * baseColor;
+#endif
+	fragmentColor = vec4(result, 1.0);
+#else
+	vec3 norm = normalize(vertexFragmentNormal); // Normalize vectors to 1 unit
+	vec3 viewDir = normalize(viewPosition - vertexFragmentPos); // Calculate view direction
+
+	//**Calculate phong result**
+	vec3 result = Phong(norm, viewDir, light1Position, light1Color, ShadowFactor(shadowMap1, vertexLight1Pos)) * baseColor;
+#if LIGHT_COUNT > 1
+	result += Phong(norm, viewDir, light2Position, light2Color, ShadowFactor(shadowMap2, vertexLight2Pos)) * baseColor;
+#endif
+
+	fragmentColor = vec4(result, 1.0); // Send lighting results to GPU
+#endif
+}
@@ -0,0 +1,79 @@
+#version 440 core
+
+// Variants are compiled with a preamble from ShaderFeatures::Defines; without
+// one this is the full lit, textured, specular shader
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 2
+#define TEXTURED
+#define SPECULAR
+#endif
+
+// VIEW_COUNT variants draw instance i into viewport i with the matrices of view i
+#ifdef VIEW_COUNT
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
+layout(location = 0) in vec3 vertexPosition; // VAP position 0 for vertex position data
+layout(location = 1) in vec3 vertexNormal; // VAP position 1 for normals
+layout(location = 2) in vec2 textureCoordinate;
+#ifdef LIGHTMAPPED
+layout(location = 7) in vec2 lightmapCoordinate; // texel of the baked lighting, unique per triangle
+#endif
+
+out vec3 vertexFragmentNormal; // For outgoing normals to fragment shader
+out vec3 vertexFragmentPos; // For outgoing color / pixels to fragment shader
+out vec2 vertexTextureCoordinate;
+out vec4 vertexLight1Pos; // Position in the clip space of each light's shadow map
+out vec4 vertexLight2Pos;
+out vec2 vertexLightmapCoordinate;
+#ifdef VIEW_COUNT
+flat out vec3 vertexViewPosition; // camera of the view the instance draws
+#endif
+
+//Uniform / Global variables for the  transform matrices
+uniform mat4 model;
+#ifdef VIEW_COUNT
+uniform mat4 views[VIEW_COUNT];
+uniform mat4 projections[VIEW_COUNT];
+uniform vec3 viewPositions[VIEW_COUNT];
+#else
+uniform mat4 view;
+uniform mat4 projection;
+#endif
+uniform mat4 light1Space;
+uniform mat4 light2Space;
+
+// the depth pre-pass computes the same position; both must round identically
+invariant gl_Position;
+
+void main()
+{
+#ifdef VIEW_COUNT
+	mat4 view = views[gl_InstanceID];
+	mat4 projection = projections[gl_InstanceID];
+	vertexViewPosition = viewPositions[gl_InstanceID];
+	gl_ViewportIndex = gl_InstanceID;
+#endif
+	gl_Position = projection * view * model * vec4(vertexPosition, 1.0f); // Transforms vertices into clip coordinates
+
+#if LIGHT_COUNT > 0
+	vertexFragmentPos = vec3(model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
+
+	vertexFragmentNormal = mat3(transpose(inverse(model))) * vertexNormal; // get normal vectors in world space only and exclude normal translation properties
+
+#endif
+#ifdef LIGHTMAPPED
+	// the shadows are baked, so the shadow maps are not needed
+	vertexLightmapCoordinate = lightmapCoordinate;
+#else
+#if LIGHT_COUNT > 0
+	vertexLight1Pos = light1Space * vec4(vertexFragmentPos, 1.0f);
+#endif
+#if LIGHT_COUNT > 1
+	vertexLight2Pos = light2Space * vec4(vertexFragmentPos, 1.0f);
+#endif
+#endif
+#ifdef TEXTURED
+	vertexTextureCoordinate = textureCoordinate;
+#endif
+}
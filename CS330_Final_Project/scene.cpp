@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// scene.cpp
+// ========
+// description of the objects and lights that make up the rendered scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "scene.h"
+
+#include <unordered_map>
+
+bool SceneObject::SameInstanceData(const SceneObject& other) const
+{
+	return mesh == other.mesh && textureId == other.textureId && scale == other.scale &&
+		rotationAngle == other.rotationAngle && rotationAxis == other.rotationAxis && position == other.position &&
+		uvScale == other.uvScale && color == other.color && isUnlit == other.isUnlit && hasSpecular == other.hasSpecular &&
+		isDynamic == other.isDynamic && isLight == other.isLight;
+}
+
+///////////////////////////////////////////////////
+//	Scene::ComputeCasterBounds(Meshes&, bool)
+//
+//	meshes: mesh storage that holds the object space bounds
+//	includeDynamic: also include objects that move every frame
+//
+//	Return the world space bounds of the shadow casting objects
+///////////////////////////////////////////////////
+Bounds Scene::ComputeCasterBounds(Meshes& meshes, bool includeDynamic) const
+{
+	Bounds bounds;
+	for (const SceneObject& object : objects)
+	{
+		if (object.isLight || (object.isDynamic && !includeDynamic))
+			continue;
+		bounds.Expand(meshes.GetMesh(object.mesh).bounds.Transformed(object.ModelMatrix()));
+	}
+	return bounds;
+}
+
+///////////////////////////////////////////////////
+//	Scene::Merge(const Scene&)
+//
+//	loaded: the scene as it was just read from disk
+//
+//	Update changed objects in place, drop removed ones
+//	and append new ones. Unchanged objects keep their
+//	index, so the shadow caches only redraw what moved
+///////////////////////////////////////////////////
+SceneChanges Scene::Merge(const Scene& loaded)
+{
+	SceneChanges changes;
+
+	// index the loaded objects by name; repeated names match in file order
+	std::unordered_multimap<std::string, size_t> byName;
+	for (size_t i = 0; i < loaded.objects.size(); ++i)
+		byName.emplace(loaded.objects[i].name, i);
+
+	std::vector<bool> matched(loaded.objects.size(), false);
+	std::vector<SceneObject> merged;
+	merged.reserve(loaded.objects.size());
+
+	for (SceneObject& object : objects)
+	{
+		size_t match = loaded.objects.size();
+		auto range = byName.equal_range(object.name);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (!matched[it->second] && it->second < match)
+				match = it->second;
+		}
+
+		if (match == loaded.objects.size())
+		{
+			++changes.removed;
+			continue;
+		}
+
+		matched[match] = true;
+		if (!object.SameInstanceData(loaded.objects[match]))
+		{
+			object = loaded.objects[match];
+			++changes.modified;
+		}
+		merged.push_back(object);
+	}
+
+	for (size_t i = 0; i < loaded.objects.size(); ++i)
+	{
+		if (!matched[i])
+		{
+			merged.push_back(loaded.objects[i]);
+			++changes.added;
+		}
+	}
+
+	objects.swap(merged);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		if (lights[i].position != loaded.lights[i].position || lights[i].color != loaded.lights[i].color)
+		{
+			lights[i] = loaded.lights[i];
+			changes.lightingChanged = true;
+		}
+	}
+	if (ambientColor != loaded.ambientColor || ambientStrength != loaded.ambientStrength ||
+		specularIntensity != loaded.specularIntensity || highlightSize != loaded.highlightSize)
+	{
+		ambientColor = loaded.ambientColor;
+		ambientStrength = loaded.ambientStrength;
+		specularIntensity = loaded.specularIntensity;
+		highlightSize = loaded.highlightSize;
+		changes.lightingChanged = true;
+	}
+	if (depthPrepass != loaded.depthPrepass || bakeLightmap != loaded.bakeLightmap ||
+		lightmapSettings.atlasSize != loaded.lightmapSettings.atlasSize ||
+		lightmapSettings.samples != loaded.lightmapSettings.samples ||
+		lightmapSettings.bounces != loaded.lightmapSettings.bounces)
+	{
+		depthPrepass = loaded.depthPrepass;
+		bakeLightmap = loaded.bakeLightmap;
+		lightmapSettings = loaded.lightmapSettings;
+		changes.settingsChanged = true;
+	}
+
+	return changes;
+}
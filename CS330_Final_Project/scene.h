@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// scene.h
+// ========
+// description of the objects and lights that make up the rendered scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <string>
+#include <vector>
+
+#include "lightmapper.h"
+#include "meshes.h"
+
+// One drawable instance of a built-in mesh
+struct SceneObject
+{
+	std::string name;
+	Meshes::MeshType mesh;
+	GLuint textureId;
+	glm::vec3 scale;
+	float rotationAngle;		// radians
+	glm::vec3 rotationAxis;
+	glm::vec3 position;
+	glm::vec2 uvScale;
+	glm::vec3 color;			// base color when there is no texture
+	bool isUnlit;				// drawn with its base color only, no lighting
+	bool hasSpecular;			// lit with specular highlights
+	bool isDynamic;				// moves every frame; kept out of the cached shadow maps
+	bool isLight;				// drawn unlit with the light program and casts no shadow
+	int lightmapMesh;			// copy of mesh with lightmap coords once baked, otherwise -1
+
+	// Model matrix: transformations are applied right-to-left order.
+	// Defined here so tools can build it without the GL parts of scene.cpp
+	glm::mat4 ModelMatrix() const
+	{
+		// 1. Scales the object
+		glm::mat4 scaleMatrix = glm::scale(scale);
+		// 2. Rotates shape
+		glm::mat4 rotation = glm::rotate(rotationAngle, rotationAxis);
+		// 3. translate shape
+		glm::mat4 translation = glm::translate(position);
+		return translation * rotation * scaleMatrix;
+	}
+
+	// True when every field that affects rendering is equal
+	bool SameInstanceData(const SceneObject& other) const;
+};
+
+// Point light used by the surface shader
+struct SceneLight
+{
+	glm::vec3 position;
+	glm::vec3 color;
+};
+
+// What a scene reload changed in the live scene
+struct SceneChanges
+{
+	int added = 0;
+	int removed = 0;
+	int modified = 0;
+	bool lightingChanged = false;
+	bool settingsChanged = false;
+
+	bool Any() const { return added || removed || modified || lightingChanged || settingsChanged; }
+};
+
+struct Scene
+{
+	std::vector<SceneObject> objects;
+	SceneLight lights[2];
+	glm::vec3 ambientColor;
+	float ambientStrength;
+	float specularIntensity;
+	float highlightSize;
+	// lay down depth for every opaque object first, so the lit pass shades
+	// each pixel once; pays off where objects overlap heavily
+	bool depthPrepass;
+	// bake the diffuse light of the static objects at startup instead of
+	// lighting them every frame
+	bool bakeLightmap;
+	LightmapSettings lightmapSettings;
+
+	// World space bounds of every shadow casting object
+	Bounds ComputeCasterBounds(Meshes& meshes, bool includeDynamic) const;
+
+	// Bring this scene in line with a freshly loaded one, touching only the
+	// objects that differ. Objects are matched by name.
+	SceneChanges Merge(const Scene& loaded);
+};
@@ -0,0 +1,309 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ========
+// loads the scene description from a JSON scene file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "scenefile.h"
+#include "logging.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	struct BuiltInMesh
+	{
+		const char* name;
+		Meshes::MeshType type;
+	};
+
+	const BuiltInMesh BUILT_IN_MESHES[] = {
+		{ "plane", Meshes::Plane },
+		{ "prism", Meshes::Prism },
+		{ "cube", Meshes::Cube },
+		{ "cylinder", Meshes::Cylinder },
+		{ "taperedCylinder", Meshes::TaperedCylinder },
+		{ "pyramid", Meshes::Pyramid },
+		{ "sphere", Meshes::Sphere },
+		{ "torus", Meshes::Torus },
+	};
+
+	// Read a [x, y, z] member, keeping fallback when it is missing
+	bool UReadVec3(const JsonValue& json, const char* key, glm::vec3& value)
+	{
+		const JsonValue* member = json.Find(key);
+		if (!member)
+			return true;
+		if (!member->IsArray() || member->Size() != 3)
+			return false;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (!(*member)[i].IsNumber())
+				return false;
+			value[i] = float((*member)[i].number);
+		}
+		return true;
+	}
+
+	bool UReadVec2(const JsonValue& json, const char* key, glm::vec2& value)
+	{
+		const JsonValue* member = json.Find(key);
+		if (!member)
+			return true;
+		if (!member->IsArray() || member->Size() != 2)
+			return false;
+		for (int i = 0; i < 2; ++i)
+		{
+			if (!(*member)[i].IsNumber())
+				return false;
+			value[i] = float((*member)[i].number);
+		}
+		return true;
+	}
+}
+
+SceneLoader::SceneLoader(TextureLoader loadTexture, MeshLoader loadMesh, MeshGenerator generateMesh)
+	: loadTexture(loadTexture), loadMesh(loadMesh), generateMesh(generateMesh)
+{
+}
+
+///////////////////////////////////////////////////
+//	Load(const char*, Scene&)
+//
+//	filename: path of the JSON scene file
+//	scene: receives the objects and lights
+//
+//	Parse and validate the whole file before scene
+//	is written, so a half saved file never reaches
+//	the renderer
+///////////////////////////////////////////////////
+bool SceneLoader::Load(const char* filename, Scene& scene)
+{
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+	{
+		LOG_ERROR << "ERROR::SCENE::CANNOT_OPEN " << filename;
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	std::string text = buffer.str();
+
+	JsonValue document;
+	std::string error;
+	if (!ParseJson(text.data(), text.size(), document, &error))
+	{
+		LOG_ERROR << "ERROR::SCENE::BAD_JSON " << filename << ": " << error;
+		return false;
+	}
+
+	// named textures and meshes the objects refer to
+	std::unordered_map<std::string, GLuint> textures;
+	if (const JsonValue* list = document.Find("textures"))
+	{
+		for (const auto& member : list->members)
+		{
+			GLuint textureId;
+			if (!member.second.IsString() || !UGetTexture(member.second.string, textureId))
+			{
+				LOG_ERROR << "ERROR::SCENE::BAD_TEXTURE " << member.first;
+				return false;
+			}
+			textures[member.first] = textureId;
+		}
+	}
+
+	std::unordered_map<std::string, Meshes::MeshType> namedMeshes;
+	for (const BuiltInMesh& builtIn : BUILT_IN_MESHES)
+		namedMeshes[builtIn.name] = builtIn.type;
+	if (const JsonValue* list = document.Find("meshes"))
+	{
+		for (const auto& member : list->members)
+		{
+			Meshes::MeshType mesh;
+			bool loaded = member.second.IsObject() ? UGenerateMesh(member.second, mesh) :
+				member.second.IsString() && UGetMesh(member.second.string, mesh);
+			if (!loaded)
+			{
+				LOG_ERROR << "ERROR::SCENE::BAD_MESH " << member.first;
+				return false;
+			}
+			namedMeshes[member.first] = mesh;
+		}
+	}
+
+	Scene loaded;
+	loaded.ambientColor = glm::vec3(0.3f);
+	loaded.ambientStrength = 0.2f;
+	loaded.specularIntensity = 1.0f;
+	loaded.highlightSize = 16.0f;
+	loaded.depthPrepass = document.GetBool("depthPrepass", false);
+	loaded.bakeLightmap = false;
+	if (const JsonValue* lightmap = document.Find("lightmap"))
+	{
+		LightmapSettings& settings = loaded.lightmapSettings;
+		settings.atlasSize = int(lightmap->GetNumber("size", settings.atlasSize));
+		settings.samples = int(lightmap->GetNumber("samples", settings.samples));
+		settings.bounces = int(lightmap->GetNumber("bounces", settings.bounces));
+		if (settings.atlasSize <= 0 || settings.samples < 0 || settings.bounces < 0)
+		{
+			LOG_ERROR << "ERROR::SCENE::BAD_LIGHTMAP";
+			return false;
+		}
+		loaded.bakeLightmap = true;
+	}
+
+	if (const JsonValue* ambient = document.Find("ambient"))
+	{
+		if (!UReadVec3(*ambient, "color", loaded.ambientColor))
+		{
+			LOG_ERROR << "ERROR::SCENE::BAD_AMBIENT";
+			return false;
+		}
+		loaded.ambientStrength = float(ambient->GetNumber("strength", loaded.ambientStrength));
+	}
+	if (const JsonValue* specular = document.Find("specular"))
+	{
+		loaded.specularIntensity = float(specular->GetNumber("intensity", loaded.specularIntensity));
+		loaded.highlightSize = float(specular->GetNumber("highlightSize", loaded.highlightSize));
+	}
+
+	const JsonValue* lights = document.Find("lights");
+	if (!lights || !lights->IsArray() || lights->Size() != 2)
+	{
+		LOG_ERROR << "ERROR::SCENE::NEEDS_TWO_LIGHTS";
+		return false;
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		loaded.lights[i] = { glm::vec3(0.0f), glm::vec3(1.0f) };
+		if (!UReadVec3((*lights)[i], "position", loaded.lights[i].position) ||
+			!UReadVec3((*lights)[i], "color", loaded.lights[i].color))
+		{
+			LOG_ERROR << "ERROR::SCENE::BAD_LIGHT " << i;
+			return false;
+		}
+	}
+
+	const JsonValue* objects = document.Find("objects");
+	if (!objects || !objects->IsArray())
+	{
+		LOG_ERROR << "ERROR::SCENE::NO_OBJECTS";
+		return false;
+	}
+
+	loaded.objects.reserve(objects->Size());
+	for (const JsonValue& json : objects->items)
+	{
+		SceneObject object;
+		object.name = json.GetString("name", "");
+		object.textureId = 0;
+		object.scale = glm::vec3(1.0f);
+		object.rotationAngle = 0.0f;
+		object.rotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+		object.position = glm::vec3(0.0f);
+		object.uvScale = glm::vec2(1.0f);
+		object.color = glm::vec3(1.0f);
+		object.isUnlit = json.GetBool("unlit", false);
+		object.hasSpecular = json.GetBool("specular", true);
+		object.isDynamic = json.GetBool("dynamic", false);
+		object.isLight = json.GetBool("light", false);
+		object.lightmapMesh = -1;
+
+		auto mesh = namedMeshes.find(json.GetString("mesh", ""));
+		if (mesh == namedMeshes.end())
+		{
+			LOG_ERROR << "ERROR::SCENE::UNKNOWN_MESH " << object.name;
+			return false;
+		}
+		object.mesh = mesh->second;
+
+		if (json.Find("texture"))
+		{
+			auto texture = textures.find(json.GetString("texture", ""));
+			if (texture == textures.end())
+			{
+				LOG_ERROR << "ERROR::SCENE::UNKNOWN_TEXTURE " << object.name;
+				return false;
+			}
+			object.textureId = texture->second;
+		}
+
+		bool ok = UReadVec3(json, "scale", object.scale) && UReadVec3(json, "position", object.position) &&
+			UReadVec2(json, "uvScale", object.uvScale) && UReadVec3(json, "color", object.color);
+		if (const JsonValue* rotation = json.Find("rotation"))
+		{
+			object.rotationAngle = float(rotation->GetNumber("angle", 0.0));
+			ok = ok && UReadVec3(*rotation, "axis", object.rotationAxis);
+		}
+		if (!ok)
+		{
+			LOG_ERROR << "ERROR::SCENE::BAD_TRANSFORM " << object.name;
+			return false;
+		}
+
+		loaded.objects.push_back(object);
+	}
+
+	scene = std::move(loaded);
+	return true;
+}
+
+bool SceneLoader::UGetTexture(const std::string& path, GLuint& textureId)
+{
+	auto cached = textureCache.find(path);
+	if (cached != textureCache.end())
+	{
+		textureId = cached->second;
+		return true;
+	}
+
+	if (!loadTexture(path.c_str(), textureId))
+		return false;
+	textureCache[path] = textureId;
+	return true;
+}
+
+bool SceneLoader::UGetMesh(const std::string& path, Meshes::MeshType& mesh)
+{
+	auto cached = meshCache.find(path);
+	if (cached == meshCache.end())
+	{
+		int id = loadMesh ? loadMesh(path.c_str()) : -1;
+		if (id < 0)
+			return false;
+		cached = meshCache.emplace(path, id).first;
+	}
+
+	mesh = Meshes::MeshType(cached->second);
+	return true;
+}
+
+// { "primitive": "sphere", "segments": 512, "rings": 256 }: a built-in shape
+// at another density, built on the GPU once per density
+bool SceneLoader::UGenerateMesh(const JsonValue& json, Meshes::MeshType& mesh)
+{
+	std::string primitive = json.GetString("primitive", "");
+	int segments = json.GetInt("segments", 0);
+	int rings = json.GetInt("rings", 0);
+	std::string key = primitive + ":" + std::to_string(segments) + "x" + std::to_string(rings);
+
+	auto cached = meshCache.find(key);
+	if (cached == meshCache.end())
+	{
+		const BuiltInMesh* builtIn = nullptr;
+		for (const BuiltInMesh& candidate : BUILT_IN_MESHES)
+		{
+			if (primitive == candidate.name)
+				builtIn = &candidate;
+		}
+		int id = builtIn && generateMesh ? generateMesh(builtIn->type, segments, rings) : -1;
+		if (id < 0)
+			return false;
+		cached = meshCache.emplace(key, id).first;
+	}
+
+	mesh = Meshes::MeshType(cached->second);
+	return true;
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ========
+// loads the scene description from a JSON scene file
+//
+// {
+//   "textures": { "wood": "resources/textures/wood.jpg" },
+//   "meshes": { "chair": "resources/meshes/chair.mesh" },
+//   "ambient": { "color": [0.3, 0.3, 0.3], "strength": 0.2 },
+//   "specular": { "intensity": 1.0, "highlightSize": 16.0 },
+//   "lights": [ { "position": [-2, 4, -0.5], "color": [0.4, 0.4, 0.4] } ],
+//   "objects": [
+//     { "name": "table", "mesh": "plane", "texture": "wood", "scale": [2, 1, 1],
+//       "rotation": { "angle": 0.0, "axis": [1, 1, 1] }, "position": [0, 0, -1],
+//       "uvScale": [1, 1], "dynamic": false, "light": false }
+//   ]
+// }
+//
+// "mesh" is one of the built-in mesh names or a key of "meshes"; those are
+// .mesh files or models the importer can read, or a cylinder, tapered
+// cylinder, sphere or torus at any density, generated on the GPU:
+//   "meshes": { "bigSphere": { "primitive": "sphere", "segments": 1024, "rings": 512 } }
+// Angles are in radians.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "json.h"
+#include "meshes.h"
+#include "scene.h"
+
+class SceneLoader
+{
+public:
+	// Loads one texture, with the signature of UCreateTexture
+	typedef bool (*TextureLoader)(const char* filename, GLuint& textureId);
+	// Loads a .mesh file or imports a model; returns its mesh id or -1
+	typedef int (*MeshLoader)(const char* filename);
+	// Builds a built-in shape at another density, as Meshes::GenerateMesh;
+	// returns its mesh id or -1
+	typedef int (*MeshGenerator)(Meshes::MeshType type, int segments, int rings);
+
+	// A null mesh loader or generator fails the scenes that need it, for
+	// callers with no GL context
+	SceneLoader(TextureLoader loadTexture, MeshLoader loadMesh, MeshGenerator generateMesh);
+
+	// Read a scene file into scene. Textures and meshes are loaded the first
+	// time a path is seen and reused by later loads, so a reload only pays for
+	// what is new. On failure scene is left untouched.
+	bool Load(const char* filename, Scene& scene);
+
+private:
+	TextureLoader loadTexture;
+	MeshLoader loadMesh;
+	MeshGenerator generateMesh;
+	std::unordered_map<std::string, GLuint> textureCache;	// by file path
+	std::unordered_map<std::string, int> meshCache;			// by file path or primitive density
+
+	bool UGetTexture(const std::string& path, GLuint& textureId);
+	bool UGetMesh(const std::string& path, Meshes::MeshType& mesh);
+	bool UGenerateMesh(const JsonValue& json, Meshes::MeshType& mesh);
+};
@@ -0,0 +1,471 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaders.cpp
+// ========
+// shader programs loaded from GLSL files and recompiled when they are saved
+///////////////////////////////////////////////////////////////////////////////
+
+#include "shaders.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	bool UReadFile(const std::string& path, std::string& text)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in)
+			return false;
+		std::stringstream buffer;
+		buffer << in.rdbuf();
+		text = buffer.str();
+		return true;
+	}
+
+	// Insert defines after the #version line, which must stay first; #line
+	// keeps the line numbers of compile errors those of the file
+	void UInsertDefines(std::string& source, const std::string& defines)
+	{
+		if (defines.empty())
+			return;
+		size_t position = 0;
+		if (source.compare(0, 8, "#version") == 0)
+		{
+			position = source.find('\n');
+			position = position == std::string::npos ? source.size() : position + 1;
+		}
+		source.insert(position, defines + (position ? "#line 2\n" : "#line 1\n"));
+	}
+
+	///////////////////////////////////////////////////
+	//	UStartProgram(const std::string&, const std::string&, const std::string&, std::string&)
+	//
+	//	vertexPath, fragmentPath: GLSL source files
+	//	defines: preamble of #define lines for both stages
+	//	log: receives the error when a file is missing
+	//
+	//	Queue compiling and linking without asking for
+	//	the result, so a parallel compiler can work on it
+	//	in the background. Returns an empty handle if a
+	//	file is missing
+	///////////////////////////////////////////////////
+	GpuProgram UStartProgram(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines,
+		std::string& log)
+	{
+		std::string sources[2];
+		const std::string* paths[2] = { &vertexPath, &fragmentPath };
+		const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		for (int i = 0; i < 2; ++i)
+		{
+			if (!UReadFile(*paths[i], sources[i]))
+			{
+				log = "ERROR::SHADER::CANNOT_OPEN " + *paths[i] + "\n";
+				return GpuProgram();
+			}
+			UInsertDefines(sources[i], defines);
+		}
+
+		GLuint programId = glCreateProgram();
+		for (int i = 0; i < 2; ++i)
+		{
+			GLuint shaderId = glCreateShader(types[i]);
+			const char* source = sources[i].c_str();
+			glShaderSource(shaderId, 1, &source, NULL);
+			glCompileShader(shaderId);
+			glAttachShader(programId, shaderId);
+		}
+		glLinkProgram(programId);
+		// the size is known once it has linked
+		return GpuProgram(programId, GpuCategory::Shader, 0, (vertexPath + ", " + fragmentPath).c_str());
+	}
+
+	// Driver's binary of a linked program, as an estimate of its memory
+	size_t UProgramBytes(GLuint programId)
+	{
+		GLint length = 0;
+		glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+		return size_t(length);
+	}
+
+	///////////////////////////////////////////////////
+	//	UFinishProgram(GLuint, const std::string&, const std::string&, std::string&)
+	//
+	//	programId: program from UStartProgram
+	//	vertexPath, fragmentPath: source files, for the messages
+	//	log: receives the compile and link errors
+	//
+	//	Collect the results, waiting if the compiler is
+	//	not done, and release the shader objects.
+	//	Returns true when the program linked
+	///////////////////////////////////////////////////
+	bool UFinishProgram(GLuint programId, const std::string& vertexPath, const std::string& fragmentPath, std::string& log)
+	{
+		int success = 0;
+		char infoLog[1024];
+
+		GLuint shaders[2];
+		GLsizei count = 0;
+		glGetAttachedShaders(programId, 2, &count, shaders);
+		for (GLsizei i = 0; i < count; ++i)
+		{
+			glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				GLint type = 0;
+				glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+				glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+				if (type == GL_VERTEX_SHADER)
+					log += "ERROR::SHADER::VERTEX::COMPILATION_FAILED " + vertexPath + "\n" + infoLog + "\n";
+				else
+					log += "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED " + fragmentPath + "\n" + infoLog + "\n";
+			}
+			glDetachShader(programId, shaders[i]);
+			glDeleteShader(shaders[i]);
+		}
+
+		glGetProgramiv(programId, GL_LINK_STATUS, &success);
+		if (!success && log.empty())
+		{
+			glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
+			log += "ERROR::SHADER::PROGRAM::LINKING_FAILED " + vertexPath + ", " + fragmentPath + "\n" + infoLog + "\n";
+		}
+		return success != 0;
+	}
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	UStopWorker();
+}
+
+///////////////////////////////////////////////////
+//	Initialize(GLFWwindow*)
+//
+//	window: the render window, its context current
+//
+//	Prefer the driver's parallel compiler; without
+//	it start a worker on a hidden window whose
+//	context shares programs with the render context
+///////////////////////////////////////////////////
+void ShaderLibrary::Initialize(GLFWwindow* window)
+{
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);	// as many threads as the driver likes
+		mode = ParallelExtension;
+		LOG_INFO << "INFO: Shader reloads compile on driver threads";
+		return;
+	}
+	if (GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		mode = ParallelExtension;
+		LOG_INFO << "INFO: Shader reloads compile on driver threads";
+		return;
+	}
+
+	// the context version hints from window creation are still set
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	compileContext = glfwCreateWindow(1, 1, "Shader compiler", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (compileContext == NULL)
+	{
+		LOG_ERROR << "ERROR::SHADER::NO_SHARED_CONTEXT shader reloads will stall a frame";
+		mode = Blocking;
+		return;
+	}
+
+	mode = SharedContext;
+	stopping = false;
+	worker = std::thread(&ShaderLibrary::UCompileLoop, this);
+	LOG_INFO << "INFO: Shader reloads compile on a shared context";
+}
+
+void ShaderLibrary::Destroy()
+{
+	UStopWorker();
+	if (compileContext)
+	{
+		glfwDestroyWindow(compileContext);
+		compileContext = nullptr;
+	}
+
+	results.clear();
+	jobs.clear();
+
+	for (Program& program : programs)
+		*program.target = 0;
+	programs.clear();
+}
+
+///////////////////////////////////////////////////
+//	AddProgram(const char*, const char*, GLuint&, const std::string&)
+//
+//	vertexPath, fragmentPath: GLSL source files
+//	programId: receives the program, now and after
+//		every successful reload
+//	defines: #define lines for this program, one
+//		per line
+//
+//	The first compile blocks, since there is nothing
+//	to draw with until it is done
+///////////////////////////////////////////////////
+bool ShaderLibrary::AddProgram(const char* vertexPath, const char* fragmentPath, GLuint& programId,
+	const std::string& defines)
+{
+	std::string log;
+	GpuProgram compiled = UStartProgram(vertexPath, fragmentPath, defines, log);
+	if (!compiled)
+	{
+		LOG_ERROR << log;
+		return false;
+	}
+	if (!UFinishProgram(compiled.Get(), vertexPath, fragmentPath, log))
+	{
+		LOG_ERROR << log;
+		return false;
+	}
+
+	compiled.SetBytes(UProgramBytes(compiled.Get()));
+	programId = compiled.Get();
+	Program program;
+	program.vertexPath = vertexPath;
+	program.fragmentPath = fragmentPath;
+	program.defines = defines;
+	program.target = &programId;
+	program.live = std::move(compiled);
+	program.generation = 0;
+	program.reloadStart = 0.0;
+
+	// variants share their files; watch each file once
+	bool watched[2] = { false, false };
+	for (const Program& other : programs)
+	{
+		watched[0] = watched[0] || other.vertexPath == program.vertexPath || other.fragmentPath == program.vertexPath;
+		watched[1] = watched[1] || other.vertexPath == program.fragmentPath || other.fragmentPath == program.fragmentPath;
+	}
+	programs.push_back(std::move(program));
+
+	if (!watched[0])
+		watcher.Watch(vertexPath);
+	if (!watched[1])
+		watcher.Watch(fragmentPath);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Update()
+//
+//	Called on the render thread between frames, so
+//	a program id changes only while nothing is drawn
+///////////////////////////////////////////////////
+void ShaderLibrary::Update()
+{
+	std::vector<std::string> changed;
+	if (watcher.PollChanges(changed))
+	{
+		for (size_t i = 0; i < programs.size(); ++i)
+		{
+			const Program& program = programs[i];
+			if (std::find(changed.begin(), changed.end(), program.vertexPath) != changed.end() ||
+				std::find(changed.begin(), changed.end(), program.fragmentPath) != changed.end())
+				UStartReload(i);
+		}
+	}
+
+	if (mode == ParallelExtension)
+	{
+		for (Program& program : programs)
+		{
+			if (!program.pending)
+				continue;
+
+			GLint done = GL_FALSE;
+			glGetProgramiv(program.pending.Get(), GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+				continue;
+
+			GpuProgram compiled = std::move(program.pending);
+			std::string log;
+			bool linked = UFinishProgram(compiled.Get(), program.vertexPath, program.fragmentPath, log);
+			UFinishReload(program, std::move(compiled), linked, log);
+		}
+	}
+	else if (mode == SharedContext)
+	{
+		std::vector<CompileResult> finished;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished.swap(results);
+		}
+		for (CompileResult& result : finished)
+		{
+			Program& program = programs[result.program];
+			// a result whose file was saved again while it compiled is dropped
+			if (result.generation == program.generation)
+				UFinishReload(program, std::move(result.compiled), result.linked, result.log);
+		}
+	}
+}
+
+void ShaderLibrary::UStartReload(size_t index)
+{
+	Program& program = programs[index];
+	++program.generation;
+	program.reloadStart = glfwGetTime();
+
+	if (mode == SharedContext)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ index, program.generation, program.vertexPath, program.fragmentPath, program.defines });
+		wake.notify_one();
+		return;
+	}
+
+	// a compile still running is superseded by the newer save
+	program.pending.Reset();
+
+	std::string log;
+	GpuProgram compiled = UStartProgram(program.vertexPath, program.fragmentPath, program.defines, log);
+	if (!compiled)
+	{
+		UFinishReload(program, GpuProgram(), false, log);
+		return;
+	}
+
+	if (mode == ParallelExtension)
+	{
+		program.pending = std::move(compiled);
+		return;
+	}
+
+	bool linked = UFinishProgram(compiled.Get(), program.vertexPath, program.fragmentPath, log);
+	UFinishReload(program, std::move(compiled), linked, log);
+}
+
+// Publish a finished program, or report why it failed and keep the old one
+void ShaderLibrary::UFinishReload(Program& program, GpuProgram compiled, bool linked, const std::string& log)
+{
+	if (!linked)
+	{
+		LOG_ERROR << log << "Failed to reload shader " << program.vertexPath << ", " << program.fragmentPath
+			<< ", keeping the current program";
+		return;
+	}
+
+	// the old program is deleted here; one that is still bound is only
+	// flagged and goes away when unused
+	compiled.SetBytes(UProgramBytes(compiled.Get()));
+	program.live = std::move(compiled);
+	*program.target = program.live.Get();
+
+	LOG_INFO << "INFO: Reloaded shader " << program.vertexPath << ", " << program.fragmentPath << " in "
+		<< (glfwGetTime() - program.reloadStart) * 1000.0 << " ms";
+}
+
+// Worker thread: compile jobs on the shared context until stopped
+void ShaderLibrary::UCompileLoop()
+{
+	glfwMakeContextCurrent(compileContext);
+
+	for (;;)
+	{
+		CompileJob job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				break;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+
+			// skip a job when a newer save of the same program is already queued
+			bool superseded = false;
+			for (const CompileJob& queued : jobs)
+				superseded = superseded || queued.program == job.program;
+			if (superseded)
+				continue;
+		}
+
+		CompileResult result;
+		result.program = job.program;
+		result.generation = job.generation;
+		result.linked = false;
+		result.compiled = UStartProgram(job.vertexPath, job.fragmentPath, job.defines, result.log);
+		if (result.compiled)
+		{
+			result.linked = UFinishProgram(result.compiled.Get(), job.vertexPath, job.fragmentPath, result.log);
+			// the render context may use the program as soon as it sees it
+			glFinish();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results.push_back(std::move(result));
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+void ShaderLibrary::UStopWorker()
+{
+	if (!worker.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+///////////////////////////////////////////////////
+//	CompileComputeProgram(const char*)
+//
+//	path: GLSL compute shader file
+//
+//	Compute programs run once, when their results are
+//	built, so there is nothing to hot reload
+///////////////////////////////////////////////////
+GpuProgram CompileComputeProgram(const char* path)
+{
+	std::string source;
+	if (!UReadFile(path, source))
+	{
+		LOG_ERROR << "ERROR::SHADER::CANNOT_OPEN " << path;
+		return GpuProgram();
+	}
+
+	GLuint shaderId = glCreateShader(GL_COMPUTE_SHADER);
+	const char* text = source.c_str();
+	glShaderSource(shaderId, 1, &text, NULL);
+	glCompileShader(shaderId);
+
+	int success = 0;
+	char infoLog[1024];
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(shaderId, sizeof(infoLog), NULL, infoLog);
+		LOG_ERROR << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED " << path << "\n" << infoLog;
+		glDeleteShader(shaderId);
+		return GpuProgram();
+	}
+
+	GpuProgram program(glCreateProgram(), GpuCategory::Shader, 0, path);
+	glAttachShader(program.Get(), shaderId);
+	glLinkProgram(program.Get());
+	glDetachShader(program.Get(), shaderId);
+	glDeleteShader(shaderId);
+
+	glGetProgramiv(program.Get(), GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(program.Get(), sizeof(infoLog), NULL, infoLog);
+		LOG_ERROR << "ERROR::SHADER::PROGRAM::LINKING_FAILED " << path << "\n" << infoLog;
+		return GpuProgram();
+	}
+	program.SetBytes(UProgramBytes(program.Get()));
+	return program;
+}
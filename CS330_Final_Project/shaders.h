@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaders.h
+// ========
+// shader programs loaded from GLSL files and recompiled when they are saved
+//
+// A reload never stalls the render loop: with GL_KHR_parallel_shader_compile
+// the driver compiles on its own threads and completion is polled each frame;
+// otherwise a worker thread compiles on a second context that shares objects
+// with the window. The running program keeps drawing until its replacement
+// links, then the program id is swapped between frames. A program that fails
+// to compile is reported and dropped, leaving the old one in use.
+//
+// A program may carry a preamble of #defines, inserted after the #version
+// line of both files, so one pair of files yields several specialized
+// programs; a save reloads every program built from the file.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filewatcher.h"
+#include "gpuresources.h"
+
+class ShaderLibrary
+{
+public:
+	ShaderLibrary() = default;
+	~ShaderLibrary();
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	// Choose how reloads are compiled. Call with the window's context current.
+	void Initialize(GLFWwindow* window);
+	void Destroy();
+
+	// Compile and link a program right away and watch its files. programId
+	// must outlive the library; Update writes the new id into it on reload.
+	bool AddProgram(const char* vertexPath, const char* fragmentPath, GLuint& programId,
+		const std::string& defines = std::string());
+
+	// Once per frame, before drawing: start compiles for saved files and swap
+	// in the programs that finished. Never waits on the compiler.
+	void Update();
+
+private:
+	enum CompileMode
+	{
+		Blocking,			// no way to compile off the render thread
+		ParallelExtension,	// driver threads, polled with GL_COMPLETION_STATUS_KHR
+		SharedContext		// worker thread with its own shared context
+	};
+
+	struct Program
+	{
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::string defines;	// preamble after #version, may be empty
+		GLuint* target;			// where the live program id is published
+		GpuProgram live;		// owns the program in target
+		GpuProgram pending;		// ParallelExtension: program still compiling
+		int generation;			// bumped per reload, so stale results are dropped
+		double reloadStart;		// glfwGetTime() when the change was seen
+	};
+
+	struct CompileJob
+	{
+		size_t program;
+		int generation;
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::string defines;
+	};
+
+	struct CompileResult
+	{
+		size_t program;
+		int generation;
+		GpuProgram compiled;	// empty when the files could not be read
+		bool linked;
+		std::string log;
+	};
+
+	CompileMode mode = Blocking;
+	std::vector<Program> programs;
+	FileWatcher watcher;
+
+	// SharedContext worker
+	GLFWwindow* compileContext = nullptr;
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<CompileJob> jobs;
+	std::vector<CompileResult> results;
+	bool stopping = false;
+
+	void UStartReload(size_t index);
+	void UFinishReload(Program& program, GpuProgram compiled, bool linked, const std::string& log);
+	void UCompileLoop();
+	void UStopWorker();
+};
+
+// Compile and link a compute shader file, blocking; it is not watched for
+// saves. Returns an empty handle and logs the errors on failure.
+GpuProgram CompileComputeProgram(const char* path);
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.cpp
+// ========
+// specialized programs compiled from one shader for each feature combination
+///////////////////////////////////////////////////////////////////////////////
+
+#include "shadervariants.h"
+#include "logging.h"
+
+
+uint32_t ShaderFeatures::Key() const
+{
+	return uint32_t(lightCount) | (textured ? 0x100u : 0u) | (specular ? 0x200u : 0u) | (lightmapped ? 0x800u : 0u) |
+		(viewCount > 1 ? uint32_t(viewCount) << 12 : 0u);
+}
+
+std::string ShaderFeatures::Defines() const
+{
+	std::string defines = "#define LIGHT_COUNT " + std::to_string(lightCount) + "\n";
+	if (textured)
+		defines += "#define TEXTURED\n";
+	if (specular)
+		defines += "#define SPECULAR\n";
+	if (lightmapped)
+		defines += "#define LIGHTMAPPED\n";
+	if (viewCount > 1)
+		defines += "#define VIEW_COUNT " + std::to_string(viewCount) + "\n";
+	return defines;
+}
+
+void ShaderVariants::Initialize(ShaderLibrary& library, const char* vertexPath, const char* fragmentPath)
+{
+	this->library = &library;
+	this->vertexPath = vertexPath;
+	this->fragmentPath = fragmentPath;
+}
+
+///////////////////////////////////////////////////
+//	GetProgram(const ShaderFeatures&)
+//
+//	features: what the material needs
+//
+//	Look the variant up, compiling it when it is new.
+//	The first compile of a variant blocks, once
+///////////////////////////////////////////////////
+GLuint ShaderVariants::GetProgram(const ShaderFeatures& features)
+{
+	uint32_t key = features.Key();
+	auto found = programs.find(key);
+	if (found != programs.end())
+		return found->second;
+	if (failed.count(key))
+		return 0;
+
+	GLuint& programId = programs[key];
+	programId = 0;
+	if (features.lightCount < 0 || features.lightCount > MAX_LIGHTS ||
+		!library->AddProgram(vertexPath.c_str(), fragmentPath.c_str(), programId, features.Defines()))
+	{
+		LOG_ERROR << "ERROR::SHADER::VARIANT_FAILED " << vertexPath << ", " << fragmentPath << "\n" << features.Defines();
+		programs.erase(key);
+		failed.insert(key);
+		return 0;
+	}
+	return programId;
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.h
+// ========
+// specialized programs compiled from one shader for each feature combination
+//
+// A ShaderFeatures value names what a material needs: how many lights, a
+// texture or a flat color, specular highlights, baked light, several views
+// at once. It turns into a #define preamble, so the shader drops the work a
+// material does not need at compile time instead of branching on uniforms.
+// A combination is compiled the first time it is asked for and kept; all of
+// them reload together when the shader files are saved.
+//
+// There is no instanced variant: no draw used one, and the depth pre-pass
+// would need a matching instanced depth program for its GL_EQUAL test.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+#include "shaders.h"
+
+struct ShaderFeatures
+{
+	int lightCount = 2;			// 0 draws the base color unlit
+	bool textured = true;		// sample uTexture, otherwise use objectColor
+	bool specular = true;		// add specular highlights to each light
+	bool lightmapped = false;	// diffuse light baked into the lightmap, coords at location 7
+	int viewCount = 1;			// above 1: instance i draws view i (MultiView)
+
+	uint32_t Key() const;
+	std::string Defines() const;
+};
+
+class ShaderVariants
+{
+public:
+	static const int MAX_LIGHTS = 2;
+
+	// Variants compile into library from the given files
+	void Initialize(ShaderLibrary& library, const char* vertexPath, const char* fragmentPath);
+
+	// The program for features, compiled on first use. A variant that fails
+	// to compile is reported once and answered with 0 from then on.
+	GLuint GetProgram(const ShaderFeatures& features);
+
+	size_t Count() const { return programs.size(); }
+
+private:
+	ShaderLibrary* library = nullptr;
+	std::string vertexPath;
+	std::string fragmentPath;
+	// the library writes reloaded ids into these; map nodes never move
+	std::map<uint32_t, GLuint> programs;
+	std::set<uint32_t> failed;
+};
@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowfrustum.cpp
+// ========
+// fits the perspective frustum of a shadow casting light; plain math, shared
+// with the software renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "shadows.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////
+//	ComputeLightSpace(const Bounds&, const glm::vec3&)
+//
+//	Aim a perspective frustum from the light position
+//	so that it just encloses the casters
+///////////////////////////////////////////////////
+glm::mat4 ShadowMaps::ComputeLightSpace(const Bounds& casterBounds, const glm::vec3& position)
+{
+	glm::vec3 target = casterBounds.IsEmpty() ? glm::vec3(0.0f) : casterBounds.Center();
+	float radius = casterBounds.IsEmpty() ? 1.0f : glm::length(casterBounds.Extents());
+	glm::vec3 toTarget = target - position;
+	float distance = glm::length(toTarget);
+
+	// cone angle that encloses the bounding sphere of the casters
+	float halfAngle = asinf(std::min(radius / std::max(distance, 0.001f), 0.98f));
+	float nearPlane = std::max(distance - radius, 0.05f);
+	float farPlane = distance + radius;
+
+	glm::vec3 up = fabsf(toTarget.y) > 0.99f * distance ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 view = glm::lookAt(position, target, up);
+	glm::mat4 projection = glm::perspective(2.0f * halfAngle, 1.0f, nearPlane, farPlane);
+	return projection * view;
+}
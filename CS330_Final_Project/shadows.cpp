@@ -0,0 +1,371 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadows.cpp
+// ========
+// cached shadow maps for the two scene lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "shadows.h"
+#include "gpuresources.h"
+#include "logging.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Texels added around an invalidated region so the PCF kernel sees it too
+	const int DIRTY_PADDING = 2;
+
+	// Identifies the mesh and flags of a scene object
+	int UObjectKey(const SceneObject& object)
+	{
+		return (int(object.mesh) << 2) | (object.isDynamic ? 2 : 0) | (object.isLight ? 1 : 0);
+	}
+
+	bool UContains(const Bounds& outer, const Bounds& inner)
+	{
+		return inner.min.x >= outer.min.x && inner.min.y >= outer.min.y && inner.min.z >= outer.min.z &&
+			inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+	}
+}
+
+///////////////////////////////////////////////////
+//	CreateShadowMaps(GLsizei)
+//
+//	resolution: width and height of each shadow map
+//
+//	Create the static cache and composited depth
+//	targets for every light
+///////////////////////////////////////////////////
+void ShadowMaps::CreateShadowMaps(GLsizei resolution)
+{
+	this->resolution = resolution;
+
+	for (LightShadow& light : lights)
+	{
+		UCreateDepthTarget(light.staticTexture, light.staticFbo, "static shadow map");
+		UCreateDepthTarget(light.texture, light.fbo, "shadow map");
+		light.position = glm::vec3(0.0f);
+		light.lightSpace = glm::mat4(1.0f);
+		light.dirty = UFullRect();
+	}
+
+	cachedModels.clear();
+	cachedKeys.clear();
+	staticRedraws = 0;
+}
+
+///////////////////////////////////////////////////
+//	DestroyShadowMaps()
+//
+//	Release the depth textures and framebuffers
+///////////////////////////////////////////////////
+void ShadowMaps::DestroyShadowMaps()
+{
+	for (LightShadow& light : lights)
+	{
+		glDeleteFramebuffers(1, &light.staticFbo);
+		glDeleteFramebuffers(1, &light.fbo);
+		light.staticFbo = light.fbo = 0;
+		light.staticTexture.Reset();
+		light.texture.Reset();
+	}
+}
+
+///////////////////////////////////////////////////
+//	UpdateShadowMaps(const Scene&, Meshes&, GLuint)
+//
+//	scene: objects and lights to render shadows for
+//	meshes: mesh storage used to draw the objects
+//	depthProgramId: position only program with
+//		"lightSpace" and "model" uniforms
+//
+//	Invalidate the parts of the static caches touched
+//	by objects that moved since the last call, redraw
+//	only those parts, then composite dynamic casters
+///////////////////////////////////////////////////
+void ShadowMaps::UpdateShadowMaps(const Scene& scene, Meshes& meshes, GLuint depthProgramId)
+{
+	// Detect objects that were added, removed or changed mesh/flags, and a
+	// reloaded depth program that may write different depth
+	bool structureChanged = cachedKeys.size() != scene.objects.size() || cachedProgramId != depthProgramId;
+	cachedProgramId = depthProgramId;
+	for (size_t i = 0; !structureChanged && i < scene.objects.size(); ++i)
+		structureChanged = cachedKeys[i] != UObjectKey(scene.objects[i]);
+
+	if (structureChanged)
+	{
+		UInvalidateAll(scene, meshes);
+	}
+	else
+	{
+		// Invalidate the old and new footprint of every static caster that moved
+		for (size_t i = 0; i < scene.objects.size(); ++i)
+		{
+			const SceneObject& object = scene.objects[i];
+			if (object.isLight || object.isDynamic)
+				continue;
+
+			glm::mat4 model = object.ModelMatrix();
+			if (model == cachedModels[i])
+				continue;
+
+			const Bounds& meshBounds = meshes.GetMesh(object.mesh).bounds;
+			Bounds newBounds = meshBounds.Transformed(model);
+			if (!UContains(casterBounds, newBounds))
+			{
+				// the light frusta no longer enclose the casters, so refit them
+				UInvalidateAll(scene, meshes);
+				break;
+			}
+
+			UInvalidateRegion(meshBounds.Transformed(cachedModels[i]));
+			UInvalidateRegion(newBounds);
+			cachedModels[i] = model;
+		}
+	}
+
+	// A light that moved needs a new frustum and a full redraw
+	for (int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		if (lights[i].position != scene.lights[i].position)
+		{
+			UFitLightFrustum(lights[i], scene.lights[i].position);
+			lights[i].dirty = UFullRect();
+		}
+	}
+
+	bool drawn = false;
+	GLint viewport[4];
+	GLint framebuffer = 0;
+	GLint modelLoc = glGetUniformLocation(depthProgramId, "model");
+	GLint lightSpaceLoc = glGetUniformLocation(depthProgramId, "lightSpace");
+
+	for (LightShadow& light : lights)
+	{
+		bool redrawStatic = !light.dirty.IsEmpty();
+		if (!redrawStatic && !hasDynamicCasters)
+			continue;
+
+		if (!drawn)
+		{
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+			glViewport(0, 0, resolution, resolution);
+			glUseProgram(depthProgramId);
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(2.0f, 4.0f);
+			drawn = true;
+		}
+		glUniformMatrix4fv(lightSpaceLoc, 1, GL_FALSE, glm::value_ptr(light.lightSpace));
+
+		if (redrawStatic)
+		{
+			// Clear and redraw only the invalidated region of the cache
+			glBindFramebuffer(GL_FRAMEBUFFER, light.staticFbo);
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(light.dirty.x0, light.dirty.y0, light.dirty.x1 - light.dirty.x0, light.dirty.y1 - light.dirty.y0);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			URenderCasters(scene, meshes, modelLoc, light, light.dirty, false);
+			glDisable(GL_SCISSOR_TEST);
+
+			light.dirty = DirtyRect{ 0, 0, 0, 0 };
+			++staticRedraws;
+		}
+
+		if (hasDynamicCasters)
+		{
+			// Start from the cached static depth and draw the moving objects on top
+			glCopyImageSubData(light.staticTexture.Get(), GL_TEXTURE_2D, 0, 0, 0, 0,
+				light.texture.Get(), GL_TEXTURE_2D, 0, 0, 0, 0, resolution, resolution, 1);
+			glBindFramebuffer(GL_FRAMEBUFFER, light.fbo);
+			URenderCasters(scene, meshes, modelLoc, light, UFullRect(), true);
+		}
+	}
+
+	if (drawn)
+	{
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetShadowTexture(int)
+//
+//	light: index of the scene light
+//
+//	Return the depth texture the surface shader
+//	should sample for this light
+///////////////////////////////////////////////////
+GLuint ShadowMaps::GetShadowTexture(int light) const
+{
+	// without dynamic casters the static cache is the final result
+	return hasDynamicCasters ? lights[light].texture.Get() : lights[light].staticTexture.Get();
+}
+
+const glm::mat4& ShadowMaps::GetLightSpaceMatrix(int light) const
+{
+	return lights[light].lightSpace;
+}
+
+///////////////////////////////////////////////////
+//	UCreateDepthTarget(GpuTexture&, GLuint&, const char*)
+//
+//	Create a depth texture and a framebuffer that
+//	renders to it. The comparison state is in the
+//	shared ShadowCompare sampler of the shadow units
+///////////////////////////////////////////////////
+void ShadowMaps::UCreateDepthTarget(GpuTexture& texture, GLuint& fbo, const char* label)
+{
+	texture = CreateTexture2D(GpuCategory::RenderTarget, label, GL_DEPTH_COMPONENT24, resolution, resolution, 1);
+
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, texture.Get(), 0);
+	glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+	glNamedFramebufferReadBuffer(fbo, GL_NONE);
+
+	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		LOG_ERROR << "ERROR::SHADOWS::FRAMEBUFFER_INCOMPLETE";
+}
+
+// Fit the light's frustum to the static casters
+void ShadowMaps::UFitLightFrustum(LightShadow& light, const glm::vec3& position)
+{
+	light.position = position;
+	light.lightSpace = ComputeLightSpace(casterBounds, position);
+	light.frustum = Frustum::FromMatrix(light.lightSpace);
+}
+
+ShadowMaps::DirtyRect ShadowMaps::UFullRect() const
+{
+	return DirtyRect{ 0, 0, resolution, resolution };
+}
+
+///////////////////////////////////////////////////
+//	UProjectToShadowMap(const LightShadow&, const Bounds&)
+//
+//	Return the texel rectangle of the shadow map that
+//	a world space box can cover
+///////////////////////////////////////////////////
+ShadowMaps::DirtyRect ShadowMaps::UProjectToShadowMap(const LightShadow& light, const Bounds& bounds) const
+{
+	glm::vec2 ndcMin(FLT_MAX);
+	glm::vec2 ndcMax(-FLT_MAX);
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec3 point((corner & 1) ? bounds.max.x : bounds.min.x,
+			(corner & 2) ? bounds.max.y : bounds.min.y,
+			(corner & 4) ? bounds.max.z : bounds.min.z);
+		glm::vec4 clip = light.lightSpace * glm::vec4(point, 1.0f);
+
+		// a corner behind the light can project anywhere
+		if (clip.w <= 0.0001f)
+			return UFullRect();
+
+		glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	DirtyRect rect;
+	rect.x0 = std::max(0, int(floorf((ndcMin.x * 0.5f + 0.5f) * resolution)) - DIRTY_PADDING);
+	rect.y0 = std::max(0, int(floorf((ndcMin.y * 0.5f + 0.5f) * resolution)) - DIRTY_PADDING);
+	rect.x1 = std::min(int(resolution), int(ceilf((ndcMax.x * 0.5f + 0.5f) * resolution)) + DIRTY_PADDING);
+	rect.y1 = std::min(int(resolution), int(ceilf((ndcMax.y * 0.5f + 0.5f) * resolution)) + DIRTY_PADDING);
+	return rect;
+}
+
+///////////////////////////////////////////////////
+//	UInvalidateRegion(const Bounds&)
+//
+//	Grow the dirty region of every light whose
+//	frustum contains part of the world space box
+///////////////////////////////////////////////////
+void ShadowMaps::UInvalidateRegion(const Bounds& bounds)
+{
+	for (LightShadow& light : lights)
+	{
+		if (!light.frustum.Intersects(bounds))
+			continue;
+
+		DirtyRect rect = UProjectToShadowMap(light, bounds);
+		if (rect.IsEmpty())
+			continue;
+
+		if (light.dirty.IsEmpty())
+		{
+			light.dirty = rect;
+		}
+		else
+		{
+			light.dirty.x0 = std::min(light.dirty.x0, rect.x0);
+			light.dirty.y0 = std::min(light.dirty.y0, rect.y0);
+			light.dirty.x1 = std::max(light.dirty.x1, rect.x1);
+			light.dirty.y1 = std::max(light.dirty.y1, rect.y1);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	UInvalidateAll(const Scene&, Meshes&)
+//
+//	Re-snapshot the scene, refit every light frustum
+//	and mark every static cache for a full redraw
+///////////////////////////////////////////////////
+void ShadowMaps::UInvalidateAll(const Scene& scene, Meshes& meshes)
+{
+	cachedModels.resize(scene.objects.size());
+	cachedKeys.resize(scene.objects.size());
+	hasDynamicCasters = false;
+
+	for (size_t i = 0; i < scene.objects.size(); ++i)
+	{
+		const SceneObject& object = scene.objects[i];
+		cachedModels[i] = object.ModelMatrix();
+		cachedKeys[i] = UObjectKey(object);
+		hasDynamicCasters = hasDynamicCasters || (object.isDynamic && !object.isLight);
+	}
+
+	casterBounds = scene.ComputeCasterBounds(meshes, false);
+
+	for (int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		UFitLightFrustum(lights[i], scene.lights[i].position);
+		lights[i].dirty = UFullRect();
+	}
+}
+
+///////////////////////////////////////////////////
+//	URenderCasters(...)
+//
+//	Draw the static or dynamic casters that fall in
+//	the light frustum and overlap the given region
+///////////////////////////////////////////////////
+void ShadowMaps::URenderCasters(const Scene& scene, Meshes& meshes, GLint modelLoc, const LightShadow& light,
+	const DirtyRect& region, bool dynamicCasters)
+{
+	bool fullRegion = region.x0 == 0 && region.y0 == 0 && region.x1 == resolution && region.y1 == resolution;
+
+	for (const SceneObject& object : scene.objects)
+	{
+		if (object.isLight || object.isDynamic != dynamicCasters)
+			continue;
+
+		glm::mat4 model = object.ModelMatrix();
+		Bounds bounds = meshes.GetMesh(object.mesh).bounds.Transformed(model);
+		if (!light.frustum.Intersects(bounds))
+			continue;
+		if (!fullRegion && !UProjectToShadowMap(light, bounds).Overlaps(region))
+			continue;
+
+		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		meshes.DrawMesh(object.mesh);
+	}
+	glBindVertexArray(0);
+}
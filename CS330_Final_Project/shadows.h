@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadows.h
+// ========
+// cached shadow maps for the two scene lights
+//
+// Static casters are rendered into a cached depth map that is only redrawn
+// when the light moves or a static object inside its frustum moves, and then
+// only inside the shadow map region the object covered. Dynamic casters are
+// composited on top of a copy of the cache every frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "bounds.h"
+#include "gpuresources.h"
+#include "meshes.h"
+#include "scene.h"
+
+class ShadowMaps
+{
+public:
+	static const int NUM_LIGHTS = 2;
+
+	void CreateShadowMaps(GLsizei resolution);
+	void DestroyShadowMaps();
+
+	// Bring the shadow maps up to date with the scene. Restores the bound
+	// framebuffer and the viewport if anything was drawn.
+	void UpdateShadowMaps(const Scene& scene, Meshes& meshes, GLuint depthProgramId);
+
+	GLuint GetShadowTexture(int light) const;
+	const glm::mat4& GetLightSpaceMatrix(int light) const;
+
+	// Number of times a static cache was (partially) re-rendered
+	int GetStaticRedrawCount() const { return staticRedraws; }
+
+	// Projection * view of a perspective frustum from position that just
+	// encloses casterBounds
+	static glm::mat4 ComputeLightSpace(const Bounds& casterBounds, const glm::vec3& position);
+
+private:
+	// Region of a shadow map in texels, [x0, x1) x [y0, y1)
+	struct DirtyRect
+	{
+		int x0, y0, x1, y1;
+
+		bool IsEmpty() const { return x0 >= x1 || y0 >= y1; }
+		bool Overlaps(const DirtyRect& other) const
+		{
+			return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+		}
+	};
+
+	struct LightShadow
+	{
+		GpuTexture staticTexture;	// depth of the static casters, cached between frames
+		GLuint staticFbo = 0;
+		GpuTexture texture;		// cached depth with the dynamic casters drawn on top
+		GLuint fbo = 0;
+		glm::vec3 position;		// light position the cache was rendered from
+		glm::mat4 lightSpace;	// projection * view of the light
+		Frustum frustum;
+		DirtyRect dirty;		// region of the static cache that must be redrawn
+	};
+
+	LightShadow lights[NUM_LIGHTS];
+	GLsizei resolution = 0;
+	Bounds casterBounds;				// static caster bounds the light frusta were fitted to
+	std::vector<glm::mat4> cachedModels;	// last seen model matrices, indexed like Scene::objects
+	std::vector<int> cachedKeys;		// mesh and flags of each object, to detect scene edits
+	GLuint cachedProgramId = 0;			// depth program the caches were drawn with
+	bool hasDynamicCasters = false;
+	int staticRedraws = 0;
+
+	void UCreateDepthTarget(GpuTexture& texture, GLuint& fbo, const char* label);
+	void UFitLightFrustum(LightShadow& light, const glm::vec3& position);
+	DirtyRect UFullRect() const;
+	DirtyRect UProjectToShadowMap(const LightShadow& light, const Bounds& bounds) const;
+	void UInvalidateRegion(const Bounds& bounds);
+	void UInvalidateAll(const Scene& scene, Meshes& meshes);
+	void URenderCasters(const Scene& scene, Meshes& meshes, GLint modelLoc, const LightShadow& light,
+		const DirtyRect& region, bool dynamicCasters);
+};
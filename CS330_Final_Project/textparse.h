@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// textparse.h
+// ========
+// locale independent number parsing for the text file importers
+//
+// strtof/strtod honour the C locale (a German locale expects "1,5") and
+// are slow on the multi hundred megabyte files we import. These parse
+// plain ASCII numbers straight out of a buffer and advance the cursor.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+///////////////////////////////////////////////////
+//	ParseDouble(const char*&, const char*, double&)
+//
+//	cursor: first character of the number, advanced past it
+//	end: end of the buffer
+//	value: receives the parsed number
+//
+//	Parse [+-]digits[.digits][(e|E)[+-]digits]. Up to
+//	19 significant digits are kept, which is well past
+//	float precision. Returns false when there are no
+//	digits at the cursor
+///////////////////////////////////////////////////
+inline bool ParseDouble(const char*& cursor, const char* end, double& value)
+{
+	static const double powersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* p = cursor;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (p < end && unsigned(*p - '0') < 10)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + unsigned(*p - '0');
+			if (mantissa)
+				++digits;
+		}
+		else
+			++exponent;		// integer digits past the precision still scale the value
+		anyDigits = true;
+		++p;
+	}
+
+	if (p < end && *p == '.')
+	{
+		++p;
+		while (p < end && unsigned(*p - '0') < 10)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + unsigned(*p - '0');
+				if (mantissa)
+					++digits;
+				--exponent;
+			}
+			anyDigits = true;
+			++p;
+		}
+	}
+
+	if (!anyDigits)
+		return false;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			++e;
+		}
+		if (e < end && unsigned(*e - '0') < 10)
+		{
+			int explicitExponent = 0;
+			while (e < end && unsigned(*e - '0') < 10)
+			{
+				if (explicitExponent < 10000)
+					explicitExponent = explicitExponent * 10 + (*e - '0');
+				++e;
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			p = e;
+		}
+	}
+
+	// a zero mantissa is zero at any exponent, and leading fraction zeros
+	// leave that exponent unbounded
+	double result = double(mantissa);
+	if (mantissa != 0)
+	{
+		while (exponent > 22 && !std::isinf(result))
+		{
+			result *= 1e22;
+			exponent -= 22;
+		}
+		while (exponent < -22 && result != 0.0)
+		{
+			result /= 1e22;
+			exponent += 22;
+		}
+		// still out of the table's range: already overflowed or underflowed
+		if (exponent > 22)
+			result = HUGE_VAL;
+		else if (exponent < -22)
+			result = 0.0;
+		else if (exponent > 0)
+			result *= powersOf10[exponent];
+		else if (exponent < 0)
+			result /= powersOf10[-exponent];
+	}
+
+	value = negative ? -result : result;
+	cursor = p;
+	return true;
+}
+
+inline bool ParseFloat(const char*& cursor, const char* end, float& value)
+{
+	double result;
+	if (!ParseDouble(cursor, end, result))
+		return false;
+	value = float(result);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	ParseInt(const char*&, const char*, int&)
+//
+//	cursor: first character of the number, advanced past it
+//	end: end of the buffer
+//	value: receives the parsed number
+//
+//	Parse [+-]digits. Returns false when there are no
+//	digits at the cursor
+///////////////////////////////////////////////////
+inline bool ParseInt(const char*& cursor, const char* end, int& value)
+{
+	const char* p = cursor;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+	if (p == end || unsigned(*p - '0') >= 10)
+		return false;
+
+	int64_t result = 0;
+	while (p < end && unsigned(*p - '0') < 10)
+	{
+		if (result < INT32_MAX)
+			result = result * 10 + (*p - '0');
+		++p;
+	}
+	if (result > INT32_MAX)
+		result = INT32_MAX;
+
+	value = int(negative ? -result : result);
+	cursor = p;
+	return true;
+}
+
+// Skip spaces and tabs, but not line breaks
+inline void SkipBlanks(const char*& cursor, const char* end)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+		++cursor;
+}
@@ -0,0 +1,479 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreaming.cpp
+// ========
+// material textures whose mip levels are loaded on demand under a budget
+///////////////////////////////////////////////////////////////////////////////
+
+#include "texturestreaming.h"
+#include "imageio.h"
+#include "logging.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// levels this size and smaller are uploaded with the texture and stay
+	const GLsizei RESIDENT_SIZE = 64;
+	const unsigned LOADER_THREADS = 2;
+	const size_t MAX_LOADS_IN_FLIGHT = 4;
+	// a frame uploads at most this much, unless a single load is bigger
+	const size_t UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024;
+	// frames to wait before retrying a load the budget had no room for
+	const uint64_t RETRY_FRAMES = 60;
+
+	GLsizei ULevelSize(GLsizei size, GLsizei level)
+	{
+		return std::max(size >> level, 1);
+	}
+
+	double UMegabytes(size_t bytes)
+	{
+		return double(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+TextureStreamer::TextureStreamer() = default;
+
+TextureStreamer::~TextureStreamer() = default;
+
+void TextureStreamer::Create(size_t budgetBytes, bool fullResolution)
+{
+	this->budgetBytes = budgetBytes;
+	this->fullResolution = fullResolution;
+	stats = TextureStreamingStats();
+	stats.budgetBytes = budgetBytes;
+	if (!fullResolution)
+		loaders.reset(new ThreadPool(LOADER_THREADS));
+}
+
+void TextureStreamer::Destroy()
+{
+	if (loaders)
+	{
+		loaders->Wait();
+		loaders.reset();
+	}
+	results.clear();
+	loadsInFlight = 0;
+	textures.clear();
+	stats.residentBytes = 0;
+}
+
+///////////////////////////////////////////////////
+//	Add(const char*)
+//
+//	filename: image file of the texture
+//
+//	Decode the image once to learn its size and
+//	build the small mips; the rest is read again
+//	when a level is wanted. Returns the id, 0 when
+//	the image cannot be read. Every image is expanded
+//	to RGBA: 4 byte texels upload without conversion
+//	or unpack alignment concerns
+///////////////////////////////////////////////////
+unsigned TextureStreamer::Add(const char* filename)
+{
+	Image image;
+	if (!ReadImage(filename, image, 4))
+		return 0;
+	flipImageVertically(image.pixels.data(), image.width, image.height, image.channels);
+
+	textures.emplace_back();
+	StreamedTexture& texture = textures.back();
+	texture.filename = filename;
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.levelCount = MipLevelCount(image.width, image.height);
+	while (!fullResolution && texture.tailLevel + 1 < texture.levelCount &&
+		std::max(ULevelSize(texture.width, texture.tailLevel), ULevelSize(texture.height, texture.tailLevel)) > RESIDENT_SIZE)
+	{
+		++texture.tailLevel;
+	}
+	texture.wantedLevel = texture.tailLevel;
+
+	// every level at once, mipmapped by the GL as textures always were
+	if (fullResolution)
+	{
+		UReplaceTexture(texture, CreateTexture2D(GpuCategory::Texture, filename, GL_RGBA8, image.width, image.height,
+			texture.levelCount, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data()), 0);
+		return unsigned(textures.size());
+	}
+
+	Level base = { image.width, image.height, std::move(image.pixels) };
+	std::vector<Level> levels;
+	UBuildLevels(base, texture.tailLevel, texture.levelCount, levels);
+	UReplaceTexture(texture, UCreateTexture(texture.filename, levels), texture.tailLevel);
+	return unsigned(textures.size());
+}
+
+void TextureStreamer::Remove(unsigned id)
+{
+	StreamedTexture* texture = UFind(id);
+	if (!texture)
+		return;
+	stats.residentBytes -= texture->bytes;
+	// a load still running for the slot finds another generation
+	unsigned generation = texture->generation + 1;
+	*texture = StreamedTexture();
+	texture->generation = generation;
+}
+
+GLuint TextureStreamer::Use(unsigned id, float pixels, float uvRepeat)
+{
+	StreamedTexture* texture = UFind(id);
+	if (!texture)
+		return 0;
+
+	// about a texel per pixel: each level halves the texels across the object
+	GLsizei level = texture->tailLevel;
+	if (pixels > 0.0f)
+	{
+		float texels = float(std::max(texture->width, texture->height)) * uvRepeat;
+		float wanted = std::floor(std::log2(std::max(texels / pixels, 1.0f)));
+		level = std::min(GLsizei(wanted), texture->tailLevel);
+	}
+	texture->wantedLevel = std::min(texture->wantedLevel, level);
+	texture->lastUsedFrame = frame;
+	return texture->texture.Get();
+}
+
+GLuint TextureStreamer::GetTexture(unsigned id) const
+{
+	const StreamedTexture* texture = UFind(id);
+	return texture ? texture->texture.Get() : 0;
+}
+
+///////////////////////////////////////////////////
+//	Update()
+//
+//	Finished loads are swapped in first, so the
+//	loads started after them see what is resident.
+//	The wanted levels start over for the next frame
+///////////////////////////////////////////////////
+void TextureStreamer::Update()
+{
+	if (!fullResolution)
+	{
+		UInstallResults();
+		UStartLoads();
+	}
+
+	for (StreamedTexture& texture : textures)
+		texture.wantedLevel = texture.tailLevel;
+	++frame;
+}
+
+void TextureStreamer::Report(const char* label) const
+{
+	LOG_INFO << "INFO: " << label << ": " << stats.loads << " loads, " << stats.evictions << " evictions, "
+		<< stats.deniedLoads << " denied, " << UMegabytes(size_t(stats.uploadedBytes)) << " MB uploaded; "
+		<< UMegabytes(stats.residentBytes) << " MB resident, peak " << UMegabytes(stats.peakBytes) << " MB of a "
+		<< UMegabytes(stats.budgetBytes) << " MB budget";
+}
+
+///////////////////////////////////////////////////
+//	ULoadLevels(const std::string&, GLsizei, GLsizei, GLsizei, std::vector<Level>&)
+//
+//	filename: image file of the texture
+//	width, height: size it had when it was added
+//	firstLevel: finest level to return
+//	levels: receives firstLevel to the end of the chain
+//
+//	Runs on a loader thread. False when the file is
+//	gone or no longer the size it was
+///////////////////////////////////////////////////
+bool TextureStreamer::ULoadLevels(const std::string& filename, GLsizei width, GLsizei height, GLsizei firstLevel,
+	std::vector<Level>& levels)
+{
+	Image image;
+	if (!ReadImage(filename.c_str(), image, 4))
+		return false;
+	if (image.width != width || image.height != height)
+	{
+		LOG_ERROR << "ERROR::TEXTURE_STREAMING::SIZE_CHANGED " << filename;
+		return false;
+	}
+	flipImageVertically(image.pixels.data(), image.width, image.height, image.channels);
+
+	Level base = { image.width, image.height, std::move(image.pixels) };
+	UBuildLevels(base, firstLevel, MipLevelCount(width, height), levels);
+	return true;
+}
+
+// Halve base down to 1x1 with a 2x2 box filter, keeping firstLevel onward
+void TextureStreamer::UBuildLevels(Level& base, GLsizei firstLevel, GLsizei levelCount, std::vector<Level>& levels)
+{
+	levels.clear();
+	levels.reserve(size_t(levelCount - firstLevel));
+	if (firstLevel == 0)
+		levels.push_back(std::move(base));
+
+	Level current = firstLevel == 0 ? Level() : std::move(base);
+	const Level* source = firstLevel == 0 ? &levels.back() : &current;
+	for (GLsizei level = 1; level < levelCount; ++level)
+	{
+		Level next = { std::max(source->width / 2, 1), std::max(source->height / 2, 1), {} };
+		next.pixels.resize(size_t(next.width) * next.height * 4);
+		for (GLsizei y = 0; y < next.height; ++y)
+		{
+			const unsigned char* rows[2] = {
+				source->pixels.data() + size_t(std::min(2 * y, source->height - 1)) * source->width * 4,
+				source->pixels.data() + size_t(std::min(2 * y + 1, source->height - 1)) * source->width * 4,
+			};
+			unsigned char* out = next.pixels.data() + size_t(y) * next.width * 4;
+			for (GLsizei x = 0; x < next.width; ++x)
+			{
+				size_t left = size_t(std::min(2 * x, source->width - 1)) * 4;
+				size_t right = size_t(std::min(2 * x + 1, source->width - 1)) * 4;
+				for (int c = 0; c < 4; ++c)
+					out[x * 4 + c] = (unsigned char)((rows[0][left + c] + rows[0][right + c] + rows[1][left + c] + rows[1][right + c] + 2) / 4);
+			}
+		}
+
+		if (level >= firstLevel)
+		{
+			levels.push_back(std::move(next));
+			source = &levels.back();
+		}
+		else
+		{
+			current = std::move(next);
+			source = &current;
+		}
+	}
+}
+
+// Immutable texture holding levels, the first of them as its level 0
+GpuTexture TextureStreamer::UCreateTexture(const std::string& label, const std::vector<Level>& levels)
+{
+	GpuTexture texture = CreateTexture2D(GpuCategory::Texture, label.c_str(), GL_RGBA8, levels[0].width,
+		levels[0].height, GLsizei(levels.size()));
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		glTextureSubImage2D(texture.Get(), GLint(i), 0, 0, levels[i].width, levels[i].height, GL_RGBA,
+			GL_UNSIGNED_BYTE, levels[i].pixels.data());
+	}
+	return texture;
+}
+
+// Load the wanted levels of the textures drawn this frame, those missing the
+// most levels first
+void TextureStreamer::UStartLoads()
+{
+	order.clear();
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		const StreamedTexture& texture = textures[i];
+		if (!texture.filename.empty() && !texture.loading && texture.lastUsedFrame == frame &&
+			texture.wantedLevel < texture.residentLevel && texture.retryFrame <= frame)
+		{
+			order.push_back(i);
+		}
+	}
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return textures[a].residentLevel - textures[a].wantedLevel > textures[b].residentLevel - textures[b].wantedLevel;
+	});
+
+	for (size_t index : order)
+	{
+		if (loadsInFlight >= MAX_LOADS_IN_FLIGHT)
+			break;
+		StreamedTexture& texture = textures[index];
+		texture.loading = true;
+		++loadsInFlight;
+
+		LoadResult job = { index, texture.generation, texture.wantedLevel, {}, false };
+		std::string filename = texture.filename;
+		GLsizei width = texture.width, height = texture.height;
+		loaders->Submit([this, job, filename, width, height]() mutable {
+			job.ok = ULoadLevels(filename, width, height, job.firstLevel, job.levels);
+			std::lock_guard<std::mutex> lock(resultsMutex);
+			results.push_back(std::move(job));
+		});
+	}
+}
+
+///////////////////////////////////////////////////
+//	UInstallResults()
+//
+//	Swap in finished loads up to the upload limit of
+//	a frame; the rest wait for the next frames.
+//	Returns the bytes uploaded
+///////////////////////////////////////////////////
+size_t TextureStreamer::UInstallResults()
+{
+	std::vector<LoadResult> finished;
+	{
+		std::lock_guard<std::mutex> lock(resultsMutex);
+		finished.swap(results);
+	}
+
+	size_t uploaded = 0;
+	std::vector<LoadResult> deferred;
+	for (LoadResult& result : finished)
+	{
+		size_t bytes = 0;
+		for (const Level& level : result.levels)
+			bytes += level.pixels.size();
+		if (uploaded > 0 && uploaded + bytes > UPLOAD_BYTES_PER_FRAME)
+		{
+			deferred.push_back(std::move(result));
+			continue;
+		}
+
+		--loadsInFlight;
+		if (result.index >= textures.size() || textures[result.index].generation != result.generation)
+			continue;
+		StreamedTexture& texture = textures[result.index];
+		texture.loading = false;
+		if (UInstall(texture, result))
+			uploaded += bytes;
+	}
+
+	if (!deferred.empty())
+	{
+		std::lock_guard<std::mutex> lock(resultsMutex);
+		results.insert(results.begin(), std::make_move_iterator(deferred.begin()), std::make_move_iterator(deferred.end()));
+	}
+	return uploaded;
+}
+
+bool TextureStreamer::UInstall(StreamedTexture& texture, LoadResult& result)
+{
+	if (!result.ok)
+	{
+		texture.retryFrame = frame + RETRY_FRAMES;
+		return false;
+	}
+
+	// the view may have moved on while the levels loaded; a texture that was
+	// not drawn this frame only keeps what it had
+	GLsizei level = std::max(result.firstLevel, texture.lastUsedFrame == frame ? texture.wantedLevel : texture.residentLevel);
+	if (level >= texture.residentLevel)
+		return false;
+
+	size_t bytes = TextureBytes(GL_RGBA8, ULevelSize(texture.width, level), ULevelSize(texture.height, level),
+		texture.levelCount - level);
+	size_t total = stats.residentBytes - texture.bytes + bytes;
+	if (total > budgetBytes && !UMakeRoom(total - budgetBytes, size_t(&texture - textures.data())))
+	{
+		++stats.deniedLoads;
+		texture.retryFrame = frame + RETRY_FRAMES;
+		return false;
+	}
+
+	result.levels.erase(result.levels.begin(), result.levels.begin() + (level - result.firstLevel));
+	UReplaceTexture(texture, UCreateTexture(texture.filename, result.levels), level);
+	++stats.loads;
+	stats.uploadedBytes += bytes;
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UMakeRoom(size_t, size_t)
+//
+//	bytes: memory to free
+//	except: index of the texture being loaded
+//
+//	Trim the least recently drawn textures to their
+//	small mips until bytes are free, then the ones
+//	drawn this frame with more than they needed to
+//	that need. What every trim would free is added
+//	up first: when it is not enough nothing is
+//	trimmed and false is returned
+///////////////////////////////////////////////////
+bool TextureStreamer::UMakeRoom(size_t bytes, size_t except)
+{
+	order.clear();
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		if (i != except && !textures[i].filename.empty() && textures[i].residentLevel < textures[i].tailLevel)
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return textures[a].lastUsedFrame < textures[b].lastUsedFrame;
+	});
+
+	// a texture not drawn this frame goes down to its tail, one drawn keeps
+	// what it was drawn with
+	auto trimLevel = [this](const StreamedTexture& texture) {
+		return texture.lastUsedFrame == frame ? texture.wantedLevel : texture.tailLevel;
+	};
+
+	size_t available = 0;
+	for (size_t index : order)
+	{
+		const StreamedTexture& texture = textures[index];
+		GLsizei level = trimLevel(texture);
+		if (level > texture.residentLevel)
+		{
+			available += texture.bytes - TextureBytes(GL_RGBA8, ULevelSize(texture.width, level),
+				ULevelSize(texture.height, level), texture.levelCount - level);
+		}
+	}
+	if (available < bytes)
+		return false;
+
+	size_t freed = 0;
+	for (int pass = 0; pass < 2 && freed < bytes; ++pass)
+	{
+		for (size_t index : order)
+		{
+			StreamedTexture& texture = textures[index];
+			bool drawn = texture.lastUsedFrame == frame;
+			GLsizei level = trimLevel(texture);
+			if (drawn != (pass == 1) || level <= texture.residentLevel)
+				continue;
+
+			size_t before = texture.bytes;
+			UTrim(texture, level);
+			freed += before - texture.bytes;
+			++stats.evictions;
+			if (freed >= bytes)
+				break;
+		}
+	}
+	return freed >= bytes;
+}
+
+// Drop the levels finer than level, copying the others on the GPU
+void TextureStreamer::UTrim(StreamedTexture& texture, GLsizei level)
+{
+	GpuTexture replacement = CreateTexture2D(GpuCategory::Texture, texture.filename.c_str(), GL_RGBA8,
+		ULevelSize(texture.width, level), ULevelSize(texture.height, level), texture.levelCount - level);
+	for (GLsizei i = level; i < texture.levelCount; ++i)
+	{
+		glCopyImageSubData(texture.texture.Get(), GL_TEXTURE_2D, i - texture.residentLevel, 0, 0, 0,
+			replacement.Get(), GL_TEXTURE_2D, i - level, 0, 0, 0,
+			ULevelSize(texture.width, i), ULevelSize(texture.height, i), 1);
+	}
+	UReplaceTexture(texture, std::move(replacement), level);
+}
+
+// The old texture is deleted here; draws already queued with it still see it
+void TextureStreamer::UReplaceTexture(StreamedTexture& texture, GpuTexture replacement, GLsizei residentLevel)
+{
+	stats.residentBytes -= texture.bytes;
+	texture.bytes = TextureBytes(GL_RGBA8, ULevelSize(texture.width, residentLevel),
+		ULevelSize(texture.height, residentLevel), texture.levelCount - residentLevel);
+	stats.residentBytes += texture.bytes;
+	stats.peakBytes = std::max(stats.peakBytes, stats.residentBytes);
+	texture.texture = std::move(replacement);
+	texture.residentLevel = residentLevel;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::UFind(unsigned id)
+{
+	if (id == 0 || id > textures.size() || textures[id - 1].filename.empty())
+		return nullptr;
+	return &textures[id - 1];
+}
+
+const TextureStreamer::StreamedTexture* TextureStreamer::UFind(unsigned id) const
+{
+	if (id == 0 || id > textures.size() || textures[id - 1].filename.empty())
+		return nullptr;
+	return &textures[id - 1];
+}
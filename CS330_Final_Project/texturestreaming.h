@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreaming.h
+// ========
+// material textures whose mip levels are loaded on demand under a budget
+//
+// A texture starts with only its small mips on the GPU, the levels of 64
+// texels and less, which always stay. Every frame the renderer reports the
+// screen size of each textured object, and the finest level a texture needs
+// is the one with about a texel per pixel. Missing levels are decoded from
+// the image file and downsampled on worker threads; the render thread then
+// uploads a limited number of bytes per frame into a new immutable texture
+// that starts at the wanted level, and swaps it in.
+//
+// When the textures would grow past the budget, the ones least recently
+// drawn lose their streamed levels first, down to the small mips; then the
+// ones drawn at a coarser level than they hold are trimmed to it.
+//
+// The scene refers to textures by the ids handed out here, which stay the
+// same while the GL texture behind them is replaced.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gpuresources.h"
+
+class ThreadPool;
+
+struct TextureStreamingStats
+{
+	size_t residentBytes = 0;		// every streamed texture on the GPU
+	size_t peakBytes = 0;
+	size_t budgetBytes = 0;
+	uint64_t loads = 0;				// textures given finer levels
+	uint64_t evictions = 0;			// textures that lost levels to the budget
+	uint64_t deniedLoads = 0;		// loads dropped as the budget was full
+	uint64_t uploadedBytes = 0;
+};
+
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// budgetBytes: GPU memory the textures may use together. fullResolution
+	// keeps every level of every texture, as for comparing images.
+	void Create(size_t budgetBytes, bool fullResolution);
+	void Destroy();
+
+	// Read an image and upload its small mips; returns its id, 0 on failure
+	unsigned Add(const char* filename);
+	void Remove(unsigned id);
+
+	// Texture id is drawn this frame over about pixels pixels, its image
+	// repeated uvRepeat times across; returns the GL texture to bind
+	GLuint Use(unsigned id, float pixels, float uvRepeat);
+
+	// GL texture of id as it is now, 0 for an unknown id
+	GLuint GetTexture(unsigned id) const;
+
+	// Once per frame after drawing: swap in finished loads, start loads for
+	// the levels that were wanted and keep to the budget
+	void Update();
+
+	TextureStreamingStats GetStats() const { return stats; }
+	void Report(const char* label) const;
+
+private:
+	struct StreamedTexture
+	{
+		std::string filename;		// empty for a removed slot
+		GLsizei width = 0;			// level 0 of the image
+		GLsizei height = 0;
+		GLsizei levelCount = 0;		// full chain
+		GLsizei tailLevel = 0;		// first of the levels that always stay
+		GLsizei residentLevel = 0;	// finest level on the GPU, level 0 of texture
+		GLsizei wantedLevel = 0;	// finest level drawn this frame
+		GpuTexture texture;
+		size_t bytes = 0;
+		uint64_t lastUsedFrame = 0;
+		uint64_t retryFrame = 0;	// a denied load is not retried before this frame
+		unsigned generation = 0;	// bumped on removal, so late loads are dropped
+		bool loading = false;
+	};
+
+	// One mip level, RGBA rows bottom to top
+	struct Level
+	{
+		GLsizei width;
+		GLsizei height;
+		std::vector<unsigned char> pixels;
+	};
+
+	// Levels firstLevel and finer than the texture had, from a worker
+	struct LoadResult
+	{
+		size_t index;
+		unsigned generation;
+		GLsizei firstLevel;
+		std::vector<Level> levels;	// firstLevel onward, to the end of the chain
+		bool ok;
+	};
+
+	std::vector<StreamedTexture> textures;
+	std::unique_ptr<ThreadPool> loaders;
+	std::mutex resultsMutex;
+	std::vector<LoadResult> results;
+	std::vector<size_t> order;		// scratch for sorting textures
+	size_t budgetBytes = 0;
+	bool fullResolution = false;
+	uint64_t frame = 1;
+	size_t loadsInFlight = 0;
+	TextureStreamingStats stats;
+
+	static bool ULoadLevels(const std::string& filename, GLsizei width, GLsizei height, GLsizei firstLevel,
+		std::vector<Level>& levels);
+	static void UBuildLevels(Level& base, GLsizei firstLevel, GLsizei levelCount, std::vector<Level>& levels);
+	static GpuTexture UCreateTexture(const std::string& label, const std::vector<Level>& levels);
+	void UStartLoads();
+	size_t UInstallResults();
+	bool UInstall(StreamedTexture& texture, LoadResult& result);
+	bool UMakeRoom(size_t bytes, size_t except);
+	void UTrim(StreamedTexture& texture, GLsizei level);
+	void UReplaceTexture(StreamedTexture& texture, GpuTexture replacement, GLsizei residentLevel);
+	StreamedTexture* UFind(unsigned id);
+	const StreamedTexture* UFind(unsigned id) const;
+};
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ========
+// fixed set of worker threads running submitted jobs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "threadpool.h"
+
+unsigned ThreadPool::DefaultThreadCount()
+{
+	unsigned hardware = std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 0;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+	workers.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i)
+		workers.emplace_back(&ThreadPool::UWorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	wake.notify_one();
+}
+
+///////////////////////////////////////////////////
+//	Wait()
+//
+//	Help with the queue instead of sleeping, then
+//	block until the jobs taken by workers are done
+///////////////////////////////////////////////////
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!jobs.empty() || running > 0)
+	{
+		if (jobs.empty())
+		{
+			finished.wait(lock);
+			continue;
+		}
+
+		std::function<void()> job = std::move(jobs.front());
+		jobs.pop_front();
+		++running;
+		lock.unlock();
+		job();
+		lock.lock();
+		--running;
+	}
+}
+
+void ThreadPool::UWorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+		if (jobs.empty())
+			return;	// stopping
+
+		std::function<void()> job = std::move(jobs.front());
+		jobs.pop_front();
+		++running;
+		lock.unlock();
+		job();
+		lock.lock();
+		--running;
+		finished.notify_all();
+	}
+}
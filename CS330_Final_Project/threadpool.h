@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ========
+// fixed set of worker threads running submitted jobs
+//
+// The thread that waits for the jobs runs them too, so a pool sized for the
+// machine keeps every core busy without oversubscribing it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threads: worker threads besides the waiting thread; by default one
+	// less than the hardware threads
+	explicit ThreadPool(unsigned threads = DefaultThreadCount());
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> job);
+
+	// Run queued jobs on this thread until every submitted job has finished
+	void Wait();
+
+	// Threads that run jobs, including the waiting one
+	unsigned ThreadCount() const { return unsigned(workers.size()) + 1; }
+
+	static unsigned DefaultThreadCount();
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;		// a job was queued or the pool is stopping
+	std::condition_variable finished;	// a job completed
+	size_t running = 0;
+	bool stopping = false;
+
+	void UWorkerLoop();
+};
@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.cpp
+// ========
+// Google Benchmark microbenchmarks of the CPU hot paths
+//
+// usage: benchmarks [--benchmark_filter=regex] [--benchmark_out=file.json]
+//
+// Needs no window or GL context. Results are written as JSON to
+// benchmarks.json unless --benchmark_out is given, so runs before and after
+// a change can be kept and compared (tools/compare.py of Google Benchmark).
+// Build and run the Release configuration; Debug numbers mean nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <GLFW/stb_image.h>		// imageio.cpp links against it
+
+#include <benchmark/benchmark.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "bounds.h"
+#include "imageio.h"
+#include "logging.h"
+#include "meshdata.h"
+#include "scene.h"
+
+namespace
+{
+	// Deterministic spread of objects over a 20 x 20 area around the origin,
+	// with the kinds of scale, rotation and translation the scene file uses
+	std::vector<SceneObject> UMakeObjects(int count)
+	{
+		std::vector<SceneObject> objects(count);
+		for (int i = 0; i < count; ++i)
+		{
+			SceneObject& object = objects[i];
+			object.mesh = Meshes::MeshType(i % Meshes::MeshTypeCount);
+			object.textureId = 0;
+			object.scale = glm::vec3(0.5f + (i % 7) * 0.25f, 0.5f + (i % 5) * 0.25f, 0.5f + (i % 3) * 0.25f);
+			object.rotationAngle = glm::radians(float(i * 37 % 360));
+			object.rotationAxis = glm::normalize(glm::vec3(float(i % 2), 1.0f, float(i % 3)));
+			object.position = glm::vec3(float(i % 20) - 10.0f, float(i % 4), float(i / 20 % 20) - 10.0f);
+			object.uvScale = glm::vec2(1.0f);
+			object.isDynamic = false;
+			object.isLight = false;
+		}
+		return objects;
+	}
+
+	// Projection * view of the default camera looking at the table
+	glm::mat4 UViewProjection()
+	{
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 6.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+		return projection * view;
+	}
+}
+
+//*************************************
+// Mesh generators
+//*************************************
+
+// Torus at segments x segments, the scene uses 30 x 30
+static void BM_GenerateTorus(benchmark::State& state)
+{
+	int segments = int(state.range(0));
+	for (auto _ : state)
+	{
+		MeshData mesh;
+		GenerateTorusMesh(mesh, segments, segments);
+		benchmark::DoNotOptimize(mesh.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * segments * segments);
+}
+BENCHMARK(BM_GenerateTorus)->Arg(15)->Arg(30)->Arg(60)->Arg(120)->Unit(benchmark::kMicrosecond);
+
+// Sphere: a copy of the tables primitives.h builds at compile time
+static void BM_GenerateSphere(benchmark::State& state)
+{
+	uint32_t vertexCount = 0;
+	for (auto _ : state)
+	{
+		MeshData mesh;
+		GenerateSphereMesh(mesh);
+		vertexCount = mesh.VertexCount();
+		benchmark::DoNotOptimize(mesh.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * vertexCount);
+}
+BENCHMARK(BM_GenerateSphere)->Unit(benchmark::kMicrosecond);
+
+// All built-in primitives, one after the other, as one worker of CreateMeshes
+static void BM_GenerateAllPrimitives(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		MeshData meshes[8];
+		GeneratePlaneMesh(meshes[0]);
+		GeneratePrismMesh(meshes[1]);
+		GenerateCubeMesh(meshes[2]);
+		GenerateCylinderMesh(meshes[3]);
+		GenerateTaperedCylinderMesh(meshes[4]);
+		GeneratePyramidMesh(meshes[5]);
+		GenerateSphereMesh(meshes[6]);
+		GenerateTorusMesh(meshes[7]);
+		benchmark::DoNotOptimize(meshes);
+	}
+}
+BENCHMARK(BM_GenerateAllPrimitives)->Unit(benchmark::kMicrosecond);
+
+//*************************************
+// Images
+//*************************************
+
+// Texture flip done on every load: width x width pixels, range(1) channels
+static void BM_FlipImageVertically(benchmark::State& state)
+{
+	int width = int(state.range(0));
+	int channels = int(state.range(1));
+	std::vector<unsigned char> image(size_t(width) * width * channels);
+	for (size_t i = 0; i < image.size(); ++i)
+		image[i] = uint8_t(i * 31);
+
+	for (auto _ : state)
+	{
+		flipImageVertically(image.data(), width, width, channels);
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * int64_t(image.size()));
+}
+BENCHMARK(BM_FlipImageVertically)
+	->Args({ 256, 3 })->Args({ 1024, 3 })->Args({ 2048, 3 })->Args({ 4096, 3 })
+	->Args({ 1024, 4 })->Args({ 4096, 4 })
+	->Unit(benchmark::kMicrosecond);
+
+//*************************************
+// Transforms and culling
+//*************************************
+
+// Model matrices of range(0) objects, composed as URender does every frame
+static void BM_ModelMatrices(benchmark::State& state)
+{
+	std::vector<SceneObject> objects = UMakeObjects(int(state.range(0)));
+	std::vector<glm::mat4> models(objects.size());
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < objects.size(); ++i)
+			models[i] = objects[i].ModelMatrix();
+		benchmark::DoNotOptimize(models.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(objects.size()));
+}
+BENCHMARK(BM_ModelMatrices)->Arg(30)->Arg(1024)->Arg(16384);
+
+static void BM_FrustumFromMatrix(benchmark::State& state)
+{
+	glm::mat4 viewProjection = UViewProjection();
+	for (auto _ : state)
+	{
+		Frustum frustum = Frustum::FromMatrix(viewProjection);
+		benchmark::DoNotOptimize(frustum);
+	}
+}
+BENCHMARK(BM_FrustumFromMatrix);
+
+// World bounds of range(0) unit boxes (Bounds::Transformed), then the frustum test
+static void BM_CullBounds(benchmark::State& state)
+{
+	std::vector<SceneObject> objects = UMakeObjects(int(state.range(0)));
+	std::vector<glm::mat4> models(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i)
+		models[i] = objects[i].ModelMatrix();
+
+	Bounds unitBox;
+	unitBox.Expand(glm::vec3(-0.5f));
+	unitBox.Expand(glm::vec3(0.5f));
+	Frustum frustum = Frustum::FromMatrix(UViewProjection());
+
+	int visible = 0;
+	for (auto _ : state)
+	{
+		visible = 0;
+		for (const glm::mat4& model : models)
+			visible += frustum.Intersects(unitBox.Transformed(model)) ? 1 : 0;
+		benchmark::DoNotOptimize(visible);
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(models.size()));
+	state.counters["visible"] = double(visible);
+}
+BENCHMARK(BM_CullBounds)->Arg(30)->Arg(1024)->Arg(16384);
+
+int main(int argc, char* argv[])
+{
+	SetLogSynchronous(true);
+
+	// default to a JSON report in the working directory
+	std::vector<char*> args(argv, argv + argc);
+	bool hasOutput = false;
+	for (int i = 1; i < argc; ++i)
+		hasOutput = hasOutput || strncmp(argv[i], "--benchmark_out=", 16) == 0;
+
+	static char outArgument[] = "--benchmark_out=benchmarks.json";
+	static char formatArgument[] = "--benchmark_out_format=json";
+	if (!hasOutput)
+	{
+		args.push_back(outArgument);
+		args.push_back(formatArgument);
+	}
+	int count = int(args.size());
+	args.push_back(nullptr);
+
+	benchmark::Initialize(&count, args.data());
+	if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
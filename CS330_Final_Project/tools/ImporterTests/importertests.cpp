@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////
+// importertests.cpp
+// ========
+// malformed model files the importer has to reject without reading past them,
+// and numbers the text parsers have to read without leaving their tables
+//
+// usage: importertests
+//
+// Writes each GLB case into the temp directory, imports it and expects it to
+// be turned away by the header checks, with an empty model. A case that only
+// fails later, in the JSON parser, has already read past the file. Each
+// number case is read by ParseDouble, as OBJ files are, and inside a JSON
+// array, and has to match strtod. Exits with a failure code when any case
+// fails, so a build step or script can run it.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "importer.h"
+#include "json.h"
+#include "logging.h"
+#include "textparse.h"
+
+namespace
+{
+	const uint32_t GLB_MAGIC = 0x46546C67;			// "glTF"
+	const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;		// "JSON"
+	const char* const HEADER_ERROR = "ERROR::IMPORTER::NOT_A_GLB";
+
+	// Keeps the errors logged while a case imports
+	class ErrorSink : public LogSink
+	{
+	public:
+		void Write(LogLevel level, double, unsigned, const char* text, size_t length) override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (level == LogLevel::Error)
+				errors.append(text, length).append("\n");
+		}
+
+		std::string Take()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::string taken;
+			taken.swap(errors);
+			return taken;
+		}
+
+	private:
+		std::mutex mutex;
+		std::string errors;
+	};
+	ErrorSink* gErrors = nullptr;
+
+	struct GlbCase
+	{
+		const char* name;
+		uint32_t declaredLength;	// header length field; 0 for the real file size
+		uint32_t jsonLength;		// JSON chunk length field
+		size_t fileSize;			// bytes written: the file is cut or padded with spaces
+	};
+
+	// A 20 byte header and a small JSON document, with lying length fields.
+	// Padding is whitespace the parser skips, so a length past the end of the
+	// file walks off the mapped pages instead of stopping at a bad character.
+	std::vector<unsigned char> UMakeGlb(const GlbCase& test)
+	{
+		const std::string json = "{\"asset\":{\"version\":\"2.0\"}}";
+		std::vector<unsigned char> bytes(20 + json.size());
+		memcpy(bytes.data() + 20, json.data(), json.size());
+		bytes.resize(test.fileSize, ' ');
+
+		uint32_t header[5] = { GLB_MAGIC, 2, test.declaredLength ? test.declaredLength : uint32_t(test.fileSize),
+			test.jsonLength, GLB_CHUNK_JSON };
+		memcpy(bytes.data(), header, std::min(sizeof(header), bytes.size()));
+		return bytes;
+	}
+
+	bool URunCase(const GlbCase& test, const std::filesystem::path& directory)
+	{
+		std::filesystem::path path = directory / (std::string(test.name) + ".glb");
+		std::vector<unsigned char> bytes = UMakeGlb(test);
+		{
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+		}
+
+		gErrors->Take();
+		ImportedModel model;
+		bool imported = ImportModel(path.string().c_str(), model);
+		FlushLog();
+		std::string errors = gErrors->Take();
+		std::filesystem::remove(path);
+
+		bool passed = !imported && model.vertices.empty() && model.indices.empty() &&
+			errors.find(HEADER_ERROR) != std::string::npos;
+		printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+		if (!passed)
+			printf("  expected %s, got: %s", HEADER_ERROR, errors.empty() ? "no error\n" : errors.c_str());
+		return passed;
+	}
+
+	// Same value, or both the same zero, infinity or NaN
+	bool USameNumber(double actual, double expected)
+	{
+		if (std::isnan(expected) || std::isinf(expected) || expected == 0.0)
+			return (actual == expected || (std::isnan(actual) && std::isnan(expected))) &&
+				std::signbit(actual) == std::signbit(expected);
+		return std::fabs(actual - expected) <= 1e-14 * std::fabs(expected);
+	}
+
+	bool URunNumberCase(const std::string& text)
+	{
+		double expected = strtod(text.c_str(), nullptr);
+
+		double parsed = 0.0;
+		const char* cursor = text.data();
+		const char* end = text.data() + text.size();
+		bool passed = ParseDouble(cursor, end, parsed) && cursor == end && USameNumber(parsed, expected);
+
+		std::string json = "[" + text + "]";
+		JsonValue document;
+		passed = passed && ParseJson(json.data(), json.size(), document) && document.Size() == 1 &&
+			document[0].IsNumber() && USameNumber(document[0].number, expected);
+
+		std::string name = text.size() > 40 ? text.substr(0, 20) + "..." + text.substr(text.size() - 10) : text;
+		printf("%s number %s\n", passed ? "PASS" : "FAIL", name.c_str());
+		if (!passed)
+			printf("  expected %.17g, got %.17g\n", expected, parsed);
+		return passed;
+	}
+}
+
+int main()
+{
+	std::unique_ptr<ErrorSink> sink(new ErrorSink());
+	gErrors = sink.get();
+	AddLogSink(std::move(sink));
+	SetLogSynchronous(true);
+
+	const GlbCase cases[] = {
+		{ "shorter-than-header", 0, 32, 12 },
+		{ "declared-below-header", 12, 0x7FFFFFFFu, 4096 },
+		{ "declared-past-file", 8192, 32, 4096 },
+		{ "json-past-declared", 0, 8192, 4096 },
+		{ "json-past-file", 0, 0x7FFFFFFFu, 4096 },
+	};
+
+	std::error_code error;
+	std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+	if (error)
+		directory = ".";
+
+	int failures = 0;
+	for (const GlbCase& test : cases)
+	{
+		if (!URunCase(test, directory))
+			++failures;
+	}
+
+	// zero mantissas, underflow, overflow and fractions longer than the
+	// precision and the power table
+	const std::string zeros(40, '0');
+	const std::string numbers[] = {
+		"0", "-0", "0e-50", "0e50", "-0e-50", "0." + zeros, "0." + zeros + "e400",
+		"1e-400", "-1e-400", "1e400", "-1e400", "1e22", "1e23", "1e-22", "1e-23", "1.7976931348623157e308",
+		"0." + zeros + "25", "1." + zeros + "5", "123456789012345678901234567890", "3.14159",
+	};
+	for (const std::string& number : numbers)
+	{
+		if (!URunNumberCase(number))
+			++failures;
+	}
+
+	int total = int(sizeof(cases) / sizeof(cases[0]) + sizeof(numbers) / sizeof(numbers[0]));
+	printf("%d of %d cases failed\n", failures, total);
+	StopLog();
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
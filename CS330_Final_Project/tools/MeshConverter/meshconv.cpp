@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshconv.cpp
+// ========
+// offline converter from Wavefront OBJ and glTF to the binary .mesh format
+//
+// usage: meshconv input.(obj|gltf|glb) output.mesh
+//
+// Every OBJ group/object/material switch and every glTF primitive becomes a
+// submesh. Vertices are interleaved as position (location 0), normal (1)
+// and texture coords (2), the same layout the built-in meshes use.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <iostream>
+
+#include "importer.h"
+#include "logging.h"
+#include "meshfile.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	// importer errors in order with this tool's own output
+	SetLogSynchronous(true);
+
+	if (argc != 3)
+	{
+		cout << "usage: meshconv input.(obj|gltf|glb) output.mesh" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ImportedModel model;
+	ImportStats stats;
+	if (!ImportModel(argv[1], model, &stats))
+	{
+		cout << "Failed to read " << argv[1] << endl;
+		return EXIT_FAILURE;
+	}
+
+	cout << "Parsed " << argv[1] << ": " << stats.bytes / (1024.0 * 1024.0) << " MB in " << stats.seconds * 1000.0
+		<< " ms, " << stats.MegabytesPerSecond() << " MB/s on " << stats.threads << " threads" << endl;
+
+	MeshFileContents contents;
+	contents.attributes = {
+		{ 0, 3, MESH_FILE_FLOAT, 0 },						// position
+		{ 1, 3, MESH_FILE_FLOAT, 3 * sizeof(float) },		// normal
+		{ 2, 2, MESH_FILE_FLOAT, 6 * sizeof(float) },		// texture coords
+	};
+	contents.submeshes = model.submeshes;
+	contents.vertexStride = IMPORT_FLOATS_PER_VERTEX * sizeof(float);
+	contents.vertexCount = model.VertexCount();
+	contents.vertices = model.vertices.data();
+	contents.indexCount = uint32_t(model.indices.size());
+	contents.indices = model.indices.data();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		contents.boundsMin[axis] = model.boundsMin[axis];
+		contents.boundsMax[axis] = model.boundsMax[axis];
+	}
+
+	if (!WriteMeshFile(argv[2], contents))
+	{
+		cout << "Failed to write " << argv[2] << endl;
+		return EXIT_FAILURE;
+	}
+
+	cout << "Wrote " << argv[2] << ": " << contents.vertexCount << " vertices, " << contents.indexCount
+		<< " indices, " << contents.submeshes.size() << " submeshes" << endl;
+	return EXIT_SUCCESS;
+}
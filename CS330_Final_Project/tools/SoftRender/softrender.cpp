@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////////
+// softrender.cpp
+// ========
+// renders the regression poses of a scene with the software rasterizer
+//
+// usage: softrender [--scene file.json] [--suite suite.json] [--out dir]
+//                   [--size WxH] [--frames N] [--threads N] [--compare dir]
+//                   [--delta-e D] [--max-failing F]
+//
+// Needs no GPU, window or GL context. Every pose of the suite is drawn
+// --frames times and written to <out>/<pose>.png; the timings are reported
+// per frame and per core. --threads counts every thread that draws, the
+// main one included, and defaults to the hardware threads. With --compare
+// the images are checked against the GL renderer's images of the same poses
+// (the suite's references, or a --regress-out directory) by the regression
+// suite's CIE76 comparison. The defaults allow for the small differences of two rasterizers at triangle
+// edges and in the rounding of interpolated attributes.
+//
+// Only built-in meshes are drawn; scenes that load mesh files need the GL
+// renderer, which keeps their triangles on the GPU only.
+///////////////////////////////////////////////////////////////////////////////
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <GLFW/stb_image.h>		// imageio.cpp links against it
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bounds.h"
+#include "imageio.h"
+#include "json.h"
+#include "logging.h"
+#include "meshes.h"
+#include "rasterizer.h"
+#include "regression.h"
+#include "scene.h"
+#include "scenefile.h"
+#include "shadows.h"
+#include "threadpool.h"
+
+using namespace std;
+
+namespace
+{
+	const int SHADOW_MAP_SIZE = 2048;		// as the GL renderer's
+	const glm::vec3 CLEAR_COLOR(0.4f);
+
+	// Textures read by the scene loader; a texture's id is its index + 1
+	vector<Image> gTextures;
+
+	// SceneLoader::TextureLoader that keeps the image on the CPU, flipped to
+	// GL's bottom to top rows
+	bool ULoadTexture(const char* filename, GLuint& textureId)
+	{
+		Image image;
+		if (!ReadImage(filename, image, 3))
+		{
+			cout << "ERROR::SOFTRENDER::BAD_TEXTURE " << filename << endl;
+			return false;
+		}
+		flipImageVertically(image.pixels.data(), image.width, image.height, image.channels);
+		gTextures.push_back(move(image));
+		textureId = GLuint(gTextures.size());
+		return true;
+	}
+
+	// Mesh files and generated meshes are built by Meshes, which needs a GL context
+	bool UUsesMeshFiles(const char* filename)
+	{
+		ifstream in(filename, ios::binary);
+		stringstream buffer;
+		buffer << in.rdbuf();
+		string text = buffer.str();
+		JsonValue document;
+		if (!ParseJson(text.data(), text.size(), document, NULL))
+			return false;	// the loader reports it
+		const JsonValue* meshes = document.Find("meshes");
+		return meshes && !meshes->members.empty();
+	}
+
+	bool UParseSize(const char* text, int& width, int& height)
+	{
+		char* end = NULL;
+		width = int(strtol(text, &end, 10));
+		if (!end || (*end != 'x' && *end != 'X'))
+			return false;
+		height = int(strtol(end + 1, &end, 10));
+		return *end == '\0' && width > 0 && height > 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// scene and regression errors in order with this tool's own output
+	SetLogSynchronous(true);
+
+	const char* sceneFilename = "resources/scenes/table.json";
+	const char* suiteFilename = "resources/regression/suite.json";
+	string outputDirectory = "softrender";
+	string compareDirectory;
+	int width = 1200, height = 800;		// the regression suite's size
+	int frames = 10;
+	unsigned threads = ThreadPool::DefaultThreadCount() + 1;	// drawing threads, this one included
+	double deltaE = 10.0;
+	double maxFailing = 0.02;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--scene") == 0 && hasValue)
+			sceneFilename = argv[++i];
+		else if (strcmp(argv[i], "--suite") == 0 && hasValue)
+			suiteFilename = argv[++i];
+		else if (strcmp(argv[i], "--out") == 0 && hasValue)
+			outputDirectory = argv[++i];
+		else if (strcmp(argv[i], "--compare") == 0 && hasValue)
+			compareDirectory = argv[++i];
+		else if (strcmp(argv[i], "--size") == 0 && hasValue && UParseSize(argv[i + 1], width, height))
+			++i;
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+			frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+			threads = unsigned(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--delta-e") == 0 && hasValue)
+			deltaE = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--max-failing") == 0 && hasValue)
+			maxFailing = strtod(argv[++i], NULL);
+		else
+		{
+			cout << "usage: softrender [--scene file.json] [--suite suite.json] [--out dir] [--size WxH]" << endl
+				<< "                  [--frames N] [--threads N] [--compare dir] [--delta-e D] [--max-failing F]" << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (UUsesMeshFiles(sceneFilename))
+	{
+		cout << "ERROR::SOFTRENDER::MESH_FILES_NEED_GL " << sceneFilename << endl;
+		return EXIT_FAILURE;
+	}
+	SceneLoader loader(ULoadTexture, nullptr, nullptr);
+	Scene scene;
+	RegressionSuite suite;
+	if (!loader.Load(sceneFilename, scene) || !suite.Load(suiteFilename))
+		return EXIT_FAILURE;
+
+	//*************************************
+	// Draws
+	//*************************************
+	MeshData triangles[Meshes::MeshTypeCount];
+	for (int type = 0; type < Meshes::MeshTypeCount; ++type)
+		Meshes::GenerateTriangles(Meshes::MeshType(type), triangles[type]);
+
+	// lights that give no light are skipped, as the GL renderer does
+	int activeLights[ShadowMaps::NUM_LIGHTS];
+	int activeCount = 0;
+	for (int i = 0; i < ShadowMaps::NUM_LIGHTS; ++i)
+	{
+		if (scene.lights[i].color != glm::vec3(0.0f))
+			activeLights[activeCount++] = i;
+	}
+
+	vector<RasterDraw> draws;
+	vector<RasterDraw> casters;
+	Bounds casterBounds;
+	for (const SceneObject& object : scene.objects)
+	{
+		RasterDraw draw;
+		draw.triangles = &triangles[object.mesh];
+		draw.model = object.ModelMatrix();
+		draw.texture = object.textureId && !object.isLight ? &gTextures[object.textureId - 1] : NULL;
+		draw.uvScale = object.uvScale;
+		draw.color = object.isLight ? glm::vec3(1.0f) : object.color;
+		draw.unlit = object.isLight || object.isUnlit;
+		draw.specular = object.hasSpecular && scene.specularIntensity > 0.0f;
+		draws.push_back(draw);
+
+		if (object.isLight)
+			continue;
+		casters.push_back(draw);
+		if (object.isDynamic)
+			continue;
+		const MeshData& mesh = triangles[object.mesh];
+		for (uint32_t v = 0; v < mesh.VertexCount(); ++v)
+		{
+			const float* position = &mesh.vertices[size_t(v) * mesh.floatsPerEntry];
+			casterBounds.Expand(glm::vec3(draw.model * glm::vec4(position[0], position[1], position[2], 1.0f)));
+		}
+	}
+
+	ThreadPool pool(threads - 1);		// the pool's workers draw alongside this thread
+	Rasterizer rasterizer(pool);
+
+	//*************************************
+	// Shadow maps
+	//*************************************
+	RasterDepthMap shadowMaps[ShadowMaps::NUM_LIGHTS];
+	RasterShading shading;
+	shading.ambientColor = scene.ambientColor;
+	shading.ambientStrength = scene.ambientStrength;
+	shading.specularIntensity = scene.specularIntensity;
+	shading.highlightSize = scene.highlightSize;
+	shading.lightCount = activeCount;
+	double shadowMilliseconds = 0.0;
+	for (int i = 0; i < activeCount; ++i)
+	{
+		const SceneLight& light = scene.lights[activeLights[i]];
+		shadowMaps[i].size = SHADOW_MAP_SIZE;
+		shadowMaps[i].lightSpace = ShadowMaps::ComputeLightSpace(casterBounds, light.position);
+		rasterizer.RenderDepth(casters, shadowMaps[i]);
+		shadowMilliseconds += rasterizer.GetStats().milliseconds;
+
+		shading.lights[i].position = light.position;
+		shading.lights[i].color = light.color;
+		shading.lights[i].shadowMap = &shadowMaps[i];
+	}
+	cout << "Shadow maps: " << activeCount << " x " << SHADOW_MAP_SIZE << "^2 in " << shadowMilliseconds << " ms" << endl;
+
+	//*************************************
+	// Poses
+	//*************************************
+	error_code error;
+	filesystem::create_directories(outputDirectory, error);
+	if (error)
+	{
+		cout << "ERROR::SOFTRENDER::CANNOT_CREATE_DIRECTORY " << outputDirectory << endl;
+		return EXIT_FAILURE;
+	}
+
+	bool passed = true;
+	for (const RegressionPose& pose : suite.GetPoses())
+	{
+		glm::mat4 view = glm::lookAt(pose.position, pose.position + glm::normalize(pose.target - pose.position),
+			glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(pose.fov), float(width) / float(height), 0.1f, 100.0f);
+		shading.viewPosition = pose.position;
+
+		Image image;
+		image.width = width;
+		image.height = height;
+		double total = 0.0, best = 0.0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			rasterizer.RenderColor(draws, projection * view, shading, CLEAR_COLOR, image);
+			double milliseconds = rasterizer.GetStats().milliseconds;
+			total += milliseconds;
+			best = frame == 0 ? milliseconds : min(best, milliseconds);
+		}
+
+		const RasterStats& stats = rasterizer.GetStats();
+		double megapixels = double(width) * height / 1000000.0;
+		cout << pose.name << ": " << total / frames << " ms mean, " << best << " ms best, " << stats.triangles
+			<< " triangles, " << stats.pixels << " shaded pixels, " << megapixels / (best / 1000.0) << " Mpixels/s, "
+			<< megapixels / (best / 1000.0) / stats.threads << " Mpixels/s per core on " << stats.threads << " threads" << endl;
+
+		string filename = outputDirectory + "/" + pose.name + ".png";
+		if (!WritePng(filename.c_str(), image))
+		{
+			cout << "ERROR::SOFTRENDER::CANNOT_WRITE " << filename << endl;
+			return EXIT_FAILURE;
+		}
+
+		if (compareDirectory.empty())
+			continue;
+		Image reference;
+		if (!ReadImage((compareDirectory + "/" + pose.name + ".png").c_str(), reference, 3) ||
+			reference.width != width || reference.height != height)
+		{
+			cout << "FAIL    " << pose.name << ": no " << width << "x" << height << " image in " << compareDirectory << endl;
+			passed = false;
+			continue;
+		}
+		ImageComparison comparison = CompareImages(reference, image, deltaE, maxFailing);
+		WritePng((outputDirectory + "/" + pose.name + ".diff.png").c_str(), comparison.diff);
+		cout << (comparison.passed ? "PASS    " : "FAIL    ") << pose.name << ": " << comparison.failingFraction * 100.0
+			<< "% of pixels over dE " << deltaE << ", max dE " << comparison.maxDeltaE << endl;
+		passed = passed && comparison.passed;
+	}
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}